@@ -0,0 +1,189 @@
+// Micro benchmarks of webcc::gzip against the legacy implementation, which
+// initialized (and freed) the zlib state on every call and guessed the size of
+// the output.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "zlib.h"
+
+#include "webcc/gzip.h"
+
+namespace {
+
+// -----------------------------------------------------------------------------
+// The legacy implementation.
+
+bool LegacyCompress(const std::string& input, std::string* output) {
+  output->clear();
+
+  if (input.empty()) {
+    return true;
+  }
+
+  z_stream stream;
+  stream.next_in = (Bytef*)input.data();
+  stream.avail_in = (uInt)input.size();
+  stream.zalloc = Z_NULL;
+  stream.zfree = Z_NULL;
+  stream.opaque = Z_NULL;
+
+  int ret = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                         MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY);
+  if (ret != Z_OK) {
+    return false;
+  }
+
+  std::string buf;
+  buf.resize(input.size() / 2);
+
+  do {
+    stream.avail_out = (uInt)buf.size();
+    stream.next_out = (Bytef*)buf.data();
+
+    int err = deflate(&stream, Z_FINISH);
+    if (err != Z_OK && err != Z_STREAM_END) {
+      deflateEnd(&stream);
+      return false;
+    }
+
+    output->append(buf.data(), buf.size() - stream.avail_out);
+
+  } while (stream.avail_out == 0);
+
+  return deflateEnd(&stream) == Z_OK;
+}
+
+bool LegacyDecompress(const std::string& input, std::string* output) {
+  output->clear();
+
+  if (input.empty()) {
+    return true;
+  }
+
+  std::string buf;
+  buf.resize(input.size());
+
+  z_stream stream;
+  stream.next_in = (Bytef*)input.data();
+  stream.avail_in = (uInt)input.size();
+  stream.total_out = 0;
+  stream.zalloc = Z_NULL;
+  stream.zfree = Z_NULL;
+
+  if (inflateInit2(&stream, MAX_WBITS + 32) != Z_OK) {
+    return false;
+  }
+
+  while (true) {
+    if (stream.total_out >= buf.size()) {
+      buf.resize(buf.size() + input.size() / 2);
+    }
+
+    stream.next_out = (Bytef*)(buf.data() + stream.total_out);
+    stream.avail_out = (uInt)buf.size() - stream.total_out;
+
+    int err = inflate(&stream, Z_SYNC_FLUSH);
+    if (err == Z_STREAM_END) {
+      break;
+    }
+    if (err != Z_OK) {
+      inflateEnd(&stream);
+      return false;
+    }
+  }
+
+  if (inflateEnd(&stream) != Z_OK) {
+    return false;
+  }
+
+  buf.erase(stream.total_out);
+  *output = std::move(buf);
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+
+// Some JSON-like data of the given size, about 5:1 compressible.
+std::string MakeData(std::size_t size) {
+  std::string data;
+  unsigned seed = 1;
+  while (data.size() < size) {
+    seed = seed * 1103515245 + 12345;
+    data += "{\"id\":" + std::to_string(seed % 100000) +
+            ",\"name\":\"item" + std::to_string(seed % 977) +
+            "\",\"tags\":[\"a\",\"b\"]},\n";
+  }
+  data.resize(size);
+  return data;
+}
+
+template <typename Func>
+double Measure(std::size_t size, Func func) {
+  // Repeat the function to process about 64MB in total, at least 20 times.
+  std::size_t times = std::max<std::size_t>(64 * 1024 * 1024 / size, 20);
+
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < times; ++i) {
+    if (!func()) {
+      std::fprintf(stderr, "Failed!\n");
+      std::exit(1);
+    }
+  }
+  std::chrono::duration<double> seconds =
+      std::chrono::steady_clock::now() - start;
+
+  return size * times / seconds.count() / (1024 * 1024);
+}
+
+void Benchmark(std::size_t size) {
+  const std::string data = MakeData(size);
+
+  std::string compressed;
+  std::string output;
+
+  double legacy = Measure(size, [&] {
+    return LegacyCompress(data, &compressed);
+  });
+
+  double current = Measure(size, [&] {
+    return webcc::gzip::Compress(data, &compressed);
+  });
+
+  double fast = Measure(size, [&] {
+    return webcc::gzip::Compress(data, &output, webcc::gzip::kBestSpeed);
+  });
+
+  std::size_t fast_size = output.size();
+
+  double legacy_inflate = Measure(size, [&] {
+    return LegacyDecompress(compressed, &output);
+  });
+
+  double current_inflate = Measure(size, [&] {
+    return webcc::gzip::Decompress(compressed, &output);
+  });
+
+  std::printf("%8zuKB %9.1f %9.1f %9.1f %9.1f %9.1f %7.1f%% %7.1f%%\n",
+              size / 1024, legacy, current, fast, legacy_inflate,
+              current_inflate, compressed.size() * 100.0 / size,
+              fast_size * 100.0 / size);
+}
+
+}  // namespace
+
+int main() {
+  std::printf("Throughput in MB/s of the input (compress) or output "
+              "(decompress).\n\n");
+  std::printf("%10s %9s %9s %9s %9s %9s %8s %8s\n", "size", "legacy",
+              "deflate", "level 1", "legacy", "inflate", "ratio", "ratio 1");
+
+  for (std::size_t size : { 1, 4, 16, 64, 256, 1024, 4096 }) {
+    Benchmark(size * 1024);
+  }
+
+  return 0;
+}
@@ -0,0 +1,364 @@
+// Micro benchmarks of the request parser.
+// The throughput is measured in MB/s of the raw requests, and the heap
+// allocations are counted by replacing the global operator new.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include "webcc/logger.h"
+#include "webcc/request.h"
+#include "webcc/request_parser.h"
+#include "webcc/search.h"
+
+// -----------------------------------------------------------------------------
+
+namespace {
+
+std::atomic<std::size_t> g_allocations{ 0 };
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  ++g_allocations;
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc{};
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+// -----------------------------------------------------------------------------
+
+namespace {
+
+// A typical request of a browser, with 15 headers.
+const char* const kGetRequest =
+    "GET /api/v1/books/12345?fields=title,author HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"118\", \"Not=A?Brand\";v=\"99\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "sec-ch-ua-platform: \"Linux\"\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+    "(KHTML, like Gecko) Chrome/118.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,"
+    "image/avif,image/webp,*/*;q=0.8\r\n"
+    "Sec-Fetch-Site: none\r\n"
+    "Sec-Fetch-Mode: navigate\r\n"
+    "Sec-Fetch-User: ?1\r\n"
+    "Sec-Fetch-Dest: document\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "\r\n";
+
+// A small JSON post of an API client.
+const char* const kPostRequest =
+    "POST /api/v1/books HTTP/1.1\r\n"
+    "Host: api.example.com\r\n"
+    "User-Agent: Webcc/0.3.0\r\n"
+    "Accept: application/json\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Content-Type: application/json; charset=utf-8\r\n"
+    "Content-Length: 45\r\n"
+    "Connection: Keep-Alive\r\n"
+    "\r\n"
+    "{\"title\":\"1984\",\"author\":\"George Orwell\"}\r\n\r\n";
+
+bool MatchView(webcc::Request*, bool* stream, bool* non_blocking) {
+  *stream = false;
+  *non_blocking = false;
+  return true;
+}
+
+// If |recycle| is true, the requests are parsed into the same request object,
+// cleared for each one as a connection does.
+void Benchmark(const char* name, const std::string& data, bool recycle) {
+  const std::size_t kTimes = 200000;
+
+  webcc::RequestParser parser;
+  webcc::Request recycled;
+
+  std::size_t allocations = 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (std::size_t i = 0; i < kTimes; ++i) {
+    webcc::Request request;
+    webcc::Request* target = recycle ? &recycled : &request;
+
+    std::size_t before = g_allocations;
+
+    target->Clear();
+    parser.Init(target, &MatchView);
+    if (!parser.Parse(data.data(), data.size()) || !parser.finished()) {
+      std::fprintf(stderr, "Failed to parse the request!\n");
+      std::exit(1);
+    }
+
+    allocations += g_allocations - before;
+  }
+
+  std::chrono::duration<double> seconds =
+      std::chrono::steady_clock::now() - start;
+
+  std::printf("%-6s %-8s %6zu bytes %10.1f MB/s %10.0f req/s "
+              "%8.1f allocs/req\n",
+              name, recycle ? "recycled" : "new", data.size(),
+              data.size() * kTimes / seconds.count() / (1024 * 1024),
+              kTimes / seconds.count(),
+              static_cast<double>(allocations) / kTimes);
+}
+
+// The header lookups done for a request by the server and a typical view,
+// after the request has been parsed.
+void BenchmarkHeaderLookups() {
+  webcc::RequestParser parser;
+  webcc::Request request;
+  parser.Init(&request, &MatchView);
+  parser.Parse(kGetRequest, std::strlen(kGetRequest));
+
+  const std::size_t kTimes = 1000000;
+
+  std::size_t count = 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (std::size_t i = 0; i < kTimes; ++i) {
+    count += request.IsConnectionKeepAlive();
+    count += request.GetContentEncoding() == webcc::ContentEncoding::kUnknown;
+    count += request.AcceptEncodingGzip();
+    count += request.HasHeader(webcc::headers::kContentType);
+    count += request.GetHeader(webcc::headers::kIfNoneMatch).empty();
+    count += request.GetHeader(webcc::headers::kRange).empty();
+    count += request.GetHeader("Accept-Language").size();
+    count += request.GetHeader("X-Request-Id").empty();
+  }
+
+  std::chrono::duration<double> seconds =
+      std::chrono::steady_clock::now() - start;
+
+  if (count == 0) {
+    std::fprintf(stderr, "Wrong result!\n");
+    std::exit(1);
+  }
+
+  std::printf("%-6s %10.1f ns/lookup\n", "lookup",
+              seconds.count() * 1e9 / (kTimes * 8));
+}
+
+// A multipart upload of a file of the given size, parsed from reads of
+// |read_size| bytes as from a socket.
+void BenchmarkMultipart(std::size_t file_size, std::size_t read_size) {
+  const std::string boundary = "9431149156168";
+
+  // Binary-like data with some CRs, LFs and dashes.
+  std::string file(file_size, 'x');
+  unsigned seed = 1;
+  for (char& c : file) {
+    seed = seed * 1103515245 + 12345;
+    c = "\r\n-abcdefghijklmnopqrstuvwxyz"[(seed >> 16) % 30];
+  }
+
+  std::string data =
+      "--" + boundary + "\r\n"
+      "Content-Disposition: form-data; name=\"file\"; filename=\"a.bin\"\r\n"
+      "Content-Type: application/octet-stream\r\n"
+      "\r\n" + file + "\r\n"
+      "--" + boundary + "--\r\n";
+
+  std::string request =
+      "POST /upload HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Content-Type: multipart/form-data; boundary=" + boundary + "\r\n"
+      "Content-Length: " + std::to_string(data.size()) + "\r\n"
+      "\r\n" + data;
+
+  const std::size_t kTimes = 5;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (std::size_t i = 0; i < kTimes; ++i) {
+    webcc::Request req;
+    webcc::RequestParser parser;
+    parser.Init(&req, &MatchView);
+
+    for (std::size_t off = 0; off < request.size(); off += read_size) {
+      std::size_t size = std::min(read_size, request.size() - off);
+      if (!parser.Parse(request.data() + off, size)) {
+        std::fprintf(stderr, "Failed to parse the request!\n");
+        std::exit(1);
+      }
+    }
+
+    if (!parser.finished() || req.form_parts().size() != 1 ||
+        req.form_parts()[0]->data().size() != file_size) {
+      std::fprintf(stderr, "Wrong result!\n");
+      std::exit(1);
+    }
+  }
+
+  std::chrono::duration<double> seconds =
+      std::chrono::steady_clock::now() - start;
+
+  std::printf("%-6s %4zuMB in %5zuKB reads %10.1f MB/s\n", "form",
+              file_size / (1024 * 1024), read_size / 1024,
+              request.size() * kTimes / seconds.count() / (1024 * 1024));
+}
+
+// A request of a body of the given size, sent in chunks of |chunk_size|, and
+// parsed from reads of |read_size| bytes as from a socket.
+void BenchmarkChunked(std::size_t body_size, std::size_t chunk_size,
+                      std::size_t read_size) {
+  std::string request =
+      "POST /upload HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n";
+
+  const std::string chunk(chunk_size, 'x');
+  char chunk_size_line[32];
+  std::snprintf(chunk_size_line, sizeof(chunk_size_line), "%zx\r\n",
+                chunk_size);
+
+  for (std::size_t size = 0; size < body_size; size += chunk_size) {
+    request += chunk_size_line;
+    request += chunk;
+    request += "\r\n";
+  }
+  request += "0\r\n\r\n";
+
+  const std::size_t kTimes = 3;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (std::size_t i = 0; i < kTimes; ++i) {
+    webcc::Request req;
+    webcc::RequestParser parser;
+    parser.Init(&req, &MatchView);
+
+    for (std::size_t off = 0; off < request.size(); off += read_size) {
+      std::size_t size = std::min(read_size, request.size() - off);
+      if (!parser.Parse(request.data() + off, size)) {
+        std::fprintf(stderr, "Failed to parse the request!\n");
+        std::exit(1);
+      }
+    }
+
+    if (!parser.finished() || req.data().size() < body_size) {
+      std::fprintf(stderr, "Wrong result!\n");
+      std::exit(1);
+    }
+  }
+
+  std::chrono::duration<double> seconds =
+      std::chrono::steady_clock::now() - start;
+
+  std::printf("%-6s %4zuMB in %6zuB chunks %10.1f MB/s\n", "chunk",
+              body_size / (1024 * 1024), chunk_size,
+              request.size() * kTimes / seconds.count() / (1024 * 1024));
+}
+
+// The raw throughput of the search kernels on 1MB of data.
+void BenchmarkSearch() {
+  std::string data(1024 * 1024, 'a');
+  unsigned seed = 1;
+  for (char& c : data) {
+    seed = seed * 1103515245 + 12345;
+    if ((seed >> 16) % 64 == 0) {
+      c = '\r';  // A lone CR per 64 bytes
+    }
+  }
+
+  const std::string needle = "\r\n--9431149156168";
+  const char* begin = data.data();
+  const char* end = begin + data.size();
+
+  const std::size_t kTimes = 500;
+
+  double mbs[3] = { 0 };
+
+  for (int k = 0; k < 3; ++k) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::size_t found = 0;
+    for (std::size_t i = 0; i < kTimes; ++i) {
+      // Vary the beginning so the search is not hoisted out of the loop.
+      begin = data.data() + (i & 1);
+
+      if (k == 0) {
+        found += webcc::search::FindChar(begin, end, ':') != nullptr;
+      } else if (k == 1) {
+        found += webcc::search::FindCRLF(begin, end) != nullptr;
+      } else {
+        found += webcc::search::Find(begin, end, needle.data(),
+                                     needle.size()) != nullptr;
+      }
+    }
+
+    std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - start;
+
+    if (found != 0) {
+      std::fprintf(stderr, "Wrong result!\n");
+      std::exit(1);
+    }
+
+    mbs[k] = data.size() * kTimes / seconds.count() / (1024 * 1024);
+  }
+
+  std::printf("%-6s colon %8.0f MB/s, crlf %8.0f MB/s, boundary %8.0f MB/s\n",
+              "search", mbs[0], mbs[1], mbs[2]);
+}
+
+}  // namespace
+
+int main() {
+  WEBCC_LOG_INIT("", webcc::LOG_CONSOLE);
+
+  using webcc::search::Level;
+
+  for (Level level : { Level::kScalar, Level::kSse2, Level::kAvx2 }) {
+    if (!webcc::search::SetLevel(level)) {
+      continue;
+    }
+
+    std::printf("[%s]\n", webcc::search::LevelName(level));
+
+    BenchmarkSearch();
+
+    for (bool recycle : { false, true }) {
+      Benchmark("get", kGetRequest, recycle);
+      Benchmark("post", kPostRequest, recycle);
+    }
+
+    for (std::size_t file_size : { 4, 16 }) {
+      BenchmarkMultipart(file_size * 1024 * 1024, 16 * 1024);
+    }
+
+    std::printf("\n");
+  }
+
+  BenchmarkHeaderLookups();
+
+  // The chunked content doesn't depend on the search level much.
+  for (std::size_t chunk_size : { 1, 16, 256, 4096, 65536 }) {
+    BenchmarkChunked(4 * 1024 * 1024, chunk_size, 64 * 1024);
+  }
+
+  return 0;
+}
@@ -0,0 +1,92 @@
+// Micro benchmarks of the router, with the routes of plain URLs (in the trie)
+// against the same routes of regular expressions (matched one by one).
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "webcc/logger.h"
+#include "webcc/response_builder.h"
+#include "webcc/router.h"
+
+namespace {
+
+class MyView : public webcc::View {
+public:
+  webcc::ResponsePtr Handle(webcc::RequestPtr /*request*/) override {
+    return webcc::ResponseBuilder{}.OK()();
+  }
+};
+
+// Route |count| resources of a REST API, each with a list URL and a detail
+// URL, e.g., "/api/v1/res7" and "/api/v1/res7/{id:int}".
+void AddRoutes(webcc::Router* router, std::size_t count, bool regex) {
+  auto view = std::make_shared<MyView>();
+
+  for (std::size_t i = 0; i < count; ++i) {
+    std::string url = "/api/v1/res" + std::to_string(i);
+    if (regex) {
+      router->Route(webcc::R(url), view, { "GET", "POST" });
+      router->Route(webcc::R(url + "/(\\d+)"), view,
+                    { "GET", "PUT", "DELETE" });
+    } else {
+      router->Route(url, view, { "GET", "POST" });
+      router->Route(url + "/{id:int}", view, { "GET", "PUT", "DELETE" });
+    }
+  }
+}
+
+// Return the time of a match in nanoseconds.
+double Benchmark(std::size_t count, bool regex) {
+  webcc::Router router;
+  AddRoutes(&router, count, regex);
+
+  // The URLs spread over all the routes.
+  std::vector<std::string> urls;
+  for (std::size_t i = 0; i < 64; ++i) {
+    std::size_t res = (i * 7919) % count;
+    std::string url = "/api/v1/res" + std::to_string(res);
+    if (i % 2 == 1) {
+      url += "/" + std::to_string(i * 1000);
+    }
+    urls.push_back(url);
+  }
+
+  // The regular expressions are too slow for as many times.
+  const std::size_t kTimes = regex ? 2000000 / count : 1000000;
+
+  webcc::UrlArgs args;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (std::size_t i = 0; i < kTimes; ++i) {
+    args.clear();
+    if (!router.FindView("GET", urls[i % urls.size()], &args)) {
+      std::fprintf(stderr, "Failed to find the view!\n");
+      std::exit(1);
+    }
+  }
+
+  std::chrono::duration<double> seconds =
+      std::chrono::steady_clock::now() - start;
+
+  return seconds.count() * 1e9 / kTimes;
+}
+
+}  // namespace
+
+int main() {
+  WEBCC_LOG_INIT("", webcc::LOG_CONSOLE);
+
+  for (std::size_t count : { 5, 50, 500 }) {
+    double trie = Benchmark(count, false);
+    double regex = Benchmark(count, true);
+
+    std::printf("%5zu routes: trie %10.1f ns/match, regex %12.1f ns/match\n",
+                count * 2, trie, regex);
+  }
+
+  return 0;
+}
@@ -0,0 +1,1027 @@
+// Loopback benchmarks of the server.
+// The server and the load generating clients run in the same process and talk
+// to each other over the loopback interface. Each client is a minimal blocking
+// HTTP/1.1 client keeping its connection alive.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/algorithm/string.hpp"
+#include "boost/asio/connect.hpp"
+#include "boost/asio/io_context.hpp"
+#include "boost/asio/ip/tcp.hpp"
+#include "boost/asio/steady_timer.hpp"
+#include "boost/asio/write.hpp"
+#include "boost/filesystem/fstream.hpp"
+#include "boost/filesystem/operations.hpp"
+
+#include "webcc/logger.h"
+#include "webcc/response_builder.h"
+#include "webcc/server.h"
+
+#if defined(__linux__)
+#include <arpa/inet.h>
+#include <dlfcn.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace bfs = boost::filesystem;
+
+using tcp = boost::asio::ip::tcp;
+
+// -----------------------------------------------------------------------------
+
+// Count the write syscalls of the server by interposing the libc functions.
+// The syscalls of the threads marked by IgnoreWritesInThisThread() (i.e., the
+// client) are not counted. Linux only.
+
+namespace {
+
+std::atomic<std::size_t> g_write_syscalls{ 0 };
+
+#if defined(__linux__)
+thread_local bool g_count_writes = true;
+#endif
+
+void IgnoreWritesInThisThread() {
+#if defined(__linux__)
+  g_count_writes = false;
+#endif
+}
+
+}  // namespace
+
+#if defined(__linux__)
+
+#define WEBCC_INTERPOSE(ret, name, params, args)                         \
+  extern "C" ret name params {                                           \
+    using Func = ret(*) params;                                          \
+    static Func real = reinterpret_cast<Func>(dlsym(RTLD_NEXT, #name));  \
+    if (g_count_writes) {                                                \
+      ++g_write_syscalls;                                                \
+    }                                                                    \
+    return real args;                                                    \
+  }
+
+WEBCC_INTERPOSE(ssize_t, sendmsg,
+                (int fd, const struct msghdr* msg, int flags),
+                (fd, msg, flags))
+WEBCC_INTERPOSE(ssize_t, send,
+                (int fd, const void* buf, size_t len, int flags),
+                (fd, buf, len, flags))
+WEBCC_INTERPOSE(ssize_t, writev,
+                (int fd, const struct iovec* iov, int iovcnt),
+                (fd, iov, iovcnt))
+WEBCC_INTERPOSE(ssize_t, sendfile,
+                (int out_fd, int in_fd, off_t* offset, size_t count),
+                (out_fd, in_fd, offset, count))
+
+#undef WEBCC_INTERPOSE
+
+#endif  // defined(__linux__)
+
+namespace {
+
+const std::uint16_t kPort = 18080;
+
+const char* const kHelloRequest =
+    "GET /hello HTTP/1.1\r\n"
+    "Host: localhost\r\n"
+    "\r\n";
+
+const char* const kSlowRequest =
+    "GET /slow HTTP/1.1\r\n"
+    "Host: localhost\r\n"
+    "\r\n";
+
+// The time a slow backend takes to reply.
+const std::chrono::milliseconds kBackendDelay(10);
+
+const char* const kHealthRequest =
+    "GET /health HTTP/1.1\r\n"
+    "Host: localhost\r\n"
+    "\r\n";
+
+const char* const kHealthInlineRequest =
+    "GET /health/inline HTTP/1.1\r\n"
+    "Host: localhost\r\n"
+    "\r\n";
+
+// -----------------------------------------------------------------------------
+
+class HelloView : public webcc::View {
+public:
+  webcc::ResponsePtr Handle(webcc::RequestPtr /*request*/) override {
+    return webcc::ResponseBuilder{}.OK().Body("Hello, World!")();
+  }
+};
+
+// A view returning a JSON of the given size.
+class JsonView : public webcc::View {
+public:
+  explicit JsonView(std::size_t size) {
+    json_ = "{\"data\": \"" + std::string(size, 'x') + "\"}";
+  }
+
+  webcc::ResponsePtr Handle(webcc::RequestPtr /*request*/) override {
+    return webcc::ResponseBuilder{}.OK().Body(json_).Json()();
+  }
+
+private:
+  std::string json_;
+};
+
+// A view exporting a large JSON array of the given number of rows.
+// If |stream| is true, the rows are generated piece by piece while they are
+// sent, otherwise, the whole JSON is built before it's sent.
+class ExportView : public webcc::View {
+public:
+  ExportView(std::size_t rows, bool stream) : rows_(rows), stream_(stream) {
+  }
+
+  webcc::ResponsePtr Handle(webcc::RequestPtr /*request*/) override {
+    if (stream_) {
+      auto row = std::make_shared<std::size_t>(0);
+      std::size_t rows = rows_;
+      return webcc::ResponseBuilder{}.OK().Json().Stream(
+          [row, rows](std::string* data) {
+            if (*row > rows) {
+              return false;
+            }
+            // 64 rows a piece.
+            for (int i = 0; i < 64 && *row <= rows; ++i, ++*row) {
+              AppendRow(*row, rows, data);
+            }
+            return true;
+          })();
+    }
+
+    std::string data;
+    for (std::size_t row = 0; row <= rows_; ++row) {
+      AppendRow(row, rows_, &data);
+    }
+    return webcc::ResponseBuilder{}.OK().Json().Body(std::move(data))();
+  }
+
+private:
+  // Append the |row|-th piece of the JSON array, the last one (|rows|) closes
+  // the array.
+  static void AppendRow(std::size_t row, std::size_t rows, std::string* data) {
+    if (row == rows) {
+      *data += "]";
+      return;
+    }
+    *data += row == 0 ? "[" : ",";
+    *data += "{\"id\": " + std::to_string(row) + ", \"name\": \"" +
+             std::string(100, 'x') + "\"}";
+  }
+
+  std::size_t rows_;
+  bool stream_;
+};
+
+// A trivial view like a health check, the response has no body.
+class HealthView : public webcc::View {
+public:
+  webcc::ResponsePtr Handle(webcc::RequestPtr /*request*/) override {
+    return webcc::ResponseBuilder{}.OK()();
+  }
+};
+
+// A view waiting for a slow backend, the worker thread is blocked meanwhile.
+class SlowView : public webcc::View {
+public:
+  webcc::ResponsePtr Handle(webcc::RequestPtr /*request*/) override {
+    std::this_thread::sleep_for(kBackendDelay);
+    return webcc::ResponseBuilder{}.OK().Body("Hello, World!")();
+  }
+};
+
+// The async version of SlowView, the slow backend is simulated by a timer so
+// the worker thread is free as soon as the request is parked.
+class AsyncSlowView : public webcc::AsyncView {
+public:
+  explicit AsyncSlowView(boost::asio::io_context* backend)
+      : backend_(backend) {
+  }
+
+  void AsyncHandle(webcc::RequestPtr /*request*/,
+                   webcc::ResponderPtr responder) override {
+    auto timer = std::make_shared<boost::asio::steady_timer>(*backend_,
+                                                             kBackendDelay);
+    timer->async_wait([timer, responder](boost::system::error_code) {
+      responder->Send(webcc::ResponseBuilder{}.OK().Body("Hello, World!")());
+    });
+  }
+
+private:
+  boost::asio::io_context* backend_;
+};
+
+// -----------------------------------------------------------------------------
+
+// A minimal blocking HTTP/1.1 client for generating the load.
+class LoadClient {
+public:
+  explicit LoadClient(std::uint16_t port) : socket_(io_context_) {
+    tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), port);
+    socket_.connect(endpoint);
+    socket_.set_option(tcp::no_delay(true));
+  }
+
+  // Send the request |depth| times in a row (i.e., pipelined if |depth| > 1),
+  // then read all the responses.
+  // Return false on any error.
+  bool Send(const std::string& request, std::size_t depth = 1) {
+    std::string data;
+    for (std::size_t i = 0; i < depth; ++i) {
+      data += request;
+    }
+
+    boost::system::error_code ec;
+    boost::asio::write(socket_, boost::asio::buffer(data), ec);
+    if (ec) {
+      return false;
+    }
+
+    for (std::size_t i = 0; i < depth; ++i) {
+      if (!ReadResponse()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Wait until the server closes the connection.
+  // Return false if any unexpected data is received.
+  bool WaitClosed() {
+    char buf[1024];
+    boost::system::error_code ec;
+    std::size_t length = socket_.read_some(boost::asio::buffer(buf), ec);
+    return ec && length == 0;
+  }
+
+private:
+  bool ReadResponse() {
+    std::size_t headers_end = std::string::npos;
+    while ((headers_end = data_.find("\r\n\r\n")) == std::string::npos) {
+      if (!ReadSome()) {
+        return false;
+      }
+    }
+    headers_end += 4;
+
+    std::string headers = boost::to_lower_copy(data_.substr(0, headers_end));
+    data_.erase(0, headers_end);
+
+    if (headers.find("transfer-encoding: chunked") != std::string::npos) {
+      return SkipChunks();
+    }
+
+    std::size_t content_length = 0;
+    std::size_t pos = headers.find("content-length:");
+    if (pos != std::string::npos) {
+      content_length = std::strtoul(&headers[pos + 15], nullptr, 10);
+    }
+
+    return Skip(content_length);
+  }
+
+  // Skip the chunked body.
+  bool SkipChunks() {
+    while (true) {
+      std::size_t line_end = std::string::npos;
+      while ((line_end = data_.find("\r\n")) == std::string::npos) {
+        if (!ReadSome()) {
+          return false;
+        }
+      }
+
+      std::size_t chunk_size = std::strtoul(data_.c_str(), nullptr, 16);
+      data_.erase(0, line_end + 2);
+
+      // The chunk data and the CRLF after it, or the CRLF ending the body if
+      // it's the last chunk (no trailers expected).
+      if (!Skip(chunk_size + 2)) {
+        return false;
+      }
+
+      if (chunk_size == 0) {
+        return true;
+      }
+    }
+  }
+
+  // Skip the next |count| bytes without keeping them, they could be large
+  // (e.g., a file).
+  bool Skip(std::size_t count) {
+    std::size_t size = std::min(data_.size(), count);
+    data_.erase(0, size);
+    std::size_t remaining = count - size;
+
+    while (remaining > 0) {
+      std::size_t length = 0;
+      if (!ReadSome(&length)) {
+        return false;
+      }
+      size = std::min(length, remaining);
+      remaining -= size;
+      // Keep the data of the next (pipelined) response.
+      data_.append(buf_ + size, length - size);
+    }
+
+    return true;
+  }
+
+  bool ReadSome(std::size_t* length = nullptr) {
+    boost::system::error_code ec;
+    std::size_t size = socket_.read_some(boost::asio::buffer(buf_), ec);
+    if (ec) {
+      return false;
+    }
+    if (length != nullptr) {
+      *length = size;
+    } else {
+      data_.append(buf_, size);
+    }
+    return true;
+  }
+
+  boost::asio::io_context io_context_;
+  tcp::socket socket_;
+  std::string data_;
+  char buf_[64 * 1024];
+};
+
+// -----------------------------------------------------------------------------
+
+// Run the server in a background thread.
+class ServerRunner {
+public:
+  ServerRunner(webcc::Server* server, std::size_t workers, std::size_t loops)
+      : server_(server) {
+    thread_ = std::thread([this, workers, loops]() {
+      server_->Run(workers, loops);
+    });
+    WaitUntilReady();
+  }
+
+  ~ServerRunner() {
+    server_->Stop();
+    thread_.join();
+  }
+
+private:
+  // Wait until the server accepts connections.
+  void WaitUntilReady() {
+    for (int i = 0; i < 100; ++i) {
+      try {
+        LoadClient client(kPort);
+        return;
+      } catch (const boost::system::system_error&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      }
+    }
+    std::cerr << "The server doesn't seem to be running!" << std::endl;
+    std::exit(1);
+  }
+
+  webcc::Server* server_;
+  std::thread thread_;
+};
+
+// -----------------------------------------------------------------------------
+
+// Send the request from |clients| connections for |seconds| seconds.
+// Return the number of requests per second.
+double RunLoad(const std::string& request, std::size_t clients, int seconds,
+               std::size_t depth = 1) {
+  std::atomic<std::size_t> total{ 0 };
+  std::atomic<bool> stop{ false };
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < clients; ++i) {
+    threads.emplace_back([&]() {
+      std::size_t count = 0;
+      try {
+        LoadClient client(kPort);
+        while (!stop && client.Send(request, depth)) {
+          count += depth;
+        }
+      } catch (const boost::system::system_error& e) {
+        std::cerr << "Client error: " << e.what() << std::endl;
+      }
+      total += count;
+    });
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  stop = true;
+
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  return total / elapsed.count();
+}
+
+// -----------------------------------------------------------------------------
+
+// Compare the requests/sec of the shared and the sharded loops for 1, 2, 4,
+// ... up to the number of CPU cores.
+void BenchmarkSharding(int seconds, std::size_t clients_per_loop) {
+  std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+
+  std::printf("%8s %16s %16s\n", "loops", "shared (req/s)", "sharded (req/s)");
+
+  for (std::size_t loops = 1; loops <= cores; loops *= 2) {
+    double rps[2] = { 0.0, 0.0 };
+
+    for (int sharded = 0; sharded < 2; ++sharded) {
+      webcc::Server server(kPort);
+      server.Route("/hello", std::make_shared<HelloView>());
+      server.set_sharded(sharded != 0);
+
+      ServerRunner runner(&server, loops, loops);
+      rps[sharded] = RunLoad(kHelloRequest, loops * clients_per_loop, seconds);
+    }
+
+    std::printf("%8u %16.0f %16.0f\n", static_cast<unsigned>(loops), rps[0],
+                rps[1]);
+  }
+}
+
+// Send the request one after another from a single connection for |seconds|
+// seconds, return the latencies in microseconds.
+std::vector<double> MeasureLatency(const std::string& request, int seconds) {
+  std::vector<double> latencies;
+
+  LoadClient client(kPort);
+
+  auto end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+
+  while (std::chrono::steady_clock::now() < end) {
+    auto start = std::chrono::steady_clock::now();
+    if (!client.Send(request)) {
+      break;
+    }
+    std::chrono::duration<double, std::micro> latency =
+        std::chrono::steady_clock::now() - start;
+    latencies.push_back(latency.count());
+  }
+
+  return latencies;
+}
+
+// Compare the latencies of a trivial view handled by the worker threads
+// (queued) and by the loop thread (inline).
+void BenchmarkInline(int seconds, std::size_t workers) {
+  webcc::Server server(kPort);
+
+  auto view = std::make_shared<HealthView>();
+  server.Route("/health", view);
+  server.Route("/health/inline", view, { "GET" }, true);
+
+  ServerRunner runner(&server, workers, 1);
+
+  std::printf("%8s %10s %12s %12s %12s\n", "mode", "requests",
+              "mean (us)", "p50 (us)", "p99 (us)");
+
+  const char* modes[] = { "queued", "inline" };
+  const char* requests[] = { kHealthRequest, kHealthInlineRequest };
+
+  for (int i = 0; i < 2; ++i) {
+    auto latencies = MeasureLatency(requests[i], seconds);
+    if (latencies.empty()) {
+      std::cerr << "No response!" << std::endl;
+      continue;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+
+    double sum = 0.0;
+    for (double latency : latencies) {
+      sum += latency;
+    }
+
+    std::printf("%8s %10u %12.1f %12.1f %12.1f\n", modes[i],
+                static_cast<unsigned>(latencies.size()),
+                sum / latencies.size(), latencies[latencies.size() / 2],
+                latencies[latencies.size() * 99 / 100]);
+  }
+}
+
+// Compare the requests/sec of a view waiting for a slow backend, blocking the
+// worker thread (sync) or parking the request (async).
+void BenchmarkAsync(int seconds, std::size_t clients) {
+  const std::size_t kWorkers = 2;
+
+  // The io_context of the simulated backend.
+  boost::asio::io_context backend;
+  auto work = boost::asio::make_work_guard(backend);
+  std::thread backend_thread([&backend]() { backend.run(); });
+
+  std::printf("%8s %8s %8s %16s\n", "view", "workers", "clients",
+              "requests/sec");
+
+  for (int async = 0; async < 2; ++async) {
+    webcc::Server server(kPort);
+    if (async != 0) {
+      server.Route("/slow", std::make_shared<AsyncSlowView>(&backend));
+    } else {
+      server.Route("/slow", std::make_shared<SlowView>());
+    }
+
+    ServerRunner runner(&server, kWorkers, 1);
+    double rps = RunLoad(kSlowRequest, clients, seconds);
+
+    std::printf("%8s %8u %8u %16.0f\n", async != 0 ? "async" : "sync",
+                static_cast<unsigned>(kWorkers),
+                static_cast<unsigned>(clients), rps);
+  }
+
+  work.reset();
+  backend_thread.join();
+}
+
+// Compare the requests/sec of a single keep-alive connection with different
+// pipelining depths.
+void BenchmarkPipeline(int seconds, std::size_t workers) {
+  webcc::Server server(kPort);
+  server.Route("/health", std::make_shared<HealthView>());
+
+  ServerRunner runner(&server, workers, 1);
+
+  std::printf("%8s %16s\n", "depth", "requests/sec");
+
+  for (std::size_t depth = 1; depth <= 64; depth *= 4) {
+    double rps = RunLoad(kHealthRequest, 1, seconds, depth);
+    std::printf("%8u %16.0f\n", static_cast<unsigned>(depth), rps);
+  }
+}
+
+// Open |clients| keep-alive connections, each sends one request then idles.
+// Measure how long it takes the server to close them all by the idle timeout,
+// and the CPU time the process spends meanwhile.
+void BenchmarkIdle(int idle_timeout, std::size_t clients) {
+  webcc::Server server(kPort);
+  server.Route("/health", std::make_shared<HealthView>());
+  server.set_idle_timeout(idle_timeout);
+
+  ServerRunner runner(&server, 1, 1);
+
+  std::vector<std::unique_ptr<LoadClient>> load_clients;
+  for (std::size_t i = 0; i < clients; ++i) {
+    load_clients.emplace_back(new LoadClient{ kPort });
+    if (!load_clients.back()->Send(kHealthRequest)) {
+      std::cerr << "Failed to send request!" << std::endl;
+      return;
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::clock_t cpu_start = std::clock();
+
+  std::size_t closed = 0;
+  for (auto& client : load_clients) {
+    if (client->WaitClosed()) {
+      ++closed;
+    }
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  double cpu = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+
+  std::printf("%u/%u idle connections closed in %.2fs (timeout: %ds), "
+              "CPU time: %.3fs\n",
+              static_cast<unsigned>(closed), static_cast<unsigned>(clients),
+              elapsed.count(), idle_timeout, cpu);
+}
+
+// Compare the throughput of serving a large static file with the chunked
+// payloads (the fallback) and with sendfile().
+void BenchmarkFile(int seconds, std::size_t clients) {
+  const std::size_t kFileSize = 100 * 1024 * 1024;
+
+  bfs::path doc_root = bfs::temp_directory_path() / bfs::unique_path();
+  bfs::create_directory(doc_root);
+
+  {
+    bfs::ofstream ofs(doc_root / "file.bin", std::ios::binary);
+    std::string block(1024 * 1024, 'x');
+    for (std::size_t i = 0; i < kFileSize / block.size(); ++i) {
+      ofs.write(block.data(), block.size());
+    }
+  }
+
+  const std::string request =
+      "GET /file.bin HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "\r\n";
+
+  std::printf("%10s %8s %12s %12s\n", "path", "clients", "requests/sec",
+              "MB/sec");
+
+  for (int sendfile = 0; sendfile < 2; ++sendfile) {
+    webcc::Server server(kPort, doc_root);
+    server.set_sendfile(sendfile != 0);
+
+    ServerRunner runner(&server, 1, 1);
+    double rps = RunLoad(request, clients, seconds);
+
+    std::printf("%10s %8u %12.2f %12.0f\n",
+                sendfile != 0 ? "sendfile" : "chunked",
+                static_cast<unsigned>(clients), rps,
+                rps * kFileSize / (1024 * 1024));
+  }
+
+  bfs::remove_all(doc_root);
+}
+
+// Count the write syscalls per response of different kinds of responses.
+// The views are routed as non-blocking so that all the writes are issued by
+// the loop thread.
+void BenchmarkWrites(std::size_t requests) {
+#if !defined(__linux__)
+  std::cerr << "Only supported on Linux." << std::endl;
+#else
+  const std::size_t kFileSize = 256 * 1024;
+
+  bfs::path doc_root = bfs::temp_directory_path() / bfs::unique_path();
+  bfs::create_directory(doc_root);
+  {
+    bfs::ofstream ofs(doc_root / "file.bin", std::ios::binary);
+    std::string data(kFileSize, 'x');
+    ofs.write(data.data(), data.size());
+  }
+
+  struct Case {
+    const char* name;
+    const char* url;
+    bool sendfile;
+  };
+
+  const Case cases[] = {
+    { "health", "/health", true },
+    { "json 100B", "/json/small", true },
+    { "json 64KB", "/json/large", true },
+    { "file 256KB", "/file.bin", false },
+    { "file 256KB", "/file.bin", true },
+  };
+
+  std::printf("%12s %10s %10s %14s\n", "response", "sendfile", "requests",
+              "writes/request");
+
+  // Only count the writes of the server threads.
+  IgnoreWritesInThisThread();
+
+  for (const Case& c : cases) {
+    webcc::Server server(kPort, doc_root);
+    server.Route("/health", std::make_shared<HealthView>(), { "GET" }, true);
+    server.Route("/json/small", std::make_shared<JsonView>(100), { "GET" },
+                 true);
+    server.Route("/json/large", std::make_shared<JsonView>(64 * 1024),
+                 { "GET" }, true);
+    server.set_file_chunk_size(16 * 1024);
+    server.set_sendfile(c.sendfile);
+
+    ServerRunner runner(&server, 1, 1);
+
+    std::string request = std::string("GET ") + c.url +
+                          " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+    LoadClient client(kPort);
+
+    g_write_syscalls = 0;
+    std::size_t count = 0;
+    for (; count < requests && client.Send(request); ++count) {
+    }
+
+    std::printf("%12s %10s %10u %14.2f\n", c.name,
+                c.sendfile ? "on" : "off", static_cast<unsigned>(count),
+                count > 0 ? static_cast<double>(g_write_syscalls) / count
+                          : 0.0);
+  }
+
+  bfs::remove_all(doc_root);
+#endif  // defined(__linux__)
+}
+
+// Get the peak resident set size (KB) of the process.
+long GetPeakRss() {
+#if defined(__linux__)
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+#else
+  return 0;
+#endif
+}
+
+// Compare the peak memory of exporting a large JSON (about 100MB) built as a
+// whole VS. streamed with the chunked transfer coding.
+// The streamed one goes first since the peak memory never goes down.
+void BenchmarkStream(int seconds, std::size_t clients) {
+  const std::size_t kRows = 1000 * 1000;
+
+  std::printf("%10s %8s %12s %14s\n", "body", "clients", "requests/sec",
+              "peak RSS (MB)");
+
+  for (int stream = 1; stream >= 0; --stream) {
+    webcc::Server server(kPort);
+    server.Route("/export", std::make_shared<ExportView>(kRows, stream != 0));
+
+    ServerRunner runner(&server, clients, 1);
+
+    const std::string request =
+        "GET /export HTTP/1.1\r\n"
+        "Host: localhost\r\n"
+        "\r\n";
+
+    double rps = RunLoad(request, clients, seconds);
+
+    std::printf("%10s %8u %12.2f %14.1f\n", stream != 0 ? "stream" : "string",
+                static_cast<unsigned>(clients), rps, GetPeakRss() / 1024.0);
+  }
+}
+
+// Each client connects, sends a single request asking for "Connection: Close"
+// and waits until the server closes the connection, again and again, for
+// |seconds| seconds. Return the number of connections per second.
+double RunChurn(const std::string& request, std::size_t clients, int seconds) {
+  std::atomic<std::size_t> total{ 0 };
+  std::atomic<bool> stop{ false };
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < clients; ++i) {
+    threads.emplace_back([&]() {
+      std::size_t count = 0;
+      try {
+        while (!stop) {
+          LoadClient client(kPort);
+          if (!client.Send(request) || !client.WaitClosed()) {
+            break;
+          }
+          ++count;
+        }
+      } catch (const boost::system::system_error& e) {
+        std::cerr << "Client error: " << e.what() << std::endl;
+      }
+      total += count;
+    });
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  stop = true;
+
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  return total / elapsed.count();
+}
+
+// Short-lived connections with a request each, to a trivial view and to a URL
+// not found (a status-only response).
+void BenchmarkChurn(int seconds, std::size_t clients) {
+  webcc::Server server(kPort);
+  server.Route("/health", std::make_shared<HealthView>(), { "GET" }, true);
+
+  ServerRunner runner(&server, 1, 1);
+
+  std::printf("%10s %8s %12s\n", "url", "clients", "conns/sec");
+
+  const char* urls[] = { "/health", "/missing" };
+
+  for (const char* url : urls) {
+    const std::string request = std::string{ "GET " } + url +
+                                " HTTP/1.1\r\n"
+                                "Host: localhost\r\n"
+                                "Connection: Close\r\n"
+                                "\r\n";
+
+    double cps = RunChurn(request, clients, seconds);
+
+    std::printf("%10s %8u %12.0f\n", url, static_cast<unsigned>(clients), cps);
+  }
+}
+
+#if defined(__linux__)
+
+// Get the current resident memory (in KB) of the process.
+long GetCurrentRss() {
+  long pages = 0;
+  std::FILE* file = std::fopen("/proc/self/statm", "r");
+  if (file != nullptr) {
+    if (std::fscanf(file, "%*s %ld", &pages) != 1) {
+      pages = 0;
+    }
+    std::fclose(file);
+  }
+  return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// Connect with a plain socket, which costs the client no user space memory,
+// send the request and read the response (without a body).
+// Return the socket, or -1 on any error.
+int ConnectAndSend(const char* request) {
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd == -1) {
+    return -1;
+  }
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(kPort);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  std::size_t size = std::strlen(request);
+
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      ::send(fd, request, size, 0) != static_cast<ssize_t>(size)) {
+    ::close(fd);
+    return -1;
+  }
+
+  std::string response;
+  char buf[1024];
+  while (response.find("\r\n\r\n") == std::string::npos) {
+    ssize_t length = ::recv(fd, buf, sizeof(buf), 0);
+    if (length <= 0) {
+      ::close(fd);
+      return -1;
+    }
+    response.append(buf, length);
+  }
+
+  return fd;
+}
+
+// Open |clients| keep-alive connections, each sends a request then idles, and
+// measure the memory the server spends per idle connection.
+void RunSoak(std::size_t clients, bool pooled) {
+  webcc::Server server(kPort);
+  server.Route("/health", std::make_shared<HealthView>());
+  server.set_pooled_read_buffers(pooled);
+
+  ServerRunner runner(&server, 1, 1);
+
+  // Warm up, e.g., the canned responses, the allocator.
+  ::close(ConnectAndSend(kHealthRequest));
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  long rss = GetCurrentRss();
+
+  std::vector<int> fds;
+  for (std::size_t i = 0; i < clients; ++i) {
+    int fd = ConnectAndSend(kHealthRequest);
+    if (fd == -1) {
+      std::cerr << "Failed to send request!" << std::endl;
+      break;
+    }
+    fds.push_back(fd);
+  }
+
+  // Let the connections settle down to wait for the next requests.
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  long growth = GetCurrentRss() - rss;
+
+  std::printf("%10s %12u %14.1f %14.2f\n", pooled ? "pooled" : "dedicated",
+              static_cast<unsigned>(fds.size()), growth / 1024.0,
+              fds.empty() ? 0.0 : static_cast<double>(growth) / fds.size());
+
+  for (int fd : fds) {
+    ::close(fd);
+  }
+}
+
+#endif  // defined(__linux__)
+
+// Compare the memory per idle keep-alive connection of the dedicated read
+// buffers and the pooled ones. Linux only.
+void BenchmarkSoak(std::size_t clients) {
+#if defined(__linux__)
+  // A connection takes a file descriptor of the client and one of the server.
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    if (clients * 2 + 64 > limit.rlim_cur) {
+      clients = (limit.rlim_cur - 64) / 2;
+    }
+  }
+
+  std::printf("%10s %12s %14s %14s\n", "buffers", "connections",
+              "RSS growth (MB)", "KB/connection");
+
+  // Each runs in a child process, so that the memory freed by one doesn't
+  // make up for the other.
+  for (int pooled = 0; pooled < 2; ++pooled) {
+    std::fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+      RunSoak(clients, pooled != 0);
+      std::fflush(stdout);
+      _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+  }
+#else
+  std::cerr << "Not supported!" << std::endl;
+#endif  // defined(__linux__)
+}
+
+void Help() {
+  std::cout << "Usage: server_benchmark <scenario> [seconds] [clients]"
+            << std::endl;
+  std::cout << "Scenarios:" << std::endl;
+  std::cout << "  sharding  Shared VS. sharded loops per core count "
+               "(clients per loop)." << std::endl;
+  std::cout << "  inline    Latency of a trivial view, queued VS. handled "
+               "inline (clients as workers)." << std::endl;
+  std::cout << "  async     A view waiting for a slow backend, sync VS. async "
+               "(clients)." << std::endl;
+  std::cout << "  pipeline  Pipelined requests over a single connection "
+               "(clients as workers)." << std::endl;
+  std::cout << "  idle      Idle keep-alive connections closed by the idle "
+               "timeout (seconds as timeout, clients)." << std::endl;
+  std::cout << "  file      A 100MB static file, chunked VS. sendfile "
+               "(clients)." << std::endl;
+  std::cout << "  writes    Write syscalls per response (seconds as the "
+               "number of requests)." << std::endl;
+  std::cout << "  stream    Peak memory of a 100MB JSON export, string VS. "
+               "stream (clients)." << std::endl;
+  std::cout << "  churn     Short-lived connections with a request each "
+               "(clients)." << std::endl;
+  std::cout << "  soak      Memory per idle keep-alive connection, dedicated "
+               "VS. pooled read buffers (clients)." << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  if (argc < 2) {
+    Help();
+    return 1;
+  }
+
+  WEBCC_LOG_INIT("", webcc::LOG_CONSOLE);
+
+  std::string scenario = argv[1];
+  int seconds = argc > 2 ? std::atoi(argv[2]) : 5;
+  std::size_t clients = argc > 3 ? std::atoi(argv[3]) : 4;
+
+  if (scenario == "sharding") {
+    BenchmarkSharding(seconds, clients);
+  } else if (scenario == "inline") {
+    BenchmarkInline(seconds, clients);
+  } else if (scenario == "async") {
+    BenchmarkAsync(seconds, clients);
+  } else if (scenario == "pipeline") {
+    BenchmarkPipeline(seconds, clients);
+  } else if (scenario == "idle") {
+    BenchmarkIdle(seconds, clients);
+  } else if (scenario == "file") {
+    BenchmarkFile(seconds, clients);
+  } else if (scenario == "writes") {
+    BenchmarkWrites(seconds);
+  } else if (scenario == "stream") {
+    BenchmarkStream(seconds, clients);
+  } else if (scenario == "churn") {
+    BenchmarkChurn(seconds, clients);
+  } else if (scenario == "soak") {
+    BenchmarkSoak(clients);
+  } else {
+    Help();
+    return 1;
+  }
+
+  return 0;
+}
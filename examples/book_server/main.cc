@@ -49,11 +49,11 @@ int main(int argc, char* argv[]) {
                  std::make_shared<BookListView>(),
                  { "GET", "POST" });
 
-    server.Route(webcc::R("/books/(\\d+)"),
+    server.Route("/books/{id:int}",
                  std::make_shared<BookDetailView>(photo_dir),
                  { "GET", "PUT", "DELETE" });
 
-    server.Route(webcc::R("/books/(\\d+)/photo"),
+    server.Route("/books/{id:int}/photo",
                  std::make_shared<BookPhotoView>(photo_dir),
                  { "GET", "PUT", "DELETE" });
 
@@ -0,0 +1,77 @@
+// A server with coroutine views (WEBCC_ENABLE_COROUTINE).
+// - /delay waits for a timer before responding.
+// - /proxy requests /delay from this server itself and forwards the result.
+// Neither blocks any thread, so one loop thread and one worker can serve
+// thousands of them at the same time.
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "boost/asio/steady_timer.hpp"
+#include "boost/asio/this_coro.hpp"
+#include "boost/asio/use_awaitable.hpp"
+
+#include "webcc/async_client.h"
+#include "webcc/coroutine_view.h"
+#include "webcc/logger.h"
+#include "webcc/request_builder.h"
+#include "webcc/response_builder.h"
+#include "webcc/server.h"
+
+class DelayView : public webcc::CoroutineView {
+public:
+  boost::asio::awaitable<webcc::ResponsePtr> CoHandle(
+      webcc::RequestPtr request) override {
+    auto executor = co_await boost::asio::this_coro::executor;
+
+    boost::asio::steady_timer timer(executor, std::chrono::milliseconds(100));
+    co_await timer.async_wait(boost::asio::use_awaitable);
+
+    co_return webcc::ResponseBuilder{}.OK().Body("Hello, World!")();
+  }
+};
+
+class ProxyView : public webcc::CoroutineView {
+public:
+  explicit ProxyView(std::uint16_t port) : port_(port) {
+  }
+
+  boost::asio::awaitable<webcc::ResponsePtr> CoHandle(
+      webcc::RequestPtr request) override {
+    auto url = "http://localhost:" + std::to_string(port_) + "/delay";
+
+    auto r = co_await webcc::AsyncRequest(
+        webcc::RequestBuilder{}.Get(url)());
+
+    co_return webcc::ResponseBuilder{}.OK().Body("Proxy: " + r->data())();
+  }
+
+private:
+  std::uint16_t port_;
+};
+
+int main(int argc, const char* argv[]) {
+  WEBCC_LOG_INIT("", webcc::LOG_CONSOLE);
+
+  std::uint16_t port = 8080;
+  if (argc > 1) {
+    port = static_cast<std::uint16_t>(std::stoi(argv[1]));
+  }
+
+  try {
+    webcc::Server server(port);
+
+    // Route as non-blocking to start the coroutines in the loop thread.
+    server.Route("/delay", std::make_shared<DelayView>(), { "GET" }, true);
+    server.Route("/proxy", std::make_shared<ProxyView>(port), { "GET" }, true);
+
+    server.Run();
+
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -1,5 +1,6 @@
 // A general HTTP server serving static files.
 
+#include <cstring>
 #include <iostream>
 #include <string>
 
@@ -9,11 +10,15 @@
 int main(int argc, char* argv[]) {
   if (argc < 3) {
     std::cout << "usage: file_server <port> <doc_root> [chunk_size]"
-              << std::endl;
+              << " [--precompress]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "  --precompress: generate the missing gzip sidecars (.gz) of"
+              << " the files under the doc root" << std::endl;
     std::cout << std::endl;
     std::cout << "examples:" << std::endl;
     std::cout << "  $ file_server 8080 D:/www" << std::endl;
     std::cout << "  $ file_server 8080 D:/www 10000" << std::endl;
+    std::cout << "  $ file_server 8080 D:/www --precompress" << std::endl;
     return 1;
   }
 
@@ -22,12 +27,35 @@ int main(int argc, char* argv[]) {
   std::uint16_t port = static_cast<std::uint16_t>(std::atoi(argv[1]));
   std::string doc_root = argv[2];
 
+  int chunk_size = 0;
+  bool precompress = false;
+  for (int i = 3; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--precompress") == 0) {
+      precompress = true;
+    } else {
+      chunk_size = std::atoi(argv[i]);
+    }
+  }
+
   try {
     webcc::Server server(port, doc_root);
 
-    if (argc == 4) {
-      server.set_file_chunk_size(std::atoi(argv[3]));
+    if (chunk_size > 0) {
+      server.set_file_chunk_size(chunk_size);
+    }
+
+    // Cache the hot files (up to 64MB) in the memory.
+    server.set_file_cache(64 * 1024 * 1024);
+
+    // Serve the precompressed files (e.g., "app.js.gz").
+    server.set_precompressed(true);
+
+#if WEBCC_ENABLE_GZIP
+    // Writing the sidecars into the doc root is up to the user.
+    if (precompress) {
+      server.PrecompressStatic();
     }
+#endif
 
     server.Run();
 
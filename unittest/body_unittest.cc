@@ -1,5 +1,8 @@
 #include "gtest/gtest.h"
 
+#include "boost/filesystem/fstream.hpp"
+#include "boost/filesystem/operations.hpp"
+
 #include "webcc/body.h"
 
 TEST(FormBodyTest, Payload) {
@@ -17,3 +20,99 @@ TEST(FormBodyTest, Payload) {
   payload = form_body.NextPayload();
   EXPECT_TRUE(payload.empty());
 }
+
+// -----------------------------------------------------------------------------
+
+class FileRangeTest : public testing::Test {
+protected:
+  void SetUp() override {
+    path_ = boost::filesystem::temp_directory_path() /
+            boost::filesystem::unique_path();
+    boost::filesystem::ofstream ofs(path_, std::ios::binary);
+    ofs << "0123456789";
+  }
+
+  void TearDown() override {
+    boost::filesystem::remove(path_);
+  }
+
+  // Iterate the payloads of the body into a string.
+  static std::string ReadAll(webcc::Body* body) {
+    std::string data;
+    body->InitPayload();
+    for (auto p = body->NextPayload(); !p.empty(); p = body->NextPayload()) {
+      for (auto& b : p) {
+        data.append(static_cast<const char*>(b.data()), b.size());
+      }
+    }
+    return data;
+  }
+
+  boost::filesystem::path path_;
+};
+
+TEST_F(FileRangeTest, FileBody) {
+  webcc::FileBody body{ path_, std::size_t(4) };
+  body.SetRange(3, 6);
+
+  EXPECT_EQ(6, body.GetSize());
+  EXPECT_EQ(3, body.offset());
+  EXPECT_EQ("345678", ReadAll(&body));
+}
+
+TEST_F(FileRangeTest, ByteRangesBody) {
+  std::vector<webcc::ByteRange> ranges(2);
+  ranges[0].first = 0;
+  ranges[0].last = 1;
+  ranges[1].first = 8;
+  ranges[1].last = 9;
+
+  webcc::ByteRangesBody body{ path_, 10, ranges, "text/plain", "XYZ", 4 };
+
+  const std::string expected =
+      "--XYZ\r\n"
+      "Content-Type: text/plain\r\n"
+      "Content-Range: bytes 0-1/10\r\n"
+      "\r\n"
+      "01\r\n"
+      "--XYZ\r\n"
+      "Content-Type: text/plain\r\n"
+      "Content-Range: bytes 8-9/10\r\n"
+      "\r\n"
+      "89\r\n"
+      "--XYZ--\r\n";
+
+  EXPECT_EQ(expected.size(), body.GetSize());
+  EXPECT_EQ(expected, ReadAll(&body));
+}
+
+// -----------------------------------------------------------------------------
+
+TEST(StreamBodyTest, Payload) {
+  int count = 0;
+  webcc::StreamBody body{ [&count](std::string* data) {
+    if (count == 3) {
+      return false;
+    }
+    // An empty piece is skipped.
+    if (count++ != 1) {
+      *data = "abc";
+    }
+    return true;
+  } };
+
+  EXPECT_EQ(webcc::kInvalidLength, body.GetSize());
+  EXPECT_FALSE(body.IsEmpty());
+
+  body.InitPayload();
+
+  std::size_t pieces = 0;
+  for (auto p = body.NextPayload(); !p.empty(); p = body.NextPayload()) {
+    EXPECT_EQ(3, boost::asio::buffer_size(p));
+    ++pieces;
+  }
+  EXPECT_EQ(2, pieces);
+
+  // Ended.
+  EXPECT_TRUE(body.NextPayload().empty());
+}
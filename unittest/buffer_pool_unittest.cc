@@ -0,0 +1,30 @@
+#include "gtest/gtest.h"
+
+#include <set>
+
+#include "webcc/buffer_pool.h"
+
+TEST(BufferPoolTest, Slabs) {
+  webcc::BufferPool pool{ 1024, 4 };
+  EXPECT_EQ(0, pool.capacity());
+
+  std::set<char*> buffers;
+  for (int i = 0; i < 4; ++i) {
+    buffers.insert(pool.Acquire());
+  }
+
+  // All from the first slab, no overlaps.
+  EXPECT_EQ(4, buffers.size());
+  EXPECT_EQ(4, pool.capacity());
+  EXPECT_EQ(0, pool.free_size());
+  EXPECT_EQ(3 * 1024, *buffers.rbegin() - *buffers.begin());
+
+  char* buffer = pool.Acquire();
+  EXPECT_EQ(8, pool.capacity());
+  EXPECT_EQ(3, pool.free_size());
+
+  // Reused once released.
+  pool.Release(buffer);
+  EXPECT_EQ(buffer, pool.Acquire());
+  EXPECT_EQ(8, pool.capacity());
+}
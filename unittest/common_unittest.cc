@@ -0,0 +1,197 @@
+#include "gtest/gtest.h"
+
+#include "webcc/common.h"
+
+// -----------------------------------------------------------------------------
+
+TEST(RangeTest, FirstLast) {
+  webcc::Range range("bytes=0-499", 1000);
+
+  EXPECT_TRUE(range.valid());
+  EXPECT_TRUE(range.satisfiable());
+  ASSERT_EQ(1, range.ranges().size());
+  EXPECT_EQ(0, range.ranges()[0].first);
+  EXPECT_EQ(499, range.ranges()[0].last);
+  EXPECT_EQ(500, range.ranges()[0].length());
+}
+
+TEST(RangeTest, OpenEnded) {
+  webcc::Range range("bytes=900-", 1000);
+
+  EXPECT_TRUE(range.valid());
+  ASSERT_EQ(1, range.ranges().size());
+  EXPECT_EQ(900, range.ranges()[0].first);
+  EXPECT_EQ(999, range.ranges()[0].last);
+}
+
+TEST(RangeTest, LastBeyondSize) {
+  webcc::Range range("bytes=900-2000", 1000);
+
+  EXPECT_TRUE(range.valid());
+  ASSERT_EQ(1, range.ranges().size());
+  EXPECT_EQ(999, range.ranges()[0].last);
+}
+
+TEST(RangeTest, Suffix) {
+  webcc::Range range("bytes=-100", 1000);
+
+  EXPECT_TRUE(range.valid());
+  ASSERT_EQ(1, range.ranges().size());
+  EXPECT_EQ(900, range.ranges()[0].first);
+  EXPECT_EQ(999, range.ranges()[0].last);
+
+  // The suffix is larger than the size.
+  webcc::Range range2("bytes=-2000", 1000);
+  ASSERT_EQ(1, range2.ranges().size());
+  EXPECT_EQ(0, range2.ranges()[0].first);
+  EXPECT_EQ(999, range2.ranges()[0].last);
+}
+
+TEST(RangeTest, Multiple) {
+  webcc::Range range("bytes=0-99, 200-299,,-100", 1000);
+
+  EXPECT_TRUE(range.valid());
+  ASSERT_EQ(3, range.ranges().size());
+  EXPECT_EQ(200, range.ranges()[1].first);
+  EXPECT_EQ(299, range.ranges()[1].last);
+  EXPECT_EQ(900, range.ranges()[2].first);
+}
+
+TEST(RangeTest, Unsatisfiable) {
+  webcc::Range range("bytes=1000-", 1000);
+  EXPECT_TRUE(range.valid());
+  EXPECT_FALSE(range.satisfiable());
+
+  webcc::Range range2("bytes=-0", 1000);
+  EXPECT_TRUE(range2.valid());
+  EXPECT_FALSE(range2.satisfiable());
+
+  // The satisfiable ones are kept.
+  webcc::Range range3("bytes=2000-3000, 0-0", 1000);
+  EXPECT_TRUE(range3.valid());
+  ASSERT_EQ(1, range3.ranges().size());
+  EXPECT_EQ(1, range3.ranges()[0].length());
+}
+
+TEST(RangeTest, Invalid) {
+  EXPECT_FALSE(webcc::Range("", 1000).valid());
+  EXPECT_FALSE(webcc::Range("bytes=", 1000).valid());
+  EXPECT_FALSE(webcc::Range("items=0-1", 1000).valid());
+  EXPECT_FALSE(webcc::Range("bytes=abc", 1000).valid());
+  EXPECT_FALSE(webcc::Range("bytes=1-0", 1000).valid());
+  EXPECT_FALSE(webcc::Range("bytes=-", 1000).valid());
+  EXPECT_FALSE(webcc::Range("bytes=0x10-", 1000).valid());
+  EXPECT_FALSE(webcc::Range("bytes=99999999999999999999-", 1000).valid());
+}
+
+TEST(RangeTest, Overlapping) {
+  // More bytes than the file, e.g., a DoS attempt.
+  EXPECT_FALSE(webcc::Range("bytes=0-999, 0-999", 1000).valid());
+
+  std::string many = "bytes=0-0";
+  for (int i = 1; i < 100; ++i) {
+    many += "," + std::to_string(i) + "-" + std::to_string(i);
+  }
+  EXPECT_FALSE(webcc::Range(many, 1000).valid());
+}
+
+TEST(RangeTest, ContentRange) {
+  webcc::ByteRange range;
+  range.first = 0;
+  range.last = 499;
+
+  EXPECT_EQ("bytes 0-499/1234", webcc::Range::ContentRange(range, 1234));
+  EXPECT_EQ("bytes */1234", webcc::Range::ContentRange(1234));
+}
+
+// -----------------------------------------------------------------------------
+
+TEST(HeadersTest, CaseInsensitive) {
+  webcc::Headers headers;
+  headers.Set("Content-Type", "text/plain");
+  headers.Set("X-Request-Id", "1");
+
+  EXPECT_TRUE(headers.Has("content-type"));
+  EXPECT_TRUE(headers.Has("CONTENT-TYPE"));
+  EXPECT_EQ("1", headers.Get("x-request-id"));
+
+  bool existed = true;
+  EXPECT_EQ("", headers.Get("Content-Length", &existed));
+  EXPECT_FALSE(existed);
+
+  // Replace the value, the name is kept as it was set first.
+  headers.Set("content-type", "text/html");
+  EXPECT_EQ(2, headers.size());
+  EXPECT_EQ("Content-Type", headers.Get(0).first);
+  EXPECT_EQ("text/html", headers.Get(0).second);
+}
+
+TEST(HeadersTest, InsertionOrder) {
+  webcc::Headers headers;
+  headers.Set("Zzz", "1");
+  headers.Set(webcc::headers::kHost, "localhost");
+  headers.Set("Aaa", "2");
+
+  ASSERT_EQ(3, headers.size());
+  EXPECT_EQ("Zzz", headers.Get(0).first);
+  EXPECT_EQ("Host", headers.Get(1).first);
+  EXPECT_EQ("Aaa", headers.Get(2).first);
+}
+
+TEST(HeadersTest, ClearAndReuse) {
+  webcc::Headers headers;
+  headers.Set("X-Long-Header-Name", "a long value of the header");
+  headers.Set(webcc::headers::kHost, "localhost");
+
+  headers.Clear();
+  EXPECT_TRUE(headers.empty());
+  EXPECT_FALSE(headers.Has(webcc::HeaderId::kHost));
+  EXPECT_TRUE(headers.begin() == headers.end());
+
+  headers.Assign("Connection", "close");
+  ASSERT_EQ(1, headers.size());
+  EXPECT_EQ("Connection", headers.Get(0).first);
+  EXPECT_EQ("close", headers.Get(webcc::HeaderId::kConnection));
+  EXPECT_FALSE(headers.Has("X-Long-Header-Name"));
+
+  std::size_t count = 0;
+  for (const webcc::Header& header : headers) {
+    EXPECT_EQ("Connection", header.first);
+    ++count;
+  }
+  EXPECT_EQ(1, count);
+}
+
+TEST(HeadersTest, WellKnownId) {
+  webcc::Headers headers;
+  headers.Set("connection", "Keep-Alive");
+  headers.Set("X-Connection", "close");
+
+  EXPECT_TRUE(headers.Has(webcc::HeaderId::kConnection));
+  EXPECT_EQ("Keep-Alive", headers.Get(webcc::HeaderId::kConnection));
+  EXPECT_FALSE(headers.Has(webcc::HeaderId::kContentLength));
+
+  headers.Clear();
+  EXPECT_FALSE(headers.Has(webcc::HeaderId::kConnection));
+}
+
+TEST(HeadersTest, ToHeaderId) {
+  using webcc::HeaderId;
+  using webcc::HashHeaderName;
+  using webcc::ToHeaderId;
+
+  // The hash computed at compile time equals the one at runtime.
+  static_assert(HashHeaderName("Content-Length") ==
+                    HashHeaderName("content-length"),
+                "Case-insensitive hash");
+  EXPECT_EQ(HashHeaderName(webcc::headers::kContentLength),
+            HashHeaderName(boost::string_view{ "CONTENT-LENGTH" }));
+
+  EXPECT_EQ(HeaderId::kETag, ToHeaderId("etag", HashHeaderName("etag")));
+  EXPECT_EQ(HeaderId::kVary, ToHeaderId("Vary", HashHeaderName("Vary")));
+  EXPECT_EQ(HeaderId::kOther,
+            ToHeaderId("Cookie", HashHeaderName("Cookie")));
+
+  // The same hash but another name.
+  EXPECT_EQ(HeaderId::kOther, ToHeaderId("Cookie", HashHeaderName("Host")));
+}
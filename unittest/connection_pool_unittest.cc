@@ -0,0 +1,62 @@
+#include "gtest/gtest.h"
+
+#include "boost/asio/io_context.hpp"
+
+#include "webcc/connection_pool.h"
+
+using boost::asio::ip::tcp;
+
+class ConnectionPoolTest : public testing::Test {
+protected:
+  ConnectionPoolTest()
+      : timer_wheel_(std::make_shared<webcc::TimerWheel>(io_context_)) {
+  }
+
+  webcc::Connection* NewConnection() {
+    return new webcc::Connection(
+        tcp::socket{ io_context_ }, &pool_, &queue_,
+        [](webcc::Request*, bool*, bool*) { return false; },
+        [](webcc::ConnectionPtr) {}, timer_wheel_, &settings_);
+  }
+
+  boost::asio::io_context io_context_;
+  webcc::TimerWheelPtr timer_wheel_;
+  webcc::ConnectionQueue queue_;
+  webcc::ConnectionSettings settings_;
+  webcc::ConnectionPool pool_;
+};
+
+TEST_F(ConnectionPoolTest, Reuse) {
+  tcp::socket socket{ io_context_ };
+
+  // Nothing to reuse yet.
+  EXPECT_EQ(nullptr, pool_.Reuse(socket));
+
+  webcc::Connection* raw = NewConnection();
+  webcc::ConnectionPtr connection = pool_.Adopt(raw);
+  EXPECT_EQ(0, pool_.free_size());
+
+  // Released to the pool instead of being deleted.
+  connection.reset();
+  EXPECT_EQ(1, pool_.free_size());
+
+  connection = pool_.Reuse(socket);
+  EXPECT_EQ(raw, connection.get());
+  EXPECT_EQ(0, pool_.free_size());
+
+  // Shared again with a new owner.
+  EXPECT_EQ(connection, connection->shared_from_this());
+
+  connection.reset();
+  EXPECT_EQ(1, pool_.free_size());
+}
+
+// The connections released after the pool is gone are deleted.
+TEST_F(ConnectionPoolTest, OutlivePool) {
+  webcc::ConnectionPtr connection;
+  {
+    webcc::ConnectionPool pool;
+    connection = pool.Adopt(NewConnection());
+  }
+  connection.reset();
+}
@@ -0,0 +1,203 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <string>
+
+#include "boost/filesystem/fstream.hpp"
+#include "boost/filesystem/operations.hpp"
+
+#include "webcc/file_cache.h"
+
+namespace bfs = boost::filesystem;
+
+using std::chrono::milliseconds;
+
+using webcc::FileCache;
+
+class FileCacheTest : public testing::Test {
+protected:
+  void SetUp() override {
+    dir_ = bfs::temp_directory_path() / bfs::unique_path();
+    bfs::create_directories(dir_);
+  }
+
+  void TearDown() override {
+    bfs::remove_all(dir_);
+  }
+
+  bfs::path Write(const std::string& name, const std::string& data) {
+    bfs::path path = dir_ / name;
+    bfs::ofstream ofs(path, std::ios::binary);
+    ofs << data;
+    return path;
+  }
+
+  bfs::path dir_;
+};
+
+TEST_F(FileCacheTest, Get) {
+  webcc::FileCache cache(1024);
+
+  auto path = Write("index.html", "hello");
+
+  auto file = cache.Get(path);
+  ASSERT_NE(nullptr, file);
+  ASSERT_NE(nullptr, file->data);
+  EXPECT_EQ("hello", *file->data);
+  EXPECT_EQ(5, file->size);
+  EXPECT_EQ("text/html", file->media_type);
+  EXPECT_FALSE(file->etag.empty());
+  EXPECT_FALSE(file->last_modified.empty());
+
+  EXPECT_EQ(1, cache.Size());
+  EXPECT_EQ(5 + FileCache::kEntryOverhead, cache.Bytes());
+
+  // The same file is returned from the cache.
+  EXPECT_EQ(file, cache.Get(path));
+  EXPECT_EQ(file, cache.Find(path));
+}
+
+// Match the file without loading it, then load it later.
+TEST_F(FileCacheTest, MatchAndLoad) {
+  webcc::FileCache cache(1024);
+
+  auto path = Write("index.html", "hello");
+
+  auto file = cache.Match(path);
+  ASSERT_NE(nullptr, file);
+  EXPECT_EQ(nullptr, file->data);
+  EXPECT_EQ(5, file->size);
+  EXPECT_EQ(0, cache.Size());
+
+  auto loaded = cache.Load(path, file);
+  ASSERT_NE(nullptr, loaded->data);
+  EXPECT_EQ("hello", *loaded->data);
+  EXPECT_EQ(file->etag, loaded->etag);
+  EXPECT_EQ(1, cache.Size());
+
+  // Cached now.
+  EXPECT_EQ(loaded, cache.Match(path));
+  EXPECT_EQ(loaded, cache.Load(path, loaded));
+
+  EXPECT_EQ(nullptr, cache.Match(dir_ / "none.html"));
+}
+
+TEST_F(FileCacheTest, NotFound) {
+  webcc::FileCache cache(1024);
+
+  EXPECT_EQ(nullptr, cache.Get(dir_ / "none.html"));
+  EXPECT_EQ(nullptr, cache.Find(dir_ / "none.html"));
+
+  // A directory is not a static file.
+  EXPECT_EQ(nullptr, cache.Get(dir_));
+
+  EXPECT_EQ(0, cache.Size());
+}
+
+TEST_F(FileCacheTest, Disabled) {
+  webcc::FileCache cache(0);
+
+  auto path = Write("index.html", "hello");
+
+  auto file = cache.Get(path);
+  ASSERT_NE(nullptr, file);
+  EXPECT_EQ(nullptr, file->data);
+  EXPECT_EQ(5, file->size);
+
+  EXPECT_EQ(0, cache.Size());
+  EXPECT_EQ(nullptr, cache.Find(path));
+
+  // Even an empty file.
+  auto empty = Write("empty.txt", "");
+  EXPECT_NE(nullptr, cache.Get(empty));
+  EXPECT_EQ(0, cache.Size());
+}
+
+// The aliases of a path share the same entry.
+TEST_F(FileCacheTest, Aliases) {
+  webcc::FileCache cache(1024);
+
+  auto path = Write("e.txt", "");
+
+  auto file = cache.Get(path);
+  ASSERT_NE(nullptr, file);
+  EXPECT_EQ(file, cache.Get(dir_ / "//e.txt"));
+  EXPECT_EQ(file, cache.Get(dir_ / "." / "e.txt"));
+  EXPECT_EQ(file, cache.Get(dir_ / ".//./e.txt"));
+
+  EXPECT_EQ(1, cache.Size());
+  EXPECT_EQ(FileCache::kEntryOverhead, cache.Bytes());
+}
+
+// The empty files are charged the overhead, and evicted as the others.
+TEST_F(FileCacheTest, EvictEmpty) {
+  webcc::FileCache cache(FileCache::kEntryOverhead * 4);
+
+  for (int i = 0; i < 16; ++i) {
+    cache.Get(Write(std::to_string(i) + ".txt", ""));
+  }
+
+  EXPECT_EQ(4, cache.Size());
+  EXPECT_EQ(FileCache::kEntryOverhead * 4, cache.Bytes());
+}
+
+TEST_F(FileCacheTest, MaxFileSize) {
+  webcc::FileCache cache(1024, 4);
+
+  auto path = Write("index.html", "hello");
+
+  auto file = cache.Get(path);
+  ASSERT_NE(nullptr, file);
+  EXPECT_EQ(nullptr, file->data);
+  EXPECT_EQ(0, cache.Size());
+}
+
+TEST_F(FileCacheTest, Evict) {
+  webcc::FileCache cache(10 + FileCache::kEntryOverhead * 2);
+
+  auto a = Write("a.txt", "aaaa");
+  auto b = Write("b.txt", "bbbb");
+  auto c = Write("c.txt", "cccc");
+
+  cache.Get(a);
+  cache.Get(b);
+
+  // Use "a" so that "b" becomes the least recently used.
+  cache.Get(a);
+
+  cache.Get(c);
+
+  EXPECT_EQ(2, cache.Size());
+  EXPECT_EQ(8 + FileCache::kEntryOverhead * 2, cache.Bytes());
+
+  EXPECT_NE(nullptr, cache.Find(a));
+  EXPECT_EQ(nullptr, cache.Find(b));
+  EXPECT_NE(nullptr, cache.Find(c));
+}
+
+TEST_F(FileCacheTest, Invalidate) {
+  // Revalidate on every hit.
+  webcc::FileCache cache(1024, 1024, milliseconds(0));
+
+  auto path = Write("index.html", "hello");
+
+  auto file = cache.Get(path);
+  ASSERT_NE(nullptr, file);
+
+  Write("index.html", "hello world");
+
+  // Changed files are not found, but reloaded.
+  EXPECT_EQ(nullptr, cache.Find(path));
+
+  file = cache.Get(path);
+  ASSERT_NE(nullptr, file);
+  ASSERT_NE(nullptr, file->data);
+  EXPECT_EQ("hello world", *file->data);
+  EXPECT_EQ(11 + FileCache::kEntryOverhead, cache.Bytes());
+
+  bfs::remove(path);
+
+  EXPECT_EQ(nullptr, cache.Get(path));
+  EXPECT_EQ(0, cache.Size());
+  EXPECT_EQ(0, cache.Bytes());
+}
@@ -0,0 +1,139 @@
+#include "gtest/gtest.h"
+
+#include "webcc/body.h"
+
+#if WEBCC_ENABLE_GZIP
+
+#include "webcc/gzip.h"
+
+namespace {
+
+// Some compressible data of the given size.
+std::string MakeData(std::size_t size) {
+  std::string data;
+  for (std::size_t i = 0; data.size() < size; ++i) {
+    data += "line " + std::to_string(i % 1000) + "\n";
+  }
+  data.resize(size);
+  return data;
+}
+
+}  // namespace
+
+TEST(GzipTest, CompressDecompress) {
+  const std::string data = MakeData(100 * 1024);
+
+  std::string compressed;
+  EXPECT_TRUE(webcc::gzip::Compress(data, &compressed));
+  EXPECT_LT(compressed.size(), data.size());
+
+  std::string decompressed;
+  EXPECT_TRUE(webcc::gzip::Decompress(compressed, &decompressed));
+  EXPECT_EQ(data, decompressed);
+}
+
+TEST(GzipTest, CompressLevel) {
+  const std::string data = MakeData(100 * 1024);
+
+  std::string fast;
+  EXPECT_TRUE(webcc::gzip::Compress(data, &fast, webcc::gzip::kBestSpeed));
+
+  std::string best;
+  EXPECT_TRUE(
+      webcc::gzip::Compress(data, &best, webcc::gzip::kBestCompression));
+  EXPECT_LE(best.size(), fast.size());
+
+  // The thread local state is reused across the levels.
+  for (const std::string* compressed : { &fast, &best }) {
+    std::string decompressed;
+    EXPECT_TRUE(webcc::gzip::Decompress(*compressed, &decompressed));
+    EXPECT_EQ(data, decompressed);
+  }
+}
+
+TEST(GzipTest, DecompressIncomplete) {
+  std::string compressed;
+  EXPECT_TRUE(webcc::gzip::Compress(MakeData(10000), &compressed));
+  compressed.resize(compressed.size() / 2);
+
+  std::string decompressed;
+  EXPECT_FALSE(webcc::gzip::Decompress(compressed, &decompressed));
+
+  // The state is still reusable after the failure.
+  EXPECT_TRUE(webcc::gzip::Compress(MakeData(10000), &compressed));
+  EXPECT_TRUE(webcc::gzip::Decompress(compressed, &decompressed));
+  EXPECT_EQ(MakeData(10000), decompressed);
+}
+
+TEST(GzipTest, Compressor) {
+  const std::string data = MakeData(100 * 1024);
+
+  webcc::gzip::Compressor compressor;
+
+  // Compress twice to test the reuse.
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_TRUE(compressor.Init());
+
+    std::string compressed;
+    for (std::size_t off = 0; off < data.size(); off += 1000) {
+      std::size_t size = std::min<std::size_t>(1000, data.size() - off);
+      EXPECT_TRUE(compressor.Compress(&data[off], size, false, &compressed));
+    }
+    EXPECT_TRUE(compressor.Compress(nullptr, 0, true, &compressed));
+
+    std::string decompressed;
+    EXPECT_TRUE(webcc::gzip::Decompress(compressed, &decompressed));
+    EXPECT_EQ(data, decompressed);
+  }
+}
+
+TEST(GzipTest, CompressorEmpty) {
+  webcc::gzip::Compressor compressor;
+  ASSERT_TRUE(compressor.Init());
+
+  std::string compressed;
+  EXPECT_TRUE(compressor.Compress(nullptr, 0, true, &compressed));
+  EXPECT_FALSE(compressed.empty());
+
+  std::string decompressed;
+  EXPECT_TRUE(webcc::gzip::Decompress(compressed, &decompressed));
+  EXPECT_TRUE(decompressed.empty());
+}
+
+TEST(GzipTest, GzipBody) {
+  const std::string data = MakeData(1024 * 1024);
+
+  std::size_t off = 0;
+  auto source = std::make_shared<webcc::StreamBody>(
+      [&data, &off](std::string* piece) {
+        if (off >= data.size()) {
+          return false;
+        }
+        *piece = data.substr(off, 4096);
+        off += piece->size();
+        return true;
+      });
+
+  webcc::GzipBody body{ source };
+  EXPECT_EQ(webcc::kInvalidLength, body.GetSize());
+
+  std::string compressed;
+  std::size_t max_chunk = 0;
+
+  body.InitPayload();
+  for (auto p = body.NextPayload(); !p.empty(); p = body.NextPayload()) {
+    for (auto& b : p) {
+      compressed.append(static_cast<const char*>(b.data()), b.size());
+      max_chunk = std::max(max_chunk, b.size());
+    }
+  }
+
+  // The chunks are bounded.
+  EXPECT_LT(max_chunk, 64 * 1024);
+
+  std::string decompressed;
+  EXPECT_TRUE(webcc::gzip::Decompress(compressed, &decompressed));
+  EXPECT_EQ(data, decompressed);
+}
+
+#endif  // WEBCC_ENABLE_GZIP
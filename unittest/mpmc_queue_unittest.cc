@@ -0,0 +1,115 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "webcc/mpmc_queue.h"
+
+TEST(MpmcQueueTest, PushPop) {
+  webcc::MpmcQueue<int> queue(4);
+
+  EXPECT_EQ(4, queue.capacity());
+  EXPECT_EQ(0, queue.Size());
+
+  queue.Push(1);
+  queue.Push(2);
+  queue.Push(3);
+
+  EXPECT_EQ(3, queue.Size());
+
+  EXPECT_EQ(1, queue.Pop());
+  EXPECT_EQ(2, queue.PopOrWait());
+  EXPECT_EQ(3, queue.Pop());
+
+  // Empty
+  EXPECT_EQ(0, queue.Pop());
+  EXPECT_EQ(0, queue.Size());
+}
+
+TEST(MpmcQueueTest, Full) {
+  webcc::MpmcQueue<int> queue(2);
+
+  EXPECT_TRUE(queue.TryPush(1));
+  EXPECT_TRUE(queue.TryPush(2));
+  EXPECT_FALSE(queue.TryPush(3));
+
+  int message = 0;
+  EXPECT_TRUE(queue.TryPop(&message));
+  EXPECT_EQ(1, message);
+
+  EXPECT_TRUE(queue.TryPush(3));
+}
+
+TEST(MpmcQueueTest, PopBatch) {
+  webcc::MpmcQueue<int> queue(8);
+
+  for (int i = 1; i <= 5; ++i) {
+    queue.Push(i);
+  }
+
+  std::vector<int> messages;
+  EXPECT_EQ(3, queue.PopBatch(&messages, 3));
+  EXPECT_EQ(2, queue.PopBatch(&messages, 3));
+  EXPECT_EQ((std::vector<int>{ 1, 2, 3, 4, 5 }), messages);
+}
+
+TEST(MpmcQueueTest, ClearReleasesMessages) {
+  webcc::MpmcQueue<std::shared_ptr<int>> queue(4);
+
+  auto message = std::make_shared<int>(1);
+  queue.Push(message);
+  EXPECT_EQ(2, message.use_count());
+
+  queue.Clear();
+  EXPECT_EQ(1, message.use_count());
+  EXPECT_EQ(0, queue.Size());
+}
+
+// Multiple producers and consumers, the consumers stop on a null message (the
+// "poison pill") which each of them passes on to the next.
+TEST(MpmcQueueTest, ProducersConsumers) {
+  const int kProducers = 4;
+  const int kConsumers = 4;
+  const int kCount = 10000;
+
+  webcc::MpmcQueue<std::shared_ptr<int>> queue(64);
+
+  std::atomic<long> sum{ 0 };
+
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < kConsumers; ++i) {
+    consumers.emplace_back([&queue, &sum]() {
+      for (;;) {
+        auto message = queue.PopOrWait();
+        if (!message) {
+          queue.Push(nullptr);
+          break;
+        }
+        sum += *message;
+      }
+    });
+  }
+
+  std::vector<std::thread> producers;
+  for (int i = 0; i < kProducers; ++i) {
+    producers.emplace_back([&queue]() {
+      for (int j = 1; j <= kCount; ++j) {
+        queue.Push(std::make_shared<int>(j));
+      }
+    });
+  }
+
+  for (auto& t : producers) {
+    t.join();
+  }
+
+  queue.Push(nullptr);
+
+  for (auto& t : consumers) {
+    t.join();
+  }
+
+  EXPECT_EQ(static_cast<long>(kProducers) * kCount * (kCount + 1) / 2, sum);
+}
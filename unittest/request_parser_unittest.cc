@@ -3,6 +3,10 @@
 #include "webcc/request.h"
 #include "webcc/request_parser.h"
 
+#if WEBCC_ENABLE_GZIP
+#include "webcc/gzip.h"
+#endif
+
 // -----------------------------------------------------------------------------
 
 #if 0
@@ -232,4 +236,489 @@ TEST_F(MultipartRequestParserTest, ParseByteWise) {
 
   CheckResult();
 }
-#endif  // 0
\ No newline at end of file
+#endif  // 0
+// -----------------------------------------------------------------------------
+
+// Pipelined requests: the data beyond a request is kept for the next one.
+class PipelineRequestParserTest : public testing::Test {
+protected:
+  static bool MatchView(webcc::Request*, bool* stream, bool* non_blocking) {
+    *stream = false;
+    *non_blocking = false;
+    return true;
+  }
+
+  // Parse the data as a new request, return the leftover.
+  std::string Parse(const std::string& data, webcc::Request* request) {
+    parser_.Init(request, &PipelineRequestParserTest::MatchView);
+    EXPECT_TRUE(parser_.Parse(data.data(), data.size()));
+    EXPECT_TRUE(parser_.finished());
+    return parser_.TakeLeftover();
+  }
+
+  webcc::RequestParser parser_;
+};
+
+TEST_F(PipelineRequestParserTest, Get) {
+  const std::string get1 = "GET /1 HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  const std::string get2 = "GET /2 HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+  webcc::Request request1;
+  std::string leftover = Parse(get1 + get2, &request1);
+  EXPECT_EQ("/1", request1.url().path());
+  EXPECT_EQ(get2, leftover);
+
+  webcc::Request request2;
+  leftover = Parse(leftover, &request2);
+  EXPECT_EQ("/2", request2.url().path());
+  EXPECT_EQ("", leftover);
+}
+
+// A request recycled for the next one, as a keep-alive connection does.
+TEST_F(PipelineRequestParserTest, RecycledRequest) {
+  const std::string post =
+      "POST /books/1?fields=title HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Content-Type: application/json\r\n"
+      "Content-Length: 2\r\n"
+      "\r\n"
+      "{}";
+  const std::string get = "GET /2 HTTP/1.1\r\nHost: example.com\r\n\r\n";
+
+  webcc::Request request;
+  EXPECT_EQ(get, Parse(post + get, &request));
+  EXPECT_EQ("{}", request.data());
+
+  request.Clear();
+  EXPECT_EQ("", Parse(get, &request));
+
+  EXPECT_EQ("GET", request.method());
+  EXPECT_EQ("/2", request.url().path());
+  EXPECT_EQ("", request.url().query());
+  EXPECT_EQ("GET /2 HTTP/1.1", request.start_line());
+  EXPECT_EQ("example.com", request.GetHeader("Host"));
+  EXPECT_FALSE(request.HasHeader("Content-Type"));
+  EXPECT_EQ("", request.data());
+}
+
+TEST_F(PipelineRequestParserTest, FixedContent) {
+  const std::string post =
+      "POST /1 HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Content-Length: 5\r\n"
+      "\r\n"
+      "hello";
+  const std::string get = "GET /2 HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+  webcc::Request request;
+  EXPECT_EQ(get, Parse(post + get, &request));
+  EXPECT_EQ("hello", request.data());
+
+  // The content arrives in a separate read together with the next request.
+  webcc::Request request2;
+  parser_.Init(&request2, &PipelineRequestParserTest::MatchView);
+
+  std::size_t headers_size = post.size() - 5;
+  EXPECT_TRUE(parser_.Parse(post.data(), headers_size));
+  EXPECT_FALSE(parser_.finished());
+
+  std::string data = post.substr(headers_size) + get;
+  EXPECT_TRUE(parser_.Parse(data.data(), data.size()));
+  EXPECT_TRUE(parser_.finished());
+  EXPECT_EQ("hello", request2.data());
+  EXPECT_EQ(get, parser_.TakeLeftover());
+}
+
+TEST_F(PipelineRequestParserTest, ChunkedContent) {
+  const std::string post =
+      "POST /1 HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n"
+      "5\r\nhello\r\n"
+      "6\r\n world\r\n"
+      "0\r\n"
+      "X-Trailer: 1\r\n"
+      "\r\n";
+  const std::string get = "GET /2 HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+  webcc::Request request;
+  EXPECT_EQ(get, Parse(post + get, &request));
+  EXPECT_EQ("hello world", request.data());
+
+  // Parse byte by byte, the chunk-size lines are split across reads.
+  webcc::Request request2;
+  parser_.Init(&request2, &PipelineRequestParserTest::MatchView);
+
+  for (std::size_t i = 0; i < post.size(); ++i) {
+    EXPECT_FALSE(parser_.finished());
+    EXPECT_TRUE(parser_.Parse(post.data() + i, 1));
+  }
+  EXPECT_TRUE(parser_.finished());
+  EXPECT_EQ("hello world", request2.data());
+  EXPECT_EQ("", parser_.TakeLeftover());
+}
+
+TEST_F(PipelineRequestParserTest, ChunkExtensions) {
+  const std::string post =
+      "POST /1 HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n"
+      "5;name=value\r\nhello\r\n"
+      "A\r\n0123456789\r\n"
+      "0\r\n"
+      "\r\n";
+
+  webcc::Request request;
+  EXPECT_EQ("", Parse(post, &request));
+  EXPECT_EQ("hello0123456789", request.data());
+}
+
+TEST_F(PipelineRequestParserTest, InvalidChunkSize) {
+  const std::string post =
+      "POST /1 HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n"
+      "xyz\r\nhello\r\n";
+
+  webcc::Request request;
+  parser_.Init(&request, &PipelineRequestParserTest::MatchView);
+  EXPECT_FALSE(parser_.Parse(post.data(), post.size()));
+}
+
+TEST_F(PipelineRequestParserTest, ConflictingContentLengths) {
+  const std::string post =
+      "POST /1 HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Content-Length: 30\r\n"
+      "Content-Length: 3\r\n"
+      "\r\n"
+      "abcGET /x HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+  webcc::Request request;
+  parser_.Init(&request, &PipelineRequestParserTest::MatchView);
+  EXPECT_FALSE(parser_.Parse(post.data(), post.size()));
+}
+
+// The same content length repeated is not ambiguous.
+TEST_F(PipelineRequestParserTest, RepeatedContentLength) {
+  const std::string post =
+      "POST /1 HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Content-Length: 3\r\n"
+      "Content-Length: 3\r\n"
+      "\r\n"
+      "abc";
+
+  webcc::Request request;
+  EXPECT_EQ("", Parse(post, &request));
+  EXPECT_EQ("abc", request.data());
+}
+
+TEST_F(PipelineRequestParserTest, ContentLengthWithChunked) {
+  const std::string post1 =
+      "POST /1 HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Content-Length: 5\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n"
+      "0\r\n\r\n";
+
+  webcc::Request request1;
+  parser_.Init(&request1, &PipelineRequestParserTest::MatchView);
+  EXPECT_FALSE(parser_.Parse(post1.data(), post1.size()));
+
+  const std::string post2 =
+      "POST /1 HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "Content-Length: 5\r\n"
+      "\r\n"
+      "0\r\n\r\n";
+
+  webcc::Request request2;
+  parser_.Init(&request2, &PipelineRequestParserTest::MatchView);
+  EXPECT_FALSE(parser_.Parse(post2.data(), post2.size()));
+}
+
+// The data after the last boundary but within the content length is the
+// epilogue of the multipart data, not the next request.
+TEST_F(PipelineRequestParserTest, MultipartEpilogue) {
+  const std::string smuggled = "GET /smuggled HTTP/1.1\r\nHost: x\r\n\r\n";
+  const std::string data =
+      "--B\r\n"
+      "Content-Disposition: form-data; name=\"a\"\r\n"
+      "\r\n"
+      "1\r\n"
+      "--B--\r\n" + smuggled;
+  const std::string post =
+      "POST /1 HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Content-Type: multipart/form-data; boundary=B\r\n"
+      "Content-Length: " + std::to_string(data.size()) + "\r\n"
+      "\r\n" + data;
+  const std::string get = "GET /2 HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+  webcc::Request request;
+  EXPECT_EQ(get, Parse(post + get, &request));
+  ASSERT_EQ(1, request.form_parts().size());
+  EXPECT_EQ("1", request.form_parts()[0]->data());
+
+  // Parse byte by byte.
+  webcc::Request request2;
+  parser_.Init(&request2, &PipelineRequestParserTest::MatchView);
+
+  std::string payload = post + get;
+  for (std::size_t i = 0; i < payload.size(); ++i) {
+    EXPECT_TRUE(parser_.Parse(payload.data() + i, 1));
+    if (parser_.finished()) {
+      EXPECT_EQ(post.size() - 1, i);
+      break;
+    }
+  }
+  EXPECT_TRUE(parser_.finished());
+  EXPECT_EQ("", parser_.TakeLeftover());
+  EXPECT_EQ(1, request2.form_parts().size());
+}
+
+// The content length ends before the last boundary.
+TEST_F(PipelineRequestParserTest, MultipartTruncated) {
+  const std::string data =
+      "--B\r\n"
+      "Content-Disposition: form-data; name=\"a\"\r\n"
+      "\r\n"
+      "1\r\n";
+  const std::string post =
+      "POST /1 HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Content-Type: multipart/form-data; boundary=B\r\n"
+      "Content-Length: " + std::to_string(data.size()) + "\r\n"
+      "\r\n" + data +
+      "--B--\r\n";
+
+  webcc::Request request;
+  parser_.Init(&request, &PipelineRequestParserTest::MatchView);
+  EXPECT_FALSE(parser_.Parse(post.data(), post.size()));
+}
+
+// The chunk size plus the CRLF after the chunk data would overflow.
+TEST_F(PipelineRequestParserTest, HugeChunkSize) {
+  const std::string post =
+      "POST /1 HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n"
+      "fffffffffffffffe\r\n"
+      "hello\r\n";
+
+  webcc::Request request;
+  parser_.Init(&request, &PipelineRequestParserTest::MatchView);
+  EXPECT_FALSE(parser_.Parse(post.data(), post.size()));
+
+  const std::string post2 =
+      "POST /1 HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n"
+      "10000000000000000\r\n"
+      "hello\r\n";
+
+  webcc::Request request2;
+  parser_.Init(&request2, &PipelineRequestParserTest::MatchView);
+  EXPECT_FALSE(parser_.Parse(post2.data(), post2.size()));
+}
+
+// -----------------------------------------------------------------------------
+
+TEST(PendingDataTest, ConsumeAppend) {
+  webcc::PendingData pending;
+  EXPECT_TRUE(pending.empty());
+
+  std::string expected;
+  for (int i = 0; i < 1000; ++i) {
+    std::string data = std::to_string(i) + ",";
+    pending.Append(data.data(), data.size());
+    expected += data;
+
+    // Consume a piece from the front now and then.
+    if (i % 3 == 0) {
+      std::size_t size = std::min<std::size_t>(4, pending.size());
+      EXPECT_EQ(expected.substr(0, size), std::string(pending.data(), size));
+      pending.Consume(size);
+      expected.erase(0, size);
+    }
+
+    EXPECT_EQ(expected, std::string(pending.data(), pending.size()));
+  }
+
+  EXPECT_EQ(expected, pending.Take());
+  EXPECT_TRUE(pending.empty());
+}
+
+// -----------------------------------------------------------------------------
+
+// Multipart form data, the boundaries are searched in the data of the parts.
+class FormRequestParserTest : public testing::Test {
+protected:
+  static bool MatchView(webcc::Request*, bool* stream, bool* non_blocking) {
+    *stream = false;
+    *non_blocking = false;
+    return true;
+  }
+
+  static std::string MakeRequest(const std::string& data) {
+    return "POST /upload HTTP/1.1\r\n"
+           "Host: localhost\r\n"
+           "Content-Type: multipart/form-data; boundary=" + kBoundary + "\r\n"
+           "Content-Length: " + std::to_string(data.size()) + "\r\n"
+           "\r\n" + data;
+  }
+
+  static std::string MakePart(const std::string& name,
+                              const std::string& data) {
+    return "--" + kBoundary + "\r\n"
+           "Content-Disposition: form-data; name=\"" + name + "\"\r\n"
+           "\r\n" + data + "\r\n";
+  }
+
+  // Parse the request in pieces of the given size.
+  void Parse(const std::string& request, std::size_t piece) {
+    parser_.Init(&request_, &FormRequestParserTest::MatchView);
+
+    for (std::size_t off = 0; off < request.size(); off += piece) {
+      std::size_t size = std::min(piece, request.size() - off);
+      EXPECT_FALSE(parser_.finished());
+      ASSERT_TRUE(parser_.Parse(request.data() + off, size));
+    }
+    EXPECT_TRUE(parser_.finished());
+  }
+
+  static const std::string kBoundary;
+
+  webcc::Request request_;
+  webcc::RequestParser parser_;
+};
+
+const std::string FormRequestParserTest::kBoundary = "b0a2f3e1-4c7d";
+
+TEST_F(FormRequestParserTest, Parts) {
+  // Data looking like (but not being) boundaries, lone CRs and an empty part.
+  std::string data1 = "line1\r\n--" + kBoundary + "x\r\n\r\r\n--\r";
+  std::string data2;
+  std::string data3(100 * 1024, '-');
+  data3[5000] = '\r';
+
+  const std::string request = MakeRequest(
+      MakePart("p1", data1) + MakePart("p2", data2) + MakePart("p3", data3) +
+      "--" + kBoundary + "--\r\n");
+
+  for (std::size_t piece : { std::size_t(1), std::size_t(7),
+                             std::size_t(1000), request.size() }) {
+    Parse(request, piece);
+
+    const auto& parts = request_.form_parts();
+    ASSERT_EQ(3u, parts.size());
+    EXPECT_EQ("p1", parts[0]->name());
+    EXPECT_EQ(data1, parts[0]->data());
+    EXPECT_EQ("p2", parts[1]->name());
+    EXPECT_EQ(data2, parts[1]->data());
+    EXPECT_EQ("p3", parts[2]->name());
+    EXPECT_EQ(data3, parts[2]->data());
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+#if WEBCC_ENABLE_GZIP
+
+// The content is decompressed on the fly as it arrives.
+class GzipRequestParserTest : public testing::Test {
+protected:
+  static bool MatchView(webcc::Request*, bool* stream, bool* non_blocking) {
+    *stream = false;
+    *non_blocking = false;
+    return true;
+  }
+
+  static std::string MakeRequest(const std::string& data) {
+    std::string compressed;
+    EXPECT_TRUE(webcc::gzip::Compress(data, &compressed));
+
+    return "POST /1 HTTP/1.1\r\n"
+           "Host: localhost\r\n"
+           "Content-Encoding: gzip\r\n"
+           "Content-Length: " + std::to_string(compressed.size()) + "\r\n"
+           "\r\n" + compressed;
+  }
+
+  webcc::RequestParser parser_;
+};
+
+TEST_F(GzipRequestParserTest, Decompress) {
+  std::string data;
+  for (int i = 0; data.size() < 100 * 1024; ++i) {
+    data += "line " + std::to_string(i) + "\n";
+  }
+
+  const std::string post = MakeRequest(data);
+
+  webcc::Request request;
+  parser_.Init(&request, &GzipRequestParserTest::MatchView);
+
+  // Parse piece by piece.
+  for (std::size_t off = 0; off < post.size(); off += 100) {
+    std::size_t size = std::min<std::size_t>(100, post.size() - off);
+    EXPECT_TRUE(parser_.Parse(post.data() + off, size));
+  }
+  EXPECT_TRUE(parser_.finished());
+  EXPECT_EQ(data, request.data());
+}
+
+TEST_F(GzipRequestParserTest, DecompressionBomb) {
+  // 64MB of zeros compress to about 64KB (1000:1).
+  const std::string post = MakeRequest(std::string(64 * 1024 * 1024, '\0'));
+
+  webcc::Request request;
+  parser_.Init(&request, &GzipRequestParserTest::MatchView);
+
+  // Rejected long before the whole content is received.
+  std::size_t off = 0;
+  for (; off < post.size(); off += 1024) {
+    std::size_t size = std::min<std::size_t>(1024, post.size() - off);
+    if (!parser_.Parse(post.data() + off, size)) {
+      break;
+    }
+  }
+  EXPECT_LT(off, post.size() / 2);
+  EXPECT_FALSE(parser_.finished());
+}
+
+// The same content is accepted without the limit of the ratio, as the client
+// does by default.
+TEST_F(GzipRequestParserTest, NoDecompressionLimit) {
+  const std::string data(8 * 1024 * 1024, '\0');
+  const std::string post = MakeRequest(data);
+
+  webcc::Request request;
+  parser_.set_max_decompression_ratio(0);
+  parser_.Init(&request, &GzipRequestParserTest::MatchView);
+
+  EXPECT_TRUE(parser_.Parse(post.data(), post.size()));
+  EXPECT_TRUE(parser_.finished());
+  EXPECT_EQ(data.size(), request.data().size());
+}
+
+TEST_F(GzipRequestParserTest, Corrupted) {
+  std::string post = MakeRequest(std::string(10000, 'a'));
+
+  // Break the gzip header.
+  post[post.find("\r\n\r\n") + 4] = 'x';
+
+  webcc::Request request;
+  parser_.Init(&request, &GzipRequestParserTest::MatchView);
+  EXPECT_FALSE(parser_.Parse(post.data(), post.size()));
+}
+
+#endif  // WEBCC_ENABLE_GZIP
@@ -1,5 +1,6 @@
 #include "gtest/gtest.h"
 
+#include "webcc/body.h"
 #include "webcc/response_builder.h"
 
 // Empty body should also have `Content-Length` header.
@@ -15,3 +16,43 @@ TEST(ResponseBuilderTest, EmptyBody) {
 
   EXPECT_EQ("0", value);
 }
+
+// The canned response is the same as the one prepared on the fly.
+TEST(ResponseBuilderTest, Canned) {
+  using namespace webcc;
+
+  auto response = ResponseBuilder{}.NotFound()();
+  response->SetHeader(headers::kConnection, "Keep-Alive");
+  response->Prepare();
+
+  std::string expected;
+  response->SerializeHeaders(&expected);
+
+  const std::string* canned = Response::GetCanned(Status::kNotFound, true);
+  EXPECT_NE(nullptr, canned);
+  EXPECT_EQ(expected, *canned);
+
+  // Shared, not serialized again.
+  EXPECT_EQ(canned, Response::GetCanned(Status::kNotFound, true));
+
+  EXPECT_NE(*canned, *Response::GetCanned(Status::kNotFound, false));
+
+  EXPECT_EQ(nullptr, Response::GetCanned(299, true));
+}
+
+// A body of unknown size set without `Transfer-Encoding: chunked` gets it on
+// Prepare(), so that the framing of the connection matches the headers.
+TEST(ResponseBuilderTest, StreamBodyWithoutLength) {
+  using namespace webcc;
+
+  auto body = std::make_shared<StreamBody>([](std::string*) { return false; });
+
+  auto response = std::make_shared<Response>(Status::kOK);
+  response->SetBody(body, false);
+  EXPECT_FALSE(response->IsChunked());
+
+  response->Prepare();
+  EXPECT_TRUE(response->IsChunked());
+  EXPECT_EQ("chunked", response->GetHeader(headers::kTransferEncoding));
+  EXPECT_FALSE(response->HasHeader(headers::kContentLength));
+}
@@ -75,3 +75,138 @@ TEST(RouterTest, URL_NonRegex) {
   EXPECT_TRUE(!!view);
   EXPECT_TRUE(args.empty());
 }
+
+TEST(RouterTest, URL_NonRegexCaseInsensitive) {
+  webcc::Router router;
+
+  router.Route("/Instances", std::make_shared<MyView>());
+
+  webcc::UrlArgs args;
+  EXPECT_TRUE(!!router.FindView("GET", "/instances", &args));
+  EXPECT_TRUE(!!router.FindView("GET", "/INSTANCES", &args));
+  EXPECT_TRUE(!router.FindView("GET", "/instances/", &args));
+  EXPECT_TRUE(!router.FindView("GET", "/instance", &args));
+}
+
+TEST(RouterTest, URL_Params) {
+  webcc::Router router;
+
+  auto view1 = std::make_shared<MyView>();
+  auto view2 = std::make_shared<MyView>();
+  auto view3 = std::make_shared<MyView>();
+
+  router.Route("/books/{id:int}", view1);
+  router.Route("/books/{name}/pages/{page:int}", view2);
+  router.Route("/books/latest", view3);
+
+  webcc::UrlArgs args;
+  EXPECT_EQ(view1, router.FindView("GET", "/books/123", &args));
+  ASSERT_EQ(1, args.size());
+  EXPECT_EQ("123", args[0]);
+
+  // The literal segment first.
+  args.clear();
+  EXPECT_EQ(view3, router.FindView("GET", "/books/latest", &args));
+  EXPECT_TRUE(args.empty());
+
+  args.clear();
+  EXPECT_EQ(view2, router.FindView("GET", "/books/abc/pages/7", &args));
+  ASSERT_EQ(2, args.size());
+  EXPECT_EQ("abc", args[0]);
+  EXPECT_EQ("7", args[1]);
+
+  // Backtrack from "{id:int}" to "{name}".
+  args.clear();
+  EXPECT_EQ(view2, router.FindView("GET", "/books/123/pages/7", &args));
+  ASSERT_EQ(2, args.size());
+  EXPECT_EQ("123", args[0]);
+
+  args.clear();
+  EXPECT_TRUE(!router.FindView("GET", "/books/abc", &args));
+  EXPECT_TRUE(!router.FindView("GET", "/books/", &args));
+  EXPECT_TRUE(!router.FindView("GET", "/books/abc/pages/x", &args));
+}
+
+TEST(RouterTest, URL_Wildcard) {
+  webcc::Router router;
+
+  router.Route("/static/*", std::make_shared<MyView>());
+
+  webcc::UrlArgs args;
+  EXPECT_TRUE(!!router.FindView("GET", "/static/css/main.css", &args));
+  ASSERT_EQ(1, args.size());
+  EXPECT_EQ("css/main.css", args[0]);
+
+  args.clear();
+  EXPECT_TRUE(!router.FindView("GET", "/static", &args));
+
+  EXPECT_FALSE(router.Route("/static/*/main.css", std::make_shared<MyView>()));
+  EXPECT_FALSE(router.Route("/books/{id:float}", std::make_shared<MyView>()));
+  EXPECT_FALSE(router.Route("books", std::make_shared<MyView>()));
+}
+
+TEST(RouterTest, Methods) {
+  webcc::Router router;
+
+  auto view1 = std::make_shared<MyView>();
+  auto view2 = std::make_shared<MyView>();
+
+  router.Route("/books", view1, { "GET", "POST" });
+  router.Route("/books", view2, { "DELETE", "PURGE" });
+
+  webcc::UrlArgs args;
+  EXPECT_EQ(view1, router.FindView("GET", "/books", &args));
+  EXPECT_EQ(view1, router.FindView("POST", "/books", &args));
+  EXPECT_EQ(view2, router.FindView("DELETE", "/books", &args));
+  EXPECT_EQ(view2, router.FindView("PURGE", "/books", &args));
+  EXPECT_TRUE(!router.FindView("PUT", "/books", &args));
+  EXPECT_TRUE(!router.FindView("get", "/books", &args));
+
+  bool stream = true;
+  EXPECT_TRUE(router.MatchView("POST", "/books", &stream));
+  EXPECT_FALSE(stream);
+  EXPECT_FALSE(router.MatchView("PATCH", "/books", &stream));
+}
+
+TEST(RouterTest, RegexFallback) {
+  webcc::Router router;
+
+  auto view1 = std::make_shared<MyView>();
+  auto view2 = std::make_shared<MyView>();
+
+  router.Route(webcc::R("/books/(\\w+)"), view1);
+  router.Route("/books/{id:int}", view2);
+
+  webcc::UrlArgs args;
+  EXPECT_EQ(view2, router.FindView("GET", "/books/1", &args));
+
+  args.clear();
+  EXPECT_EQ(view1, router.FindView("GET", "/books/abc", &args));
+  ASSERT_EQ(1, args.size());
+  EXPECT_EQ("abc", args[0]);
+}
+
+TEST(RouterTest, MatchViewSavesTheMatch) {
+  webcc::Router router;
+
+  auto view = std::make_shared<MyView>();
+  router.Route("/books/{id:int}", view, { "GET" });
+
+  webcc::Request request{ "GET" };
+  request.set_url(webcc::Url{ "/books/12" });
+
+  bool stream = true;
+  bool non_blocking = true;
+  EXPECT_TRUE(router.MatchView(&request, &stream, &non_blocking));
+  EXPECT_FALSE(stream);
+  EXPECT_FALSE(non_blocking);
+
+  EXPECT_EQ(view, request.view());
+  ASSERT_EQ(1, request.args().size());
+  EXPECT_EQ("12", request.args()[0]);
+
+  webcc::Request request2{ "POST" };
+  request2.set_url(webcc::Url{ "/books/12" });
+  EXPECT_FALSE(router.MatchView(&request2, &stream, &non_blocking));
+  EXPECT_TRUE(!request2.view());
+}
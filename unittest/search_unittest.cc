@@ -0,0 +1,111 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "webcc/search.h"
+
+namespace {
+
+using webcc::search::Level;
+
+// All the levels supported by the CPU.
+std::vector<Level> SupportedLevels() {
+  std::vector<Level> levels{ Level::kScalar };
+  if (webcc::search::SupportedLevel() >= Level::kSse2) {
+    levels.push_back(Level::kSse2);
+  }
+  if (webcc::search::SupportedLevel() >= Level::kAvx2) {
+    levels.push_back(Level::kAvx2);
+  }
+  return levels;
+}
+
+// Find with std::string as the reference.
+std::size_t Expected(const std::string& str, std::size_t off,
+                     const std::string& needle) {
+  std::size_t pos = str.find(needle, off);
+  return pos == std::string::npos ? str.size() : pos;
+}
+
+std::size_t Actual(const std::string& str, const char* p) {
+  return p == nullptr ? str.size() : p - str.data();
+}
+
+// Random data made of the characters in |chars|.
+std::string MakeData(std::size_t size, const std::string& chars,
+                     unsigned seed) {
+  std::string data(size, ' ');
+  for (char& c : data) {
+    seed = seed * 1103515245 + 12345;
+    c = chars[(seed >> 16) % chars.size()];
+  }
+  return data;
+}
+
+class SearchTest : public testing::TestWithParam<Level> {
+protected:
+  void SetUp() override {
+    level_ = webcc::search::GetLevel();
+    ASSERT_TRUE(webcc::search::SetLevel(GetParam()));
+  }
+
+  void TearDown() override {
+    webcc::search::SetLevel(level_);
+  }
+
+  Level level_;
+};
+
+}  // namespace
+
+TEST_P(SearchTest, FindChar) {
+  for (std::size_t size = 0; size < 100; ++size) {
+    std::string str = MakeData(size, "ab:", static_cast<unsigned>(size));
+
+    for (std::size_t off = 0; off <= size; ++off) {
+      const char* p = webcc::search::FindChar(str.data() + off,
+                                              str.data() + size, ':');
+      EXPECT_EQ(Expected(str, off, ":"), Actual(str, p));
+    }
+  }
+}
+
+TEST_P(SearchTest, FindCRLF) {
+  for (std::size_t size = 0; size < 100; ++size) {
+    std::string str = MakeData(size, "aaa\r\r\n", static_cast<unsigned>(size));
+
+    for (std::size_t off = 0; off <= size; ++off) {
+      const char* p = webcc::search::FindCRLF(str.data() + off,
+                                              str.data() + size);
+      EXPECT_EQ(Expected(str, off, "\r\n"), Actual(str, p));
+    }
+  }
+
+  // A CR at the end is not a CRLF.
+  std::string str(64, 'a');
+  str.back() = '\r';
+  EXPECT_EQ(nullptr,
+            webcc::search::FindCRLF(str.data(), str.data() + str.size()));
+}
+
+TEST_P(SearchTest, Find) {
+  const std::string needles[] = { "-", "\r\n", "\r\n--b", "\r\n--b-\r-\n--b" };
+
+  for (const std::string& needle : needles) {
+    for (std::size_t size = 0; size < 200; size += 3) {
+      std::string str = MakeData(size, "\r\n-b", static_cast<unsigned>(size));
+
+      for (std::size_t off = 0; off <= size; ++off) {
+        const char* p = webcc::search::Find(str.data() + off,
+                                            str.data() + size, needle.data(),
+                                            needle.size());
+        EXPECT_EQ(Expected(str, off, needle), Actual(str, p));
+      }
+    }
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Levels, SearchTest,
+                        testing::ValuesIn(SupportedLevels()));
@@ -0,0 +1,165 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+
+#include "boost/asio/io_context.hpp"
+
+#include "webcc/timer_wheel.h"
+
+using std::chrono::milliseconds;
+
+// The wheel is ticked manually in the tests.
+class TimerWheelTest : public testing::Test {
+protected:
+  TimerWheelTest() : wheel_(io_context_, milliseconds(100), 8) {
+  }
+
+  void Tick(int count) {
+    for (int i = 0; i < count; ++i) {
+      wheel_.Tick();
+    }
+  }
+
+  boost::asio::io_context io_context_;
+  webcc::TimerWheel wheel_;
+};
+
+TEST_F(TimerWheelTest, Expire) {
+  int fired = 0;
+  webcc::TimerWheel::Timer timer([&fired](std::size_t) { ++fired; });
+
+  // Rounded up to 3 ticks.
+  wheel_.Schedule(&timer, milliseconds(250));
+  EXPECT_EQ(1, wheel_.Size());
+
+  Tick(2);
+  EXPECT_EQ(0, fired);
+
+  Tick(1);
+  EXPECT_EQ(1, fired);
+  EXPECT_EQ(0, wheel_.Size());
+
+  // Fired only once.
+  Tick(16);
+  EXPECT_EQ(1, fired);
+}
+
+// The timeout is longer than a round of the wheel.
+TEST_F(TimerWheelTest, Rounds) {
+  int fired = 0;
+  webcc::TimerWheel::Timer timer([&fired](std::size_t) { ++fired; });
+
+  wheel_.Schedule(&timer, milliseconds(2000));  // 20 ticks
+
+  Tick(19);
+  EXPECT_EQ(0, fired);
+
+  Tick(1);
+  EXPECT_EQ(1, fired);
+}
+
+TEST_F(TimerWheelTest, Cancel) {
+  int fired = 0;
+  webcc::TimerWheel::Timer timer1([&fired](std::size_t) { fired += 1; });
+  webcc::TimerWheel::Timer timer2([&fired](std::size_t) { fired += 10; });
+  webcc::TimerWheel::Timer timer3([&fired](std::size_t) { fired += 100; });
+
+  // All in the same slot.
+  wheel_.Schedule(&timer1, milliseconds(100));
+  wheel_.Schedule(&timer2, milliseconds(100));
+  wheel_.Schedule(&timer3, milliseconds(100));
+  EXPECT_EQ(3, wheel_.Size());
+
+  wheel_.Cancel(&timer2);
+  EXPECT_EQ(2, wheel_.Size());
+
+  // Cancel again takes no effect.
+  wheel_.Cancel(&timer2);
+  EXPECT_EQ(2, wheel_.Size());
+
+  Tick(1);
+  EXPECT_EQ(101, fired);
+  EXPECT_EQ(0, wheel_.Size());
+}
+
+TEST_F(TimerWheelTest, Reschedule) {
+  int fired = 0;
+  webcc::TimerWheel::Timer timer([&fired](std::size_t) { ++fired; });
+
+  wheel_.Schedule(&timer, milliseconds(200));
+  Tick(1);
+
+  // Reschedule before it expires, e.g., on new data of the connection.
+  wheel_.Schedule(&timer, milliseconds(200));
+  EXPECT_EQ(1, wheel_.Size());
+
+  Tick(1);
+  EXPECT_EQ(0, fired);
+
+  Tick(1);
+  EXPECT_EQ(1, fired);
+}
+
+// A callback could schedule its own timer again.
+TEST_F(TimerWheelTest, ScheduleInCallback) {
+  int fired = 0;
+  webcc::TimerWheel::Timer* timer_ptr = nullptr;
+  webcc::TimerWheel::Timer timer([this, &fired, &timer_ptr](std::size_t) {
+    if (++fired < 3) {
+      wheel_.Schedule(timer_ptr, milliseconds(100));
+    }
+  });
+  timer_ptr = &timer;
+
+  wheel_.Schedule(&timer, milliseconds(100));
+
+  Tick(5);
+  EXPECT_EQ(3, fired);
+  EXPECT_EQ(0, wheel_.Size());
+}
+
+// A timer rescheduled by another callback of the same tick, after its own
+// callback has been taken out, is not expired any more.
+TEST_F(TimerWheelTest, RescheduleInTick) {
+  int fired = 0;
+  webcc::TimerWheel::Timer* timer2_ptr = nullptr;
+  webcc::TimerWheel::Timer timer2(
+      [this, &fired, &timer2_ptr](std::size_t generation) {
+        if (wheel_.Expired(timer2_ptr, generation)) {
+          ++fired;
+        }
+      });
+  timer2_ptr = &timer2;
+
+  webcc::TimerWheel::Timer timer1([this, &timer2](std::size_t) {
+    wheel_.Schedule(&timer2, milliseconds(100));
+  });
+
+  // In the same slot, the timer scheduled later is fired first.
+  wheel_.Schedule(&timer2, milliseconds(100));
+  wheel_.Schedule(&timer1, milliseconds(100));
+
+  Tick(1);
+  EXPECT_EQ(0, fired);
+  EXPECT_EQ(1, wheel_.Size());
+
+  Tick(1);
+  EXPECT_EQ(1, fired);
+}
+
+TEST_F(TimerWheelTest, CancelAfterExpire) {
+  std::size_t expired_generation = 0;
+  webcc::TimerWheel::Timer timer(
+      [&expired_generation](std::size_t generation) {
+        expired_generation = generation;
+      });
+
+  wheel_.Schedule(&timer, milliseconds(100));
+
+  Tick(1);
+  EXPECT_TRUE(wheel_.Expired(&timer, expired_generation));
+
+  // E.g., the connection is closed before the timeout is handled.
+  wheel_.Cancel(&timer);
+  EXPECT_FALSE(wheel_.Expired(&timer, expired_generation));
+}
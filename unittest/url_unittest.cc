@@ -12,6 +12,18 @@ TEST(UrlTest, Basic) {
   EXPECT_EQ("", url.query());
 }
 
+TEST(UrlTest, ParseAgain) {
+  webcc::Url url("http://example.com:8080/path?a=1");
+
+  url.Parse("/path2");
+
+  EXPECT_EQ("", url.scheme());
+  EXPECT_EQ("", url.host());
+  EXPECT_EQ("", url.port());
+  EXPECT_EQ("/path2", url.path());
+  EXPECT_EQ("", url.query());
+}
+
 TEST(UrlTest, NoPath) {
   webcc::Url url("http://example.com");
 
@@ -92,3 +92,45 @@ TEST(UtilityTest, SplitKV_NoKeyNoValue) {
   EXPECT_EQ("", key);
   EXPECT_EQ("", value);
 }
+
+TEST(UtilityTest, HttpDate) {
+  // 2015-10-21 07:28:00 UTC
+  const std::time_t t = 1445412480;
+
+  std::string str = webcc::utility::FormatHttpDate(t);
+  EXPECT_EQ("Wed, 21 Oct 2015 07:28:00 GMT", str);
+
+  std::time_t parsed = 0;
+  EXPECT_TRUE(webcc::utility::ParseHttpDate(str, &parsed));
+  EXPECT_EQ(t, parsed);
+
+  EXPECT_FALSE(webcc::utility::ParseHttpDate("21 Oct 2015", &parsed));
+}
+
+TEST(UtilityTest, ToSize_View) {
+  std::size_t size = 0;
+  EXPECT_TRUE(webcc::utility::ToSize(boost::string_view{ "12345" }, &size));
+  EXPECT_EQ(12345u, size);
+
+  EXPECT_FALSE(webcc::utility::ToSize(boost::string_view{ "" }, &size));
+  EXPECT_FALSE(webcc::utility::ToSize(boost::string_view{ "-1" }, &size));
+  EXPECT_FALSE(webcc::utility::ToSize(boost::string_view{ "12a" }, &size));
+  EXPECT_FALSE(webcc::utility::ToSize(
+      boost::string_view{ "99999999999999999999999" }, &size));
+}
+
+TEST(UtilityTest, IEquals) {
+  EXPECT_TRUE(webcc::utility::IEquals("Content-Length", "content-length"));
+  EXPECT_TRUE(webcc::utility::IEquals("", ""));
+  EXPECT_FALSE(webcc::utility::IEquals("Content-Length", "Content-Type"));
+  EXPECT_FALSE(webcc::utility::IEquals("Host", "Hosts"));
+
+  // Only ASCII letters are case folded.
+  EXPECT_FALSE(webcc::utility::IEquals("[", "{"));
+}
+
+TEST(UtilityTest, Trim) {
+  EXPECT_EQ("value", webcc::utility::Trim(" \tvalue \t"));
+  EXPECT_EQ("a b", webcc::utility::Trim("a b"));
+  EXPECT_EQ("", webcc::utility::Trim("  "));
+}
@@ -0,0 +1,136 @@
+#include "webcc/async_client.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "boost/asio/connect.hpp"
+#include "boost/asio/ip/tcp.hpp"
+#include "boost/asio/redirect_error.hpp"
+#include "boost/asio/steady_timer.hpp"
+#include "boost/asio/this_coro.hpp"
+#include "boost/asio/use_awaitable.hpp"
+#include "boost/asio/write.hpp"
+
+#include "webcc/logger.h"
+#include "webcc/response_parser.h"
+
+using boost::asio::ip::tcp;
+
+namespace webcc {
+
+boost::asio::awaitable<ResponsePtr> AsyncRequest(RequestPtr request,
+                                                 int timeout) {
+  using boost::asio::redirect_error;
+  using boost::asio::use_awaitable;
+
+  if (request->url().scheme() == "https") {
+    throw Error{ Error::kSyntaxError, "SSL/HTTPS is not supported" };
+  }
+
+  request->Prepare();
+
+  auto executor = co_await boost::asio::this_coro::executor;
+
+  boost::system::error_code ec;
+
+  std::string port = request->port();
+  if (port.empty()) {
+    port = "80";
+  }
+
+  tcp::resolver resolver(executor);
+  auto endpoints = co_await resolver.async_resolve(
+      tcp::v4(), request->host(), port, redirect_error(use_awaitable, ec));
+  if (ec) {
+    LOG_ERRO("Host resolve error (%s): %s, %s.", ec.message().c_str(),
+             request->host().c_str(), port.c_str());
+    throw Error{ Error::kResolveError, "Host resolve error" };
+  }
+
+  // Shared with the timer handler which might outlive this coroutine.
+  auto socket_ptr = std::make_shared<tcp::socket>(executor);
+  auto timed_out_ptr = std::make_shared<bool>(false);
+
+  tcp::socket& socket = *socket_ptr;
+  const bool& timed_out = *timed_out_ptr;
+
+  // Close the socket on timeout so that the pending operation is canceled.
+  // The timer is canceled on destruction, i.e., when the coroutine returns.
+  boost::asio::steady_timer timer(executor, std::chrono::seconds(timeout));
+  timer.async_wait([socket_ptr, timed_out_ptr](boost::system::error_code ec) {
+    if (ec != boost::asio::error::operation_aborted) {
+      LOG_WARN("HTTP client timed out.");
+      *timed_out_ptr = true;
+      boost::system::error_code ignored_ec;
+      socket_ptr->close(ignored_ec);
+    }
+  });
+
+  co_await boost::asio::async_connect(socket, endpoints,
+                                      redirect_error(use_awaitable, ec));
+  if (ec) {
+    LOG_ERRO("Endpoint connect error (%s).", ec.message().c_str());
+    Error error{ Error::kConnectError, "Endpoint connect error" };
+    error.set_timeout(timed_out);
+    throw error;
+  }
+
+  LOG_VERB("HTTP request:\n%s", request->Dump().c_str());
+
+  co_await boost::asio::async_write(socket, request->GetPayload(),
+                                    redirect_error(use_awaitable, ec));
+  if (!ec) {
+    auto body = request->body();
+    body->InitPayload();
+    for (auto p = body->NextPayload(true); !p.empty();
+         p = body->NextPayload(true)) {
+      co_await boost::asio::async_write(socket, p,
+                                        redirect_error(use_awaitable, ec));
+      if (ec) {
+        break;
+      }
+    }
+  }
+  if (ec) {
+    LOG_ERRO("Socket write error (%s).", ec.message().c_str());
+    Error error{ Error::kSocketWriteError, "Socket write error" };
+    error.set_timeout(timed_out);
+    throw error;
+  }
+
+  auto response = std::make_shared<Response>();
+
+  ResponseParser response_parser;
+  response_parser.Init(response.get());
+  // See Client::Request().
+  response_parser.set_ignroe_body(request->method() == methods::kHead);
+
+  std::vector<char> buffer(kBufferSize);
+
+  while (!response_parser.finished()) {
+    std::size_t length = co_await socket.async_read_some(
+        boost::asio::buffer(buffer), redirect_error(use_awaitable, ec));
+
+    if (ec || length == 0) {
+      LOG_ERRO("Socket read error (%s).", ec.message().c_str());
+      Error error{ Error::kSocketReadError, "Socket read error" };
+      error.set_timeout(timed_out);
+      throw error;
+    }
+
+    if (!response_parser.Parse(buffer.data(), length)) {
+      LOG_ERRO("Failed to parse the HTTP response.");
+      throw Error{ Error::kParseError, "HTTP parse error" };
+    }
+  }
+
+  LOG_VERB("HTTP response:\n%s", response->Dump().c_str());
+
+  boost::system::error_code ignored_ec;
+  socket.shutdown(tcp::socket::shutdown_both, ignored_ec);
+
+  co_return response;
+}
+
+}  // namespace webcc
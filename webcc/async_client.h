@@ -0,0 +1,38 @@
+#ifndef WEBCC_ASYNC_CLIENT_H_
+#define WEBCC_ASYNC_CLIENT_H_
+
+// C++20 coroutine support (WEBCC_ENABLE_COROUTINE).
+
+#include "webcc/config.h"
+
+#if !WEBCC_ENABLE_COROUTINE
+#error "Coroutine support is not enabled (WEBCC_ENABLE_COROUTINE)."
+#endif
+
+// NOTE: Asio 1.74's awaitable.hpp uses std::exchange without including it.
+#include <utility>
+
+#include "boost/asio/awaitable.hpp"
+
+#include "webcc/globals.h"
+#include "webcc/request.h"
+#include "webcc/response.h"
+
+namespace webcc {
+
+// The coroutine version of Client::Request().
+// Connect to the server, send the request and wait until the response is
+// received or |timeout| (seconds) occurs, all without blocking the thread.
+// The operations run on the executor of the calling coroutine, e.g., in a
+// CoroutineView, the loop of the connection.
+// A new connection is created for each request and closed afterwards.
+// Only HTTP is supported, throw Error on any failure.
+// E.g.,
+//   auto r = co_await webcc::AsyncRequest(
+//       webcc::RequestBuilder{}.Get("http://localhost:8080/books")());
+boost::asio::awaitable<ResponsePtr> AsyncRequest(
+    RequestPtr request, int timeout = kMaxReadSeconds);
+
+}  // namespace webcc
+
+#endif  // WEBCC_ASYNC_CLIENT_H_
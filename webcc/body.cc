@@ -1,5 +1,7 @@
 #include "webcc/body.h"
 
+#include <algorithm>
+
 #include "boost/algorithm/string.hpp"
 #include "boost/core/ignore_unused.hpp"
 #include "boost/filesystem/operations.hpp"
@@ -7,10 +9,6 @@
 #include "webcc/logger.h"
 #include "webcc/utility.h"
 
-#if WEBCC_ENABLE_GZIP
-#include "webcc/gzip.h"
-#endif
-
 namespace bfs = boost::filesystem;
 
 namespace webcc {
@@ -82,6 +80,116 @@ void StringBody::Dump(std::ostream& os, const std::string& prefix) const {
 
 // -----------------------------------------------------------------------------
 
+void SharedBody::InitPayload() {
+  index_ = 0;
+}
+
+Payload SharedBody::NextPayload(bool free_previous) {
+  boost::ignore_unused(free_previous);
+
+  if (index_ == 0) {
+    index_ = 1;
+    return { boost::asio::buffer(data_->data() + offset_, size_) };
+  }
+  return {};
+}
+
+void SharedBody::Dump(std::ostream& os, const std::string& prefix) const {
+  if (size_ > 0) {
+    utility::DumpByLine(data_->substr(offset_, size_), os, prefix);
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+void StreamBody::InitPayload() {
+  ended_ = false;
+}
+
+Payload StreamBody::NextPayload(bool free_previous) {
+  boost::ignore_unused(free_previous);
+
+  while (!ended_) {
+    data_.clear();
+    if (!generator_(&data_)) {
+      ended_ = true;
+      break;
+    }
+
+    // Skip the empty pieces, an empty payload means the end.
+    if (!data_.empty()) {
+      return { boost::asio::buffer(data_) };
+    }
+  }
+
+  return {};
+}
+
+void StreamBody::Dump(std::ostream& os, const std::string& prefix) const {
+  os << prefix << "<stream>" << std::endl;
+}
+
+// -----------------------------------------------------------------------------
+
+#if WEBCC_ENABLE_GZIP
+
+namespace {
+
+// Compress the source payloads until a chunk of at least this size is ready,
+// so that the chunks are not too small.
+const std::size_t kGzipChunkSize = 16 * 1024;
+
+}  // namespace
+
+void GzipBody::InitPayload() {
+  source_->InitPayload();
+
+  if (!compressor_.Init(level_)) {
+    throw Error{ Error::kUnknownError, "Cannot initialize the compressor" };
+  }
+
+  chunk_.reserve(kGzipChunkSize * 2);
+  ended_ = false;
+}
+
+Payload GzipBody::NextPayload(bool free_previous) {
+  chunk_.clear();
+
+  while (!ended_ && chunk_.size() < kGzipChunkSize) {
+    auto payload = source_->NextPayload(free_previous);
+
+    if (payload.empty()) {
+      ended_ = true;
+      if (!compressor_.Compress(nullptr, 0, true, &chunk_)) {
+        throw Error{ Error::kDataError, "Cannot compress the body" };
+      }
+      break;
+    }
+
+    for (auto& buffer : payload) {
+      if (!compressor_.Compress(static_cast<const char*>(buffer.data()),
+                                buffer.size(), false, &chunk_)) {
+        ended_ = true;
+        throw Error{ Error::kDataError, "Cannot compress the body" };
+      }
+    }
+  }
+
+  if (chunk_.empty()) {
+    return {};
+  }
+  return { boost::asio::buffer(chunk_) };
+}
+
+void GzipBody::Dump(std::ostream& os, const std::string& prefix) const {
+  os << prefix << "<gzip>" << std::endl;
+  source_->Dump(os, prefix);
+}
+
+#endif  // WEBCC_ENABLE_GZIP
+
+// -----------------------------------------------------------------------------
+
 FormBody::FormBody(const std::vector<FormPartPtr>& parts,
                    const std::string& boundary)
     : parts_(parts), boundary_(boundary) {
@@ -184,6 +292,11 @@ FileBody::~FileBody() {
   }
 }
 
+void FileBody::SetRange(std::size_t offset, std::size_t size) {
+  offset_ = offset;
+  size_ = size;
+}
+
 void FileBody::InitPayload() {
   assert(chunk_size_ > 0);
 
@@ -198,15 +311,22 @@ void FileBody::InitPayload() {
   if (ifstream_.fail()) {
     throw Error{ Error::kFileError, "Cannot read the file" };
   }
+
+  if (offset_ > 0) {
+    ifstream_.seekg(static_cast<std::streamoff>(offset_));
+  }
+
+  remaining_ = size_;
 }
 
 Payload FileBody::NextPayload(bool free_previous) {
   boost::ignore_unused(free_previous);
 
-  if (ifstream_.read(&chunk_[0], chunk_.size()).gcount() > 0) {
-    return {
-      boost::asio::buffer(chunk_.data(), (std::size_t)ifstream_.gcount())
-    };
+  std::size_t count = std::min(chunk_.size(), remaining_);
+  if (count > 0 && ifstream_.read(&chunk_[0], count).gcount() > 0) {
+    std::size_t length = static_cast<std::size_t>(ifstream_.gcount());
+    remaining_ -= length;
+    return { boost::asio::buffer(chunk_.data(), length) };
   }
   return {};
 }
@@ -238,4 +358,102 @@ bool FileBody::Move(const Path& new_path) {
   return true;
 }
 
+// -----------------------------------------------------------------------------
+
+ByteRangesBody::ByteRangesBody(const Path& path, std::size_t file_size,
+                               const std::vector<ByteRange>& ranges,
+                               const std::string& media_type,
+                               const std::string& boundary,
+                               std::size_t chunk_size)
+    : path_(path), ranges_(ranges), chunk_size_(chunk_size) {
+  if (utility::TellSize(path_) == kInvalidLength) {
+    throw Error{ Error::kFileError, "Cannot read the file" };
+  }
+
+  for (std::size_t i = 0; i < ranges_.size(); ++i) {
+    std::string headers;
+    if (i > 0) {
+      headers += "\r\n";  // End of the previous part
+    }
+    headers += "--" + boundary + "\r\n";
+    if (!media_type.empty()) {
+      headers += std::string(headers::kContentType) + ": " + media_type +
+                 "\r\n";
+    }
+    headers += std::string(headers::kContentRange) + ": " +
+               Range::ContentRange(ranges_[i], file_size) + "\r\n\r\n";
+    part_headers_.push_back(std::move(headers));
+  }
+
+  end_ = "\r\n--" + boundary + "--\r\n";
+}
+
+std::size_t ByteRangesBody::GetSize() const {
+  std::size_t size = end_.size();
+  for (std::size_t i = 0; i < ranges_.size(); ++i) {
+    size += part_headers_[i].size() + ranges_[i].length();
+  }
+  return size;
+}
+
+void ByteRangesBody::InitPayload() {
+  assert(chunk_size_ > 0);
+
+  chunk_.resize(chunk_size_);
+
+  if (ifstream_.is_open()) {
+    ifstream_.close();
+  }
+
+  ifstream_.open(path_, std::ios::binary);
+
+  if (ifstream_.fail()) {
+    throw Error{ Error::kFileError, "Cannot read the file" };
+  }
+
+  index_ = 0;
+  header_sent_ = false;
+  remaining_ = 0;
+}
+
+Payload ByteRangesBody::NextPayload(bool free_previous) {
+  boost::ignore_unused(free_previous);
+
+  while (index_ < ranges_.size()) {
+    if (!header_sent_) {
+      header_sent_ = true;
+      ifstream_.seekg(static_cast<std::streamoff>(ranges_[index_].first));
+      remaining_ = ranges_[index_].length();
+      return { boost::asio::buffer(part_headers_[index_]) };
+    }
+
+    std::size_t count = std::min(chunk_.size(), remaining_);
+    if (count > 0) {
+      if (ifstream_.read(&chunk_[0], count).gcount() <= 0) {
+        return {};  // The file has been truncated.
+      }
+      std::size_t length = static_cast<std::size_t>(ifstream_.gcount());
+      remaining_ -= length;
+      return { boost::asio::buffer(chunk_.data(), length) };
+    }
+
+    ++index_;
+    header_sent_ = false;
+  }
+
+  if (index_ == ranges_.size()) {
+    ++index_;
+    return { boost::asio::buffer(end_) };
+  }
+
+  return {};
+}
+
+void ByteRangesBody::Dump(std::ostream& os, const std::string& prefix) const {
+  for (std::size_t i = 0; i < ranges_.size(); ++i) {
+    os << prefix << "<file: " << path_.string() << ", bytes "
+       << ranges_[i].first << "-" << ranges_[i].last << ">" << std::endl;
+  }
+}
+
 }  // namespace webcc
@@ -1,14 +1,20 @@
 #ifndef WEBCC_BODY_H_
 #define WEBCC_BODY_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "boost/filesystem/fstream.hpp"
 
 #include "webcc/common.h"
 
+#if WEBCC_ENABLE_GZIP
+#include "webcc/gzip.h"
+#endif
+
 namespace webcc {
 
 // -----------------------------------------------------------------------------
@@ -57,6 +63,13 @@ public:
     return {};
   }
 
+  // Do the payloads stay valid until the end of the iteration?
+  // If so, the payloads could be gathered into a single write. Otherwise, a
+  // payload must be written before the next one is got.
+  virtual bool IsPayloadStable() const {
+    return true;
+  }
+
   // Dump to output stream for logging purpose.
   virtual void Dump(std::ostream& os, const std::string& prefix) const {
   }
@@ -114,6 +127,143 @@ private:
 
 // -----------------------------------------------------------------------------
 
+// Body sharing the (immutable) data with others, e.g., a file in the file
+// cache, so the data is not copied for each message.
+class SharedBody : public Body {
+public:
+  explicit SharedBody(std::shared_ptr<const std::string> data)
+      : data_(std::move(data)), offset_(0), size_(data_->size()) {
+  }
+
+  // Only the part [offset, offset + size) of the data is the body.
+  SharedBody(std::shared_ptr<const std::string> data, std::size_t offset,
+             std::size_t size)
+      : data_(std::move(data)), offset_(offset), size_(size) {
+    assert(offset_ + size_ <= data_->size());
+  }
+
+  std::size_t GetSize() const override {
+    return size_;
+  }
+
+  const std::string& data() const {
+    return *data_;
+  }
+
+  void InitPayload() override;
+
+  Payload NextPayload(bool free_previous = false) override;
+
+  void Dump(std::ostream& os, const std::string& prefix) const override;
+
+private:
+  std::shared_ptr<const std::string> data_;
+  std::size_t offset_;
+  std::size_t size_;
+
+  // Index for (not really) iterating the payload.
+  std::size_t index_ = 0;
+};
+
+// -----------------------------------------------------------------------------
+
+// Body produced piece by piece by a generator, e.g., a large JSON export or the
+// rows from a database cursor, without building the whole of it in memory.
+// The size is unknown up front, so the body is sent with the chunked transfer
+// coding.
+class StreamBody : public Body {
+public:
+  // Set the next piece of the data to |data| and return true, or return false
+  // at the end.
+  // It's called only after the previous piece has been written to the socket,
+  // so one piece at a time is held in memory and a slow client slows down the
+  // generator instead of piling up the data.
+  // The first call might be in the (worker) thread which produced the
+  // response, the later calls are in the loop thread. The calls never overlap
+  // but the generator must not rely on a particular thread. It should not
+  // block for long.
+  using Generator = std::function<bool(std::string* data)>;
+
+  explicit StreamBody(Generator generator)
+      : generator_(std::move(generator)) {
+  }
+
+  // The size is unknown.
+  std::size_t GetSize() const override {
+    return kInvalidLength;
+  }
+
+  void InitPayload() override;
+
+  Payload NextPayload(bool free_previous = false) override;
+
+  // The pieces are generated into the same buffer one by one.
+  bool IsPayloadStable() const override {
+    return false;
+  }
+
+  void Dump(std::ostream& os, const std::string& prefix) const override;
+
+private:
+  Generator generator_;
+
+  // The current piece.
+  std::string data_;
+
+  bool ended_ = false;
+};
+
+// -----------------------------------------------------------------------------
+
+#if WEBCC_ENABLE_GZIP
+
+// Body compressing another body (e.g., a FileBody or a StreamBody) with gzip
+// on the fly, payload by payload. The memory it takes is fixed (the zlib state
+// plus a compressed chunk) no matter how large the source body is.
+// The compressed size is unknown up front, so the body is sent with the
+// chunked transfer coding.
+class GzipBody : public Body {
+public:
+  explicit GzipBody(BodyPtr source, int level = gzip::kDefaultLevel)
+      : source_(std::move(source)), level_(level) {
+  }
+
+  // The size is unknown.
+  std::size_t GetSize() const override {
+    return kInvalidLength;
+  }
+
+  // Throw Error::kUnknownError if the compressor can't be initialized.
+  void InitPayload() override;
+
+  // Throw Error::kDataError if the data can't be compressed, which must not be
+  // taken as the end of the body.
+  Payload NextPayload(bool free_previous = false) override;
+
+  // The chunks are compressed into the same buffer one by one.
+  bool IsPayloadStable() const override {
+    return false;
+  }
+
+  void Dump(std::ostream& os, const std::string& prefix) const override;
+
+private:
+  BodyPtr source_;
+
+  int level_;
+
+  gzip::Compressor compressor_;
+
+  // The compressed chunk.
+  std::string chunk_;
+
+  bool ended_ = false;
+};
+
+#endif  // WEBCC_ENABLE_GZIP
+
+// -----------------------------------------------------------------------------
+
 // Multi-part form body for request.
 class FormBody : public Body {
 public:
@@ -167,16 +317,30 @@ public:
     return size_;
   }
 
+  // Send only the part [offset, offset + size) of the file, e.g., for a Range
+  // request. Must be called before InitPayload().
+  void SetRange(std::size_t offset, std::size_t size);
+
   void InitPayload() override;
 
   Payload NextPayload(bool free_previous = false) override;
 
+  // The chunks are read into the same buffer one by one.
+  bool IsPayloadStable() const override {
+    return false;
+  }
+
   void Dump(std::ostream& os, const std::string& prefix) const override;
 
   const Path& path() const {
     return path_;
   }
 
+  // The offset in the file to send from.
+  std::size_t offset() const {
+    return offset_;
+  }
+
   // Move (or rename) the file.
   // Used to move the streamed file of the received message to a new place.
   // Applicable to both client and server.
@@ -194,7 +358,72 @@ private:
   std::size_t chunk_size_;
   bool auto_delete_;
 
-  std::size_t size_;  // File size in bytes
+  std::size_t offset_ = 0;
+  std::size_t size_;  // File size (or range size) in bytes
+
+  // The bytes left to read.
+  std::size_t remaining_ = 0;
+
+  boost::filesystem::ifstream ifstream_;
+  std::string chunk_;
+};
+
+// -----------------------------------------------------------------------------
+
+// Multiple ranges of a file, sent as a multipart/byteranges body, e.g.,
+//   --THIS_STRING_SEPARATES
+//   Content-Type: application/pdf
+//   Content-Range: bytes 500-999/8000
+//
+//   ...the first range...
+//   --THIS_STRING_SEPARATES
+//   Content-Type: application/pdf
+//   Content-Range: bytes 7000-7999/8000
+//
+//   ...the second range...
+//   --THIS_STRING_SEPARATES--
+// See: https://tools.ietf.org/html/rfc7233#section-4.1
+class ByteRangesBody : public Body {
+public:
+  // |file_size| is the size of the whole file.
+  // Throw Error::kFileError if the file can't be read.
+  ByteRangesBody(const Path& path, std::size_t file_size,
+                 const std::vector<ByteRange>& ranges,
+                 const std::string& media_type, const std::string& boundary,
+                 std::size_t chunk_size);
+
+  std::size_t GetSize() const override;
+
+  void InitPayload() override;
+
+  Payload NextPayload(bool free_previous = false) override;
+
+  // The chunks are read into the same buffer one by one.
+  bool IsPayloadStable() const override {
+    return false;
+  }
+
+  void Dump(std::ostream& os, const std::string& prefix) const override;
+
+private:
+  Path path_;
+  std::vector<ByteRange> ranges_;
+  std::size_t chunk_size_;
+
+  // The boundary and headers before each part.
+  std::vector<std::string> part_headers_;
+
+  // The final boundary.
+  std::string end_;
+
+  // Index of the current part, ranges_.size() for the final boundary.
+  std::size_t index_ = 0;
+
+  // The headers of the current part have been sent or not.
+  bool header_sent_ = false;
+
+  // The bytes left to read of the current part.
+  std::size_t remaining_ = 0;
 
   boost::filesystem::ifstream ifstream_;
   std::string chunk_;
@@ -0,0 +1,47 @@
+#include "webcc/buffer_pool.h"
+
+#include <cassert>
+
+namespace webcc {
+
+BufferPool::BufferPool(std::size_t buffer_size, std::size_t slab_buffers)
+    : buffer_size_(buffer_size), slab_buffers_(slab_buffers) {
+  assert(buffer_size > 0);
+  assert(slab_buffers > 0);
+}
+
+char* BufferPool::Acquire() {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (free_.empty()) {
+    // A new slab, carved into the buffers.
+    std::unique_ptr<char[]> slab{ new char[buffer_size_ * slab_buffers_] };
+    for (std::size_t i = slab_buffers_; i > 0; --i) {
+      free_.push_back(slab.get() + buffer_size_ * (i - 1));
+    }
+    slabs_.push_back(std::move(slab));
+  }
+
+  char* buffer = free_.back();
+  free_.pop_back();
+  return buffer;
+}
+
+void BufferPool::Release(char* buffer) {
+  assert(buffer != nullptr);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  free_.push_back(buffer);
+}
+
+std::size_t BufferPool::capacity() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return slabs_.size() * slab_buffers_;
+}
+
+std::size_t BufferPool::free_size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return free_.size();
+}
+
+}  // namespace webcc
@@ -0,0 +1,55 @@
+#ifndef WEBCC_BUFFER_POOL_H_
+#define WEBCC_BUFFER_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace webcc {
+
+// A pool of fixed-size buffers, allocated in slabs of a number of buffers.
+// The connections waiting for their requests don't hold any read buffer but
+// take one from the pool only when the data has arrived, and give it back as
+// soon as the data has been parsed. So the buffers needed are as many as the
+// reads in progress at the same time, instead of one per connection.
+// The slabs are kept until the pool is destroyed.
+class BufferPool {
+public:
+  explicit BufferPool(std::size_t buffer_size, std::size_t slab_buffers = 64);
+
+  ~BufferPool() = default;
+
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  std::size_t buffer_size() const {
+    return buffer_size_;
+  }
+
+  // Take a buffer of buffer_size() bytes.
+  char* Acquire();
+
+  // Give back a buffer taken by Acquire().
+  void Release(char* buffer);
+
+  // The number of the buffers allocated so far, free or not.
+  std::size_t capacity() const;
+
+  // The number of the buffers free to acquire.
+  std::size_t free_size() const;
+
+private:
+  const std::size_t buffer_size_;
+  const std::size_t slab_buffers_;
+
+  std::vector<std::unique_ptr<char[]>> slabs_;
+  std::vector<char*> free_;
+
+  // Mutex is necessary if the loop is running in multiple threads.
+  mutable std::mutex mutex_;
+};
+
+}  // namespace webcc
+
+#endif  // WEBCC_BUFFER_POOL_H_
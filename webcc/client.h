@@ -41,6 +41,13 @@ public:
     }
   }
 
+  // Set the max ratio of the decompressed size to the compressed size of the
+  // content of a response, 0 means no limit. Default: 0.
+  // See kMaxDecompressionRatio.
+  void set_max_decompression_ratio(std::size_t max_decompression_ratio) {
+    response_parser_.set_max_decompression_ratio(max_decompression_ratio);
+  }
+
   // Set the timeout (in seconds) for reading response.
   void set_timeout(int timeout)  {
     if (timeout > 0) {
@@ -31,7 +31,7 @@ void ClientSession::AuthToken(const std::string& token) {
 ResponsePtr ClientSession::Send(RequestPtr request, bool stream) {
   assert(request);
 
-  for (auto& h : headers_.data()) {
+  for (auto& h : headers_) {
     if (!request->HasHeader(h.first)) {
       request->SetHeader(h.first, h.second);
     }
@@ -102,6 +102,7 @@ ResponsePtr ClientSession::DoSend(RequestPtr request, bool stream) {
 
   client->set_ssl_verify(ssl_verify_);
   client->set_buffer_size(buffer_size_);
+  client->set_max_decompression_ratio(max_decompression_ratio_);
   client->set_timeout(timeout_);
  
   Error error = client->Request(request, !reuse, stream);
@@ -34,6 +34,14 @@ public:
     buffer_size_ = buffer_size;
   }
 
+  // Set the max ratio of the decompressed size to the compressed size of the
+  // content of a response. A response expanding further (e.g., a "zip bomb")
+  // is rejected. Only checked once the decompressed size exceeds 1MB.
+  // 0 means no limit. Default: 0.
+  void set_max_decompression_ratio(std::size_t max_decompression_ratio) {
+    max_decompression_ratio_ = max_decompression_ratio;
+  }
+
   void SetHeader(const std::string& key, const std::string& value) {
     headers_.Set(key, value);
   }
@@ -90,6 +98,10 @@ private:
   // 0 means default value will be used.
   std::size_t buffer_size_;
 
+  // The max ratio of the decompressed size to the compressed size of a
+  // response, 0 means no limit.
+  std::size_t max_decompression_ratio_ = 0;
+
   // Pool for Keep-Alive client connections.
   ClientPool pool_;
 };
@@ -11,63 +11,157 @@ namespace webcc {
 
 // -----------------------------------------------------------------------------
 
+std::uint32_t HashHeaderName(boost::string_view name) {
+  std::uint32_t hash = 2166136261u;
+  for (char c : name) {
+    if (c >= 'A' && c <= 'Z') {
+      c += 32;
+    }
+    hash = (hash ^ static_cast<std::uint8_t>(c)) * 16777619u;
+  }
+  return hash;
+}
+
+HeaderId ToHeaderId(boost::string_view name, std::uint32_t hash) {
+  // The case labels are computed at compile time, and duplicate case labels
+  // don't compile, so the hash is guaranteed to be perfect for the well-known
+  // names. Other names might have the same hashes, so the names are still
+  // compared.
+#define WEBCC_HEADER_ID_CASE(id)                                \
+  case HashHeaderName(headers::id):                             \
+    return utility::IEquals(name, headers::id) ? HeaderId::id   \
+                                               : HeaderId::kOther;
+
+  switch (hash) {
+    WEBCC_HEADER_ID_CASE(kHost)
+    WEBCC_HEADER_ID_CASE(kDate)
+    WEBCC_HEADER_ID_CASE(kAuthorization)
+    WEBCC_HEADER_ID_CASE(kContentType)
+    WEBCC_HEADER_ID_CASE(kContentLength)
+    WEBCC_HEADER_ID_CASE(kContentEncoding)
+    WEBCC_HEADER_ID_CASE(kContentDisposition)
+    WEBCC_HEADER_ID_CASE(kConnection)
+    WEBCC_HEADER_ID_CASE(kTransferEncoding)
+    WEBCC_HEADER_ID_CASE(kAccept)
+    WEBCC_HEADER_ID_CASE(kAcceptEncoding)
+    WEBCC_HEADER_ID_CASE(kUserAgent)
+    WEBCC_HEADER_ID_CASE(kServer)
+    WEBCC_HEADER_ID_CASE(kETag)
+    WEBCC_HEADER_ID_CASE(kLastModified)
+    WEBCC_HEADER_ID_CASE(kIfNoneMatch)
+    WEBCC_HEADER_ID_CASE(kIfModifiedSince)
+    WEBCC_HEADER_ID_CASE(kRange)
+    WEBCC_HEADER_ID_CASE(kIfRange)
+    WEBCC_HEADER_ID_CASE(kAcceptRanges)
+    WEBCC_HEADER_ID_CASE(kContentRange)
+    WEBCC_HEADER_ID_CASE(kVary)
+    default:
+      return HeaderId::kOther;
+  }
+
+#undef WEBCC_HEADER_ID_CASE
+}
+
+// -----------------------------------------------------------------------------
+
 bool Headers::Set(const std::string& key, const std::string& value) {
+  return Assign(key, value);
+}
+
+bool Headers::Set(std::string&& key, std::string&& value) {
   if (value.empty()) {
     return false;
   }
 
-  auto it = Find(key);
-  if (it != headers_.end()) {
-    it->second = value;
+  std::uint32_t hash = HashHeaderName(key);
+  std::size_t index = Find(key, hash);
+  if (index != kNotFound) {
+    headers_[index].second = std::move(value);
   } else {
-    headers_.push_back({ key, value });
+    Header& header = Append(key, hash);
+    header.first = std::move(key);
+    header.second = std::move(value);
   }
 
   return true;
 }
 
-bool Headers::Set(std::string&& key, std::string&& value) {
+bool Headers::Assign(boost::string_view key, boost::string_view value) {
   if (value.empty()) {
     return false;
   }
 
-  auto it = Find(key);
-  if (it != headers_.end()) {
-    it->second = std::move(value);
+  std::uint32_t hash = HashHeaderName(key);
+  std::size_t index = Find(key, hash);
+  if (index != kNotFound) {
+    headers_[index].second.assign(value.data(), value.size());
   } else {
-    headers_.push_back({ std::move(key), std::move(value) });
+    Header& header = Append(key, hash);
+    header.first.assign(key.data(), key.size());
+    header.second.assign(value.data(), value.size());
   }
 
   return true;
 }
 
-bool Headers::Has(const std::string& key) const {
-  return const_cast<Headers*>(this)->Find(key) != headers_.end();
+const std::string& Headers::Get(boost::string_view key, bool* existed) const {
+  return GetValue(Find(key), existed);
+}
+
+const std::string& Headers::Get(HeaderId id, bool* existed) const {
+  return GetValue(Find(id), existed);
 }
 
-const std::string& Headers::Get(const std::string& key, bool* existed) const {
-  auto it = const_cast<Headers*>(this)->Find(key);
+std::size_t Headers::Find(boost::string_view key) const {
+  return Find(key, HashHeaderName(key));
+}
+
+std::size_t Headers::Find(HeaderId id) const {
+  assert(id != HeaderId::kOther);
 
+  for (std::size_t i = 0; i < keys_.size(); ++i) {
+    if (keys_[i].id == id) {
+      return i;
+    }
+  }
+  return kNotFound;
+}
+
+std::size_t Headers::Find(boost::string_view key, std::uint32_t hash) const {
+  for (std::size_t i = 0; i < keys_.size(); ++i) {
+    if (keys_[i].hash == hash && utility::IEquals(headers_[i].first, key)) {
+      return i;
+    }
+  }
+  return kNotFound;
+}
+
+const std::string& Headers::GetValue(std::size_t index, bool* existed) const {
   if (existed != nullptr) {
-    *existed = (it != headers_.end());
+    *existed = (index != kNotFound);
   }
 
-  if (it != headers_.end()) {
-    return it->second;
+  if (index != kNotFound) {
+    return headers_[index].second;
   }
 
   static const std::string s_no_value;
   return s_no_value;
 }
 
-std::vector<Header>::iterator Headers::Find(const std::string& key) {
-  auto it = headers_.begin();
-  for (; it != headers_.end(); ++it) {
-    if (boost::iequals(it->first, key)) {
-      break;
-    }
+Header& Headers::Append(boost::string_view key, std::uint32_t hash) {
+  if (headers_.empty()) {
+    headers_.reserve(kReservedSize);
+    keys_.reserve(kReservedSize);
+  }
+
+  keys_.push_back({ hash, ToHeaderId(key, hash) });
+
+  // Reuse a cleared header if any.
+  if (keys_.size() > headers_.size()) {
+    headers_.emplace_back();
   }
-  return it;
+  return headers_[keys_.size() - 1];
 }
 
 // -----------------------------------------------------------------------------
@@ -180,6 +274,126 @@ bool ContentDisposition::Init(const std::string& str) {
 
 // -----------------------------------------------------------------------------
 
+namespace {
+
+// The max number of ranges in a Range header.
+const std::size_t kMaxRanges = 32;
+
+// Parse a non-empty string of digits.
+bool ParseBytePos(const std::string& str, std::size_t* pos) {
+  if (str.empty()) {
+    return false;
+  }
+
+  std::size_t value = 0;
+  for (char c : str) {
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    std::size_t digit = static_cast<std::size_t>(c - '0');
+    if (value > (kInvalidLength - digit) / 10) {
+      return false;  // Overflow
+    }
+    value = value * 10 + digit;
+  }
+
+  *pos = value;
+  return true;
+}
+
+}  // namespace
+
+std::string Range::ContentRange(const ByteRange& range, std::size_t size) {
+  return "bytes " + std::to_string(range.first) + "-" +
+         std::to_string(range.last) + "/" + std::to_string(size);
+}
+
+std::string Range::ContentRange(std::size_t size) {
+  return "bytes */" + std::to_string(size);
+}
+
+bool Range::Init(const std::string& str, std::size_t size) {
+  const std::string kUnit = "bytes=";
+
+  if (!boost::istarts_with(str, kUnit)) {
+    return false;
+  }
+
+  std::vector<std::string> specs;
+  boost::split(specs, str.substr(kUnit.size()), boost::is_any_of(","));
+
+  std::size_t count = 0;
+  std::size_t total = 0;
+
+  for (std::string& spec : specs) {
+    boost::trim(spec);
+    if (spec.empty()) {
+      continue;  // Empty list elements are allowed.
+    }
+
+    if (++count > kMaxRanges) {
+      return false;
+    }
+
+    std::size_t pos = spec.find('-');
+    if (pos == std::string::npos) {
+      return false;
+    }
+
+    ByteRange range;
+
+    if (pos == 0) {
+      // Suffix range: the last N bytes.
+      std::size_t suffix = 0;
+      if (!ParseBytePos(spec.substr(1), &suffix)) {
+        return false;
+      }
+      if (suffix == 0 || size == 0) {
+        continue;  // Unsatisfiable
+      }
+      range.first = suffix < size ? size - suffix : 0;
+      range.last = size - 1;
+
+    } else {
+      if (!ParseBytePos(spec.substr(0, pos), &range.first)) {
+        return false;
+      }
+
+      range.last = kInvalidLength;
+      if (pos + 1 < spec.size()) {
+        if (!ParseBytePos(spec.substr(pos + 1), &range.last) ||
+            range.last < range.first) {
+          return false;
+        }
+      }
+
+      if (range.first >= size) {
+        continue;  // Unsatisfiable
+      }
+      if (range.last >= size) {
+        range.last = size - 1;
+      }
+    }
+
+    total += range.length();
+    ranges_.push_back(range);
+  }
+
+  if (count == 0) {
+    return false;
+  }
+
+  if (total > size) {
+    // Overlapping ranges, send the whole instead.
+    ranges_.clear();
+    return false;
+  }
+
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+
 FormPartPtr FormPart::New(const std::string& name, std::string&& data,
                           const std::string& media_type) {
   auto form_part = std::make_shared<FormPart>();
@@ -231,7 +445,7 @@ void FormPart::Prepare(Payload* payload) {
     SetHeaders();
   }
 
-  for (const Header& h : headers_.data()) {
+  for (const Header& h : headers_) {
     payload->push_back(buffer(h.first));
     payload->push_back(buffer(literal_buffers::HEADER_SEPARATOR));
     payload->push_back(buffer(h.second));
@@ -259,7 +473,7 @@ std::size_t FormPart::GetSize() {
     SetHeaders();
   }
 
-  for (const Header& h : headers_.data()) {
+  for (const Header& h : headers_) {
     size += h.first.size();
     size += sizeof(literal_buffers::HEADER_SEPARATOR);
     size += h.second.size();
@@ -288,7 +502,7 @@ std::size_t FormPart::GetDataSize() {
 }
 
 void FormPart::Dump(std::ostream& os, const std::string& prefix) const {
-  for (auto& h : headers_.data()) {
+  for (auto& h : headers_) {
     os << prefix << h.first << ": " << h.second << std::endl;
   }
 
@@ -2,10 +2,13 @@
 #define WEBCC_COMMON_H_
 
 #include <cassert>
+#include <cstdint>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "boost/utility/string_view.hpp"
+
 #include "webcc/globals.h"
 
 namespace webcc {
@@ -14,25 +17,94 @@ namespace webcc {
 
 using Header = std::pair<std::string, std::string>;
 
+// IDs of the well-known headers, i.e., the names in webcc::headers.
+enum class HeaderId : std::uint8_t {
+  kOther = 0,  // Not well-known
+  kHost,
+  kDate,
+  kAuthorization,
+  kContentType,
+  kContentLength,
+  kContentEncoding,
+  kContentDisposition,
+  kConnection,
+  kTransferEncoding,
+  kAccept,
+  kAcceptEncoding,
+  kUserAgent,
+  kServer,
+  kETag,
+  kLastModified,
+  kIfNoneMatch,
+  kIfModifiedSince,
+  kRange,
+  kIfRange,
+  kAcceptRanges,
+  kContentRange,
+  kVary,
+};
+
+// Case-insensitive (ASCII) FNV-1a hash of a header name.
+// It's constexpr so that the hashes of the well-known names are computed at
+// compile time.
+constexpr std::uint32_t HashHeaderName(const char* name,
+                                       std::uint32_t hash = 2166136261u) {
+  return *name == '\0'
+             ? hash
+             : HashHeaderName(
+                   name + 1,
+                   (hash ^ static_cast<std::uint8_t>(
+                               (*name >= 'A' && *name <= 'Z') ? *name + 32
+                                                              : *name)) *
+                       16777619u);
+}
+
+// The same hash as above, for the names not null-terminated.
+std::uint32_t HashHeaderName(boost::string_view name);
+
+// Get the ID of a header name with its hash, kOther if it's not well-known.
+HeaderId ToHeaderId(boost::string_view name, std::uint32_t hash);
+
+// The headers of a message.
+// The headers are kept in the insertion order for the serialization, and each
+// is indexed by the hash and the ID of its name. A lookup compares the hashes
+// (or the IDs of the well-known headers) in a small contiguous array, and the
+// names only when the hashes are equal.
 class Headers {
 public:
+  using const_iterator = std::vector<Header>::const_iterator;
+
   std::size_t size() const {
-    return headers_.size();
+    return keys_.size();
   }
 
   bool empty() const {
-    return headers_.empty();
+    return keys_.empty();
+  }
+
+  const_iterator begin() const {
+    return headers_.begin();
   }
 
-  const std::vector<Header>& data() const {
-    return headers_;
+  const_iterator end() const {
+    return headers_.begin() + keys_.size();
   }
 
   bool Set(const std::string& key, const std::string& value);
 
   bool Set(std::string&& key, std::string&& value);
 
-  bool Has(const std::string& key) const;
+  // Set a header as above, copying the key and the value into the memory of
+  // a cleared header if any, e.g., by the parser of a recycled request.
+  bool Assign(boost::string_view key, boost::string_view value);
+
+  bool Has(boost::string_view key) const {
+    return Find(key) != kNotFound;
+  }
+
+  bool Has(HeaderId id) const {
+    return Find(id) != kNotFound;
+  }
 
   // Get header by index.
   const Header& Get(std::size_t index) const {
@@ -43,16 +115,47 @@ public:
   // Get header value by key.
   // If there's no such header with the given key, besides return empty, the
   // optional |existed| parameter will be set to false.
-  const std::string& Get(const std::string& key, bool* existed = nullptr) const;
+  const std::string& Get(boost::string_view key,
+                         bool* existed = nullptr) const;
+
+  // Get header value by the ID of a well-known header, which doesn't even
+  // hash the name.
+  const std::string& Get(HeaderId id, bool* existed = nullptr) const;
 
+  // Remove all the headers.
+  // The strings of the headers are kept (but not accessible) to be reused by
+  // the headers set next.
   void Clear() {
-    headers_.clear();
+    keys_.clear();
   }
 
 private:
-  std::vector<Header>::iterator Find(const std::string& key);
+  static const std::size_t kNotFound = static_cast<std::size_t>(-1);
 
+  // Most messages have no more headers than this, reserve them at once.
+  static const std::size_t kReservedSize = 16;
+
+  struct Key {
+    std::uint32_t hash;
+    HeaderId id;
+  };
+
+  std::size_t Find(boost::string_view key) const;
+  std::size_t Find(HeaderId id) const;
+
+  // Find the index of the header with the hash first.
+  std::size_t Find(boost::string_view key, std::uint32_t hash) const;
+
+  const std::string& GetValue(std::size_t index, bool* existed) const;
+
+  // Append a header with an empty key and value, return it.
+  Header& Append(boost::string_view key, std::uint32_t hash);
+
+  // The headers in the order set, the first size() ones are valid.
   std::vector<Header> headers_;
+
+  // The keys of the valid headers, in the same order.
+  std::vector<Key> keys_;
 };
 
 // -----------------------------------------------------------------------------
@@ -135,6 +238,67 @@ private:
 
 // -----------------------------------------------------------------------------
 
+// A byte range of a representation, both ends are inclusive.
+struct ByteRange {
+  std::size_t first = 0;
+  std::size_t last = 0;
+
+  std::size_t length() const {
+    return last - first + 1;
+  }
+};
+
+// Range header (only the bytes unit is supported).
+// Syntax:
+//   Range: bytes=0-499
+//   Range: bytes=500-
+//   Range: bytes=-500
+//   Range: bytes=0-99, 200-299
+// https://tools.ietf.org/html/rfc7233#section-3.1
+class Range {
+public:
+  // Parse the header for a representation of |size| bytes.
+  Range(const std::string& str, std::size_t size) {
+    valid_ = Init(str, size);
+  }
+
+  // An invalid header should be ignored, i.e., the whole representation is
+  // sent as if there's no Range header.
+  // A header with too many ranges or overlapping ranges (more bytes in total
+  // than the representation) is also considered invalid, see:
+  //   https://tools.ietf.org/html/rfc7233#section-6.1
+  bool valid() const {
+    return valid_;
+  }
+
+  // Is any of the ranges satisfiable? Otherwise, 416 should be responded.
+  bool satisfiable() const {
+    return !ranges_.empty();
+  }
+
+  // The satisfiable ranges, resolved against the size.
+  const std::vector<ByteRange>& ranges() const {
+    return ranges_;
+  }
+
+  // Format the value of the Content-Range header for a range.
+  // E.g., "bytes 0-499/1234".
+  static std::string ContentRange(const ByteRange& range, std::size_t size);
+
+  // Format the value of the Content-Range header for an unsatisfiable range.
+  // E.g., "bytes */1234".
+  static std::string ContentRange(std::size_t size);
+
+private:
+  bool Init(const std::string& str, std::size_t size);
+
+private:
+  std::vector<ByteRange> ranges_;
+  bool valid_ = false;
+};
+
+// -----------------------------------------------------------------------------
+
 class FormPart;
 using FormPartPtr = std::shared_ptr<FormPart>;
 
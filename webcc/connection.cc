@@ -1,24 +1,140 @@
 #include "webcc/connection.h"
 
+#include <atomic>
+#include <cstdio>
 #include <utility>
 
+#include "boost/asio/post.hpp"
 #include "boost/asio/write.hpp"
 
+#include "webcc/body.h"
 #include "webcc/connection_pool.h"
 #include "webcc/logger.h"
 
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+#endif
+
 using boost::asio::ip::tcp;
 
 namespace webcc {
 
+namespace {
+
+// The max number of buffers gathered into a single write.
+// Asio writes at most 64 buffers with a single syscall.
+const std::size_t kMaxWriteBuffers = 64;
+
+// The max number of bytes gathered into a single write.
+const std::size_t kMaxWriteBytes = 256 * 1024;
+
+// The last chunk (and the end of the body) of the chunked transfer coding.
+const char kLastChunk[] = "0\r\n\r\n";
+
+#if defined(TCP_CORK)
+using tcp_cork = boost::asio::detail::socket_option::boolean<IPPROTO_TCP,
+                                                             TCP_CORK>;
+#endif
+
+// The responder of a connection.
+class ConnectionResponder : public Responder {
+public:
+  explicit ConnectionResponder(ConnectionPtr connection)
+      : connection_(connection), sent_(false) {
+  }
+
+  ~ConnectionResponder() override {
+    if (!sent_) {
+      LOG_WARN("Responder released without any response sent.");
+      Send(Status::kInternalServerError);
+    }
+  }
+
+  executor_type get_executor() const override {
+    return connection_->get_executor();
+  }
+
+  void Send(ResponsePtr response) override {
+    assert(response);
+
+    if (sent_.exchange(true)) {
+      LOG_WARN("The response has already been sent.");
+      return;
+    }
+
+    connection_->PostResponse(response);
+  }
+
+  void Send(Status status) override {
+    if (sent_.exchange(true)) {
+      LOG_WARN("The response has already been sent.");
+      return;
+    }
+
+    connection_->PostResponse(status);
+  }
+
+private:
+  ConnectionPtr connection_;
+  std::atomic<bool> sent_;
+};
+
+}  // namespace
+
+// -----------------------------------------------------------------------------
+
 Connection::Connection(tcp::socket socket, ConnectionPool* pool,
-                       Queue<ConnectionPtr>* queue, ViewMatcher&& view_matcher)
+                       ConnectionQueue* queue, ViewMatcher&& view_matcher,
+                       ConnectionHandler&& handler, TimerWheelPtr timer_wheel,
+                       const ConnectionSettings* settings)
     : socket_(std::move(socket)), pool_(pool), queue_(queue),
-      view_matcher_(std::move(view_matcher)), buffer_(kBufferSize) {
+      view_matcher_(std::move(view_matcher)), handler_(std::move(handler)),
+      buffer_(settings->pooled_read_buffers ? 0 : kBufferSize),
+      body_ended_(false), chunked_(false),
+      corked_(false),
+      keep_alive_(false), file_fd_(-1), file_offset_(0),
+      file_remaining_(0), requests_(0),
+      timer_wheel_(std::move(timer_wheel)), settings_(settings),
+      read_stage_(ReadStage::kIdle) {
+  assert(timer_wheel_);
+  assert(settings_ != nullptr);
+
+  request_parser_.set_max_decompression_ratio(
+      settings_->max_decompression_ratio);
+}
+
+Connection::~Connection() {
+  CancelTimeout();
+  CloseFile();
 }
 
 void Connection::Start() {
-  request_.reset(new Request{});
+  // Recycle the last request unless it's still referenced (e.g., by an async
+  // view), so that the next request is parsed into the memory of its strings
+  // instead of allocating them again.
+  if (request_ && request_.use_count() == 1) {
+    request_->Clear();
+  } else {
+    request_ = std::make_shared<Request>();
+  }
+
+  // A new connection is given the header timeout, a keep-alive connection
+  // waiting for the next request is given the idle timeout.
+  if (requests_ == 0) {
+    read_stage_ = ReadStage::kHeaders;
+    ScheduleTimeout(settings_->header_timeout);
+
+    if (settings_->pooled_read_buffers) {
+      // The reads on readable should never block, even if it's spurious.
+      boost::system::error_code ec;
+      socket_.non_blocking(true, ec);
+    }
+  } else {
+    read_stage_ = ReadStage::kIdle;
+    ScheduleTimeout(settings_->idle_timeout);
+  }
 
   boost::system::error_code ec;
   auto endpoint = socket_.remote_endpoint(ec);
@@ -27,10 +143,20 @@ void Connection::Start() {
   }
 
   request_parser_.Init(request_.get(), view_matcher_);
-  DoRead();
+
+  if (leftover_.empty()) {
+    DoRead();
+  } else {
+    // The next request has already been (partially) read.
+    std::string data;
+    data.swap(leftover_);
+    OnData(data.data(), data.size());
+  }
 }
 
 void Connection::Close() {
+  CancelTimeout();
+
   LOG_INFO("Shutdown socket...");
 
   // Initiate graceful connection closure.
@@ -54,12 +180,43 @@ void Connection::Close() {
   }
 }
 
+void Connection::Release() {
+  // The timer refers to the connection by the weak pointer of this use.
+  CancelTimeout();
+  timer_.reset();
+
+  CloseFile();
+
+  boost::system::error_code ec;
+  socket_.close(ec);
+
+  response_.reset();
+  leftover_.clear();
+  payload_.clear();
+}
+
+void Connection::Reset(tcp::socket socket) {
+  socket_ = std::move(socket);
+
+  body_ended_ = false;
+  chunked_ = false;
+  corked_ = false;
+  keep_alive_ = false;
+  file_fd_ = -1;
+  file_offset_ = 0;
+  file_remaining_ = 0;
+  requests_ = 0;
+  read_stage_ = ReadStage::kIdle;
+}
+
 void Connection::SendResponse(ResponsePtr response, bool no_keep_alive) {
   assert(response);
 
   response_ = response;
 
-  if (!no_keep_alive && request_->IsConnectionKeepAlive()) {
+  UpdateKeepAlive(no_keep_alive);
+
+  if (keep_alive_) {
     response_->SetHeader(headers::kConnection, "Keep-Alive");
   } else {
     response_->SetHeader(headers::kConnection, "Close");
@@ -71,6 +228,28 @@ void Connection::SendResponse(ResponsePtr response, bool no_keep_alive) {
 }
 
 void Connection::SendResponse(Status status, bool no_keep_alive) {
+  UpdateKeepAlive(no_keep_alive);
+
+  // The common status responses are serialized once and shared.
+  const std::string* canned =
+      Response::GetCanned(static_cast<int>(status), keep_alive_);
+  if (canned != nullptr) {
+    LOG_VERB("HTTP response:\n%s", canned->c_str());
+
+    response_.reset();
+    payload_.clear();
+    payload_.push_back(boost::asio::buffer(*canned));
+    chunked_ = false;
+    body_ended_ = true;
+
+    boost::asio::async_write(socket_, payload_,
+                             std::bind(&Connection::OnWriteBody,
+                                       shared_from_this(),
+                                       std::placeholders::_1,
+                                       std::placeholders::_2));
+    return;
+  }
+
   auto response = std::make_shared<Response>(status);
 
   // According to the testing based on HTTPie (and Chrome), the `Content-Length`
@@ -81,7 +260,41 @@ void Connection::SendResponse(Status status, bool no_keep_alive) {
   SendResponse(response, no_keep_alive);
 }
 
+void Connection::PostResponse(ResponsePtr response) {
+  auto self = shared_from_this();
+  boost::asio::post(socket_.get_executor(), [self, response]() {
+    if (!self->socket_.is_open()) {
+      LOG_WARN("The connection has been closed, drop the response.");
+      return;
+    }
+    self->SendResponse(response);
+  });
+}
+
+void Connection::PostResponse(Status status) {
+  auto self = shared_from_this();
+  boost::asio::post(socket_.get_executor(), [self, status]() {
+    if (!self->socket_.is_open()) {
+      LOG_WARN("The connection has been closed, drop the response.");
+      return;
+    }
+    self->SendResponse(status);
+  });
+}
+
+ResponderPtr Connection::MakeResponder() {
+  return std::make_shared<ConnectionResponder>(shared_from_this());
+}
+
 void Connection::DoRead() {
+  if (settings_->pooled_read_buffers) {
+    // Wait without holding any buffer, an idle connection costs no buffer.
+    socket_.async_wait(tcp::socket::wait_read,
+                       std::bind(&Connection::OnReadable, shared_from_this(),
+                                 std::placeholders::_1));
+    return;
+  }
+
   socket_.async_read_some(boost::asio::buffer(buffer_),
                           std::bind(&Connection::OnRead, shared_from_this(),
                                     std::placeholders::_1,
@@ -90,26 +303,70 @@ void Connection::DoRead() {
 
 void Connection::OnRead(boost::system::error_code ec, std::size_t length) {
   if (ec) {
-    if (ec == boost::asio::error::eof) {
-      LOG_INFO("Socket read EOF (%s).", ec.message().c_str());
-    } else if (ec == boost::asio::error::operation_aborted) {
-      // The socket of this connection has been closed.
-      // This happens, e.g., when the server was stopped by a signal (Ctrl-C).
-      LOG_WARN("Socket operation aborted (%s).", ec.message().c_str());
+    OnReadError(ec);
+    return;
+  }
+
+  OnData(buffer_.data(), length);
+}
+
+void Connection::OnReadable(boost::system::error_code ec) {
+  if (ec) {
+    OnReadError(ec);
+    return;
+  }
+
+  BufferPool* buffer_pool = pool_->buffer_pool();
+  char* buffer = buffer_pool->Acquire();
+
+  std::size_t length = socket_.read_some(
+      boost::asio::buffer(buffer, buffer_pool->buffer_size()), ec);
+
+  if (ec) {
+    buffer_pool->Release(buffer);
+
+    if (ec == boost::asio::error::would_block ||
+        ec == boost::asio::error::try_again) {
+      DoRead();
     } else {
-      LOG_ERRO("Socket read error (%s).", ec.message().c_str());
+      OnReadError(ec);
     }
+    return;
+  }
 
-    // Don't try to send any response back.
+  // The parser keeps (copies) what it needs, the buffer is free afterwards.
+  OnData(buffer, length);
 
-    if (ec != boost::asio::error::operation_aborted) {
-      pool_->Close(shared_from_this());
-    }  // else: The socket of this connection has already been closed.
+  buffer_pool->Release(buffer);
+}
 
-    return;
+void Connection::OnReadError(boost::system::error_code ec) {
+  if (ec == boost::asio::error::eof) {
+    LOG_INFO("Socket read EOF (%s).", ec.message().c_str());
+  } else if (ec == boost::asio::error::operation_aborted) {
+    // The socket of this connection has been closed.
+    // This happens, e.g., when the server was stopped by a signal (Ctrl-C)
+    // or the connection timed out.
+    LOG_INFO("Socket operation aborted (%s).", ec.message().c_str());
+  } else {
+    LOG_ERRO("Socket read error (%s).", ec.message().c_str());
+  }
+
+  // Don't try to send any response back.
+
+  if (ec != boost::asio::error::operation_aborted) {
+    pool_->Close(shared_from_this());
+  }  // else: The socket of this connection has already been closed.
+}
+
+void Connection::OnData(const char* data, std::size_t length) {
+  if (read_stage_ == ReadStage::kIdle) {
+    // The next request begins.
+    read_stage_ = ReadStage::kHeaders;
+    ScheduleTimeout(settings_->header_timeout);
   }
 
-  if (!request_parser_.Parse(buffer_.data(), length)) {
+  if (!request_parser_.Parse(data, length)) {
     LOG_ERRO("Failed to parse HTTP request.");
     // Send Bad Request (400) to the client and no Keep-Alive.
     SendResponse(Status::kBadRequest, true);
@@ -119,66 +376,380 @@ void Connection::OnRead(boost::system::error_code ec, std::size_t length) {
   }
 
   if (!request_parser_.finished()) {
+    if (request_parser_.header_ended()) {
+      // Restart the body timeout on every piece of the body.
+      read_stage_ = ReadStage::kBody;
+      ScheduleTimeout(settings_->body_timeout);
+    }
+
     // Continue to read the request.
     DoRead();
     return;
   }
 
+  // No timeout while the request is being handled.
+  CancelTimeout();
+
+  ++requests_;
+
   LOG_VERB("HTTP request:\n%s", request_->Dump().c_str());
 
-  // Enqueue this connection once the request has been read.
-  // Some worker thread will handle the request later.
-  queue_->Push(shared_from_this());
+  // Keep the data of the next pipelined request, if any.
+  leftover_ = request_parser_.TakeLeftover();
+
+  if (request_parser_.non_blocking()) {
+    // The view promises not to block, handle the request right here in the
+    // loop thread to save the hops to and from a worker thread.
+    handler_(shared_from_this());
+  } else if (!queue_->TryPush(shared_from_this())) {
+    // Enqueue this connection once the request has been read, some worker
+    // thread will handle the request later.
+    // If the workers are so far behind that the queue is full, reject the
+    // request instead of blocking the loop thread (and all the other
+    // connections of it) until there's room.
+    LOG_WARN("The connection queue is full, reject the request.");
+    SendResponse(Status::kServiceUnavailable, true);
+  }
+}
+
+void Connection::ScheduleTimeout(int timeout) {
+  if (timeout <= 0) {
+    CancelTimeout();
+    return;
+  }
+
+  if (!timer_) {
+    std::weak_ptr<Connection> weak_self = shared_from_this();
+    timer_.reset(new TimerWheel::Timer{ [weak_self](std::size_t generation) {
+      auto self = weak_self.lock();
+      if (self) {
+        // The wheel might tick in another loop thread, serialize the timeout
+        // with the read and write handlers of the connection.
+        boost::asio::post(self->socket_.get_executor(), [self, generation]() {
+          self->OnTimeout(generation);
+        });
+      }
+    } });
+  }
+
+  timer_wheel_->Schedule(timer_.get(), std::chrono::seconds(timeout));
+}
+
+void Connection::CancelTimeout() {
+  if (timer_) {
+    timer_wheel_->Cancel(timer_.get());
+  }
+}
+
+void Connection::OnTimeout(std::size_t generation) {
+  if (!timer_wheel_->Expired(timer_.get(), generation)) {
+    // Canceled or rescheduled (e.g., on new data) after it expired.
+    return;
+  }
+
+  switch (read_stage_) {
+    case ReadStage::kIdle:
+      LOG_INFO("Keep-alive connection idle timeout.");
+      break;
+    case ReadStage::kHeaders:
+      LOG_WARN("Request headers read timeout.");
+      break;
+    case ReadStage::kBody:
+      LOG_WARN("Request body read timeout.");
+      break;
+  }
+
+  pool_->Close(shared_from_this());
+}
+
+void Connection::UpdateKeepAlive(bool no_keep_alive) {
+  keep_alive_ = !no_keep_alive && request_->IsConnectionKeepAlive();
+
+  if (keep_alive_ && settings_->max_requests > 0 &&
+      requests_ >= settings_->max_requests) {
+    LOG_INFO("Max requests (%zu) reached, close the connection.",
+             settings_->max_requests);
+    keep_alive_ = false;
+  }
 }
 
 void Connection::DoWrite() {
   LOG_VERB("HTTP response:\n%s", response_->Dump().c_str());
 
-  // Firstly, write the headers.
-  boost::asio::async_write(socket_, response_->GetPayload(),
-                           std::bind(&Connection::OnWriteHeaders,
-                                     shared_from_this(), std::placeholders::_1,
-                                     std::placeholders::_2));
+  // The headers are serialized into a single buffer and written together with
+  // the first payloads of the body with a single (gathered) write.
+  headers_data_.clear();
+  response_->SerializeHeaders(&headers_data_);
+
+  payload_.clear();
+  payload_.push_back(boost::asio::buffer(headers_data_));
+
+  // The framing follows the headers, see Response::Prepare().
+  chunked_ = response_->IsChunked();
+
+  if (settings_->sendfile && !chunked_ && StartSendFile()) {
+    // The headers and the beginning of the file share the packets.
+    SetCork(true);
+
+    boost::asio::async_write(socket_, payload_,
+                             std::bind(&Connection::OnWriteHeaders,
+                                       shared_from_this(),
+                                       std::placeholders::_1,
+                                       std::placeholders::_2));
+    return;
+  }
+
+  try {
+    // NOTE: The body might throw Error (e.g., FileBody, GzipBody).
+    response_->body()->InitPayload();
+  } catch (const Error& error) {
+    LOG_ERRO("Body error: %s.", error.message().c_str());
+    // Nothing has been written yet.
+    SendResponse(Status::kInternalServerError, true);
+    return;
+  }
+
+  DoWriteBody();
 }
 
 void Connection::OnWriteHeaders(boost::system::error_code ec,
-                                std::size_t length) {
+                                std::size_t /*length*/) {
   if (ec) {
+    CloseFile();
     OnWriteError(ec);
   } else {
-    // Write the body payload by payload.
-    response_->body()->InitPayload();
-    DoWriteBody();
+    DoSendFile();
   }
 }
 
 void Connection::DoWriteBody() {
-  auto payload = response_->body()->NextPayload();
+  using boost::asio::buffer;
 
-  if (!payload.empty()) {
-    boost::asio::async_write(socket_, payload,
-                             std::bind(&Connection::OnWriteBody,
-                                       shared_from_this(),
-                                       std::placeholders::_1,
-                                       std::placeholders::_2));
-  } else {
+  auto body = response_->body();
+  bool stable = body->IsPayloadStable();
+
+  std::size_t bytes = boost::asio::buffer_size(payload_);
+
+  // With the chunked transfer coding, the payloads gathered are sent as a
+  // single chunk. Reserve the buffers for the chunk size line, the CRLF after
+  // the chunk data and the last chunk.
+  std::size_t max_buffers = kMaxWriteBuffers;
+  std::size_t chunk_index = payload_.size();
+  if (chunked_) {
+    max_buffers -= 3;
+    payload_.push_back(buffer(chunk_size_line_));
+  }
+
+  std::size_t chunk_size = 0;
+
+  while (true) {
+    Payload payload;
+    try {
+      payload = body->NextPayload();
+    } catch (const Error& error) {
+      LOG_ERRO("Body error: %s.", error.message().c_str());
+      // Close the connection without the last chunk (or the rest of the
+      // content) so that the client knows the response is incomplete.
+      pool_->Close(shared_from_this());
+      return;
+    }
+
+    if (payload.empty()) {
+      body_ended_ = true;
+      break;
+    }
+
+    body_ended_ = false;
+    std::size_t size = boost::asio::buffer_size(payload);
+    bytes += size;
+    chunk_size += size;
+    payload_.insert(payload_.end(), payload.begin(), payload.end());
+
+    if (!stable || payload_.size() >= max_buffers || bytes >= kMaxWriteBytes) {
+      break;
+    }
+  }
+
+  if (chunked_) {
+    if (chunk_size > 0) {
+      char size_line[32];
+      int n = std::snprintf(size_line, sizeof(size_line), "%zx\r\n",
+                            chunk_size);
+      chunk_size_line_.assign(size_line, n);
+      payload_[chunk_index] = buffer(chunk_size_line_);
+      payload_.push_back(buffer(literal_buffers::CRLF));
+    } else {
+      payload_.erase(payload_.begin() + chunk_index);
+    }
+
+    if (body_ended_) {
+      payload_.push_back(buffer(kLastChunk, sizeof(kLastChunk) - 1));
+    }
+  }
+
+  if (payload_.empty()) {
     // No more body payload left, we're done.
     OnWriteOK();
+    return;
+  }
+
+  if (!body_ended_) {
+    // More writes will follow, e.g., the chunks of a file.
+    SetCork(true);
   }
+
+  boost::asio::async_write(socket_, payload_,
+                           std::bind(&Connection::OnWriteBody,
+                                     shared_from_this(), std::placeholders::_1,
+                                     std::placeholders::_2));
 }
 
-void Connection::OnWriteBody(boost::system::error_code ec, std::size_t length) {
+void Connection::OnWriteBody(boost::system::error_code ec,
+                             std::size_t /*length*/) {
   if (ec) {
     OnWriteError(ec);
+  } else if (body_ended_) {
+    OnWriteOK();
   } else {
+    payload_.clear();
     DoWriteBody();
   }
 }
 
+#if defined(__linux__)
+
+bool Connection::StartSendFile() {
+  auto file_body = dynamic_cast<FileBody*>(response_->body().get());
+  if (file_body == nullptr || file_body->IsEmpty()) {
+    return false;
+  }
+
+  file_fd_ = ::open(file_body->path().c_str(), O_RDONLY | O_CLOEXEC);
+  if (file_fd_ == -1) {
+    LOG_WARN("Failed to open the file for sendfile.");
+    return false;
+  }
+
+  // The body might be a range of the file.
+  file_offset_ = file_body->offset();
+  file_remaining_ = file_body->GetSize();
+
+  // sendfile() must not block the loop when the socket buffer is full.
+  boost::system::error_code ec;
+  socket_.native_non_blocking(true, ec);
+  if (ec) {
+    CloseFile();
+    return false;
+  }
+
+  return true;
+}
+
+void Connection::DoSendFile() {
+  // Send as much as the socket buffer takes, then wait for it to be writable
+  // again. Every round goes back to the loop so that a large file doesn't
+  // starve the other connections.
+  off_t offset = static_cast<off_t>(file_offset_);
+  ssize_t sent = ::sendfile(socket_.native_handle(), file_fd_, &offset,
+                            file_remaining_);
+
+  if (sent < 0) {
+    if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+      sent = 0;
+    } else if ((errno == EINVAL || errno == ENOSYS) &&
+               file_remaining_ == response_->body()->GetSize()) {
+      // The file (system) doesn't support sendfile(), fall back to the
+      // payload path.
+      LOG_WARN("sendfile() is not supported, fall back.");
+      CloseFile();
+      payload_.clear();
+      try {
+        response_->body()->InitPayload();
+      } catch (const Error& error) {
+        LOG_ERRO("Body error: %s.", error.message().c_str());
+        // The headers have been sent.
+        pool_->Close(shared_from_this());
+        return;
+      }
+      DoWriteBody();
+      return;
+    } else {
+      boost::system::error_code ec(errno, boost::system::system_category());
+      CloseFile();
+      OnWriteError(ec);
+      return;
+    }
+  } else if (sent == 0) {
+    // The file has been truncated meanwhile.
+    CloseFile();
+    OnWriteError(boost::asio::error::eof);
+    return;
+  }
+
+  file_offset_ += sent;
+  file_remaining_ -= static_cast<std::size_t>(sent);
+
+  if (file_remaining_ == 0) {
+    CloseFile();
+    OnWriteOK();
+    return;
+  }
+
+  socket_.async_wait(tcp::socket::wait_write,
+                     std::bind(&Connection::OnSendFileWait, shared_from_this(),
+                               std::placeholders::_1));
+}
+
+void Connection::OnSendFileWait(boost::system::error_code ec) {
+  if (ec) {
+    CloseFile();
+    OnWriteError(ec);
+  } else {
+    DoSendFile();
+  }
+}
+
+void Connection::CloseFile() {
+  if (file_fd_ != -1) {
+    ::close(file_fd_);
+    file_fd_ = -1;
+  }
+}
+
+#else
+
+bool Connection::StartSendFile() {
+  return false;
+}
+
+void Connection::DoSendFile() {
+}
+
+void Connection::OnSendFileWait(boost::system::error_code ec) {
+}
+
+void Connection::CloseFile() {
+}
+
+#endif  // defined(__linux__)
+
+void Connection::SetCork(bool cork) {
+#if defined(TCP_CORK)
+  if (corked_ != cork) {
+    corked_ = cork;
+    boost::system::error_code ec;
+    socket_.set_option(tcp_cork(cork), ec);
+  }
+#endif  // defined(TCP_CORK)
+}
+
 void Connection::OnWriteOK() {
   LOG_INFO("Response has been sent back.");
 
-  if (request_->IsConnectionKeepAlive()) {
+  // Flush the partial frame, if any.
+  SetCork(false);
+
+  if (keep_alive_) {
     LOG_INFO("The client asked for a keep-alive connection.");
     LOG_INFO("Continue to read the next request...");
     Start();
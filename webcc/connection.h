@@ -1,6 +1,7 @@
 #ifndef WEBCC_CONNECTION_H_
 #define WEBCC_CONNECTION_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -8,10 +9,12 @@
 #include "boost/asio/ip/tcp.hpp"
 
 #include "webcc/globals.h"
-#include "webcc/queue.h"
+#include "webcc/mpmc_queue.h"
 #include "webcc/request.h"
 #include "webcc/request_parser.h"
+#include "webcc/responder.h"
 #include "webcc/response.h"
+#include "webcc/timer_wheel.h"
 
 namespace webcc {
 
@@ -21,12 +24,49 @@ class Server;
 
 using ConnectionPtr = std::shared_ptr<Connection>;
 
+// The queue dispatching the connections to the worker threads.
+using ConnectionQueue = MpmcQueue<ConnectionPtr>;
+
+// A function handling the request of a connection.
+using ConnectionHandler = std::function<void(ConnectionPtr)>;
+
+// The settings of the connections.
+// The timeouts are in seconds, 0 means no timeout.
+struct ConnectionSettings {
+  // The timeout of waiting for the next request on a keep-alive connection.
+  int idle_timeout = 60;
+
+  // The timeout of reading the headers of a request, counted from the first
+  // byte of the request (or from the connection being accepted).
+  int header_timeout = 30;
+
+  // The timeout of waiting for the next piece of the body of a request.
+  int body_timeout = 60;
+
+  // The max number of requests served on a connection, 0 means no limit.
+  std::size_t max_requests = 0;
+
+  // Send the file bodies with sendfile() or not.
+  // Only supported on Linux, ignored on the other platforms.
+  bool sendfile = true;
+
+  // Wait for the data without a read buffer, and take a buffer from the pool
+  // (see BufferPool) only to read the data which has arrived, or not.
+  bool pooled_read_buffers = false;
+
+  // The max ratio of the decompressed size to the compressed size of the
+  // content of a request, 0 means no limit.
+  std::size_t max_decompression_ratio = kMaxDecompressionRatio;
+};
+
 class Connection : public std::enable_shared_from_this<Connection> {
 public:
   Connection(boost::asio::ip::tcp::socket socket, ConnectionPool* pool,
-             Queue<ConnectionPtr>* queue, ViewMatcher&& view_matcher);
+             ConnectionQueue* queue, ViewMatcher&& view_matcher,
+             ConnectionHandler&& handler, TimerWheelPtr timer_wheel,
+             const ConnectionSettings* settings);
 
-  ~Connection() = default;
+  ~Connection();
 
   Connection(const Connection&) = delete;
   Connection& operator=(const Connection&) = delete;
@@ -41,6 +81,14 @@ public:
   // Close the socket.
   void Close();
 
+  // Release the resources of the last use (e.g., the socket, the response)
+  // but keep the buffers, so that the connection could be reused for another
+  // socket. See ConnectionPool.
+  void Release();
+
+  // Reset the states for reusing the released connection for a new socket.
+  void Reset(boost::asio::ip::tcp::socket socket);
+
   // Send a response to the client.
   // `Connection` header will be set to "Close" if |no_keep_alive| is true no
   // matter whether the client asked for Keep-Alive or not.
@@ -51,14 +99,67 @@ public:
   // matter whether the client asked for Keep-Alive or not.
   void SendResponse(Status status, bool no_keep_alive = false);
 
+  // Post the sending of a response to the executor of the socket.
+  // Unlike SendResponse(), it's safe to call from any thread at any time.
+  // The response will be dropped if the connection has been closed.
+  void PostResponse(ResponsePtr response);
+
+  // Post the sending of a response with the given status and an empty body.
+  void PostResponse(Status status);
+
+  // Create a responder for sending the response later (see AsyncView).
+  ResponderPtr MakeResponder();
+
+  Responder::executor_type get_executor() {
+    return socket_.get_executor();
+  }
+
 private:
   void DoRead();
   void OnRead(boost::system::error_code ec, std::size_t length);
 
+  // The socket is readable, read the data into a buffer of the pool.
+  // See ConnectionSettings::pooled_read_buffers.
+  void OnReadable(boost::system::error_code ec);
+
+  void OnReadError(boost::system::error_code ec);
+
+  // Parse the data of the request, dispatch the request once it's finished.
+  void OnData(const char* data, std::size_t length);
+
+  // Schedule the timer to close the connection after the |timeout| (seconds).
+  // The timer will be canceled if |timeout| is 0.
+  void ScheduleTimeout(int timeout);
+  void CancelTimeout();
+
+  // Called in the executor of the socket when the timer expired with the
+  // |generation|. See TimerWheel::Expired().
+  void OnTimeout(std::size_t generation);
+
+  // Decide whether to keep the connection alive after the response is sent.
+  void UpdateKeepAlive(bool no_keep_alive);
+
   void DoWrite();
   void OnWriteHeaders(boost::system::error_code ec, std::size_t length);
+
+  // Gather the next payloads of the body into |payload_| and write them.
   void DoWriteBody();
   void OnWriteBody(boost::system::error_code ec, std::size_t length);
+
+  // Send the file body with sendfile(), i.e., from the page cache straight to
+  // the socket without copying through the user space.
+  // Return false if the file body can't be sent this way.
+  bool StartSendFile();
+  void DoSendFile();
+  void OnSendFileWait(boost::system::error_code ec);
+  void CloseFile();
+
+  // Cork the socket (TCP_CORK) or not.
+  // While corked, the kernel doesn't send out partial frames, so the separate
+  // writes of a response (e.g., the headers and the file) share the packets.
+  // Linux only.
+  void SetCork(bool cork);
+
   void OnWriteOK();
   void OnWriteError(boost::system::error_code ec);
 
@@ -69,13 +170,18 @@ private:
   ConnectionPool* pool_;
 
   // The connection queue.
-  Queue<ConnectionPtr>* queue_;
+  ConnectionQueue* queue_;
 
   // A function for matching view once the headers of a request has been
   // received.
   ViewMatcher view_matcher_;
 
+  // A function for handling the request of a non-blocking view directly in
+  // the loop thread, bypassing the queue.
+  ConnectionHandler handler_;
+
   // The buffer for incoming data.
+  // Empty if the buffers are taken from the pool on demand.
   std::vector<char> buffer_;
 
   // The incoming request.
@@ -84,8 +190,57 @@ private:
   // The parser for the incoming request.
   RequestParser request_parser_;
 
+  // The data read beyond the current request, i.e., the beginning of the next
+  // pipelined request(s).
+  // The requests are processed one by one, so the responses are always sent in
+  // the order of the requests.
+  std::string leftover_;
+
   // The response to be sent back to the client.
   ResponsePtr response_;
+
+  // The serialized headers of the response.
+  std::string headers_data_;
+
+  // The payload being written, gathered from the headers and the body.
+  Payload payload_;
+
+  // All the body payloads have been gathered or not.
+  bool body_ended_;
+
+  // The body is sent with the chunked transfer coding or not.
+  bool chunked_;
+
+  // The size line of the current chunk, e.g., "1f4\r\n".
+  std::string chunk_size_line_;
+
+  // The socket is corked or not.
+  bool corked_;
+
+  // Keep the connection alive after the response is sent or not.
+  bool keep_alive_;
+
+  // The file being sent with sendfile().
+  int file_fd_;
+  std::uint64_t file_offset_;
+  std::size_t file_remaining_;
+
+  // The number of requests read from this connection.
+  std::size_t requests_;
+
+  // The timer wheel of the loop and the timer on it for the timeouts.
+  TimerWheelPtr timer_wheel_;
+  std::unique_ptr<TimerWheel::Timer> timer_;
+
+  const ConnectionSettings* settings_;
+
+  // The stage of reading the request, which decides the timeout.
+  enum class ReadStage {
+    kIdle,
+    kHeaders,
+    kBody,
+  };
+  ReadStage read_stage_;
 };
 
 }  // namespace webcc
@@ -4,6 +4,50 @@
 
 namespace webcc {
 
+namespace {
+
+// The max number of the released connections kept for reuse.
+// More are deleted, e.g., after a burst of connections is gone.
+const std::size_t kMaxFreeConnections = 256;
+
+}  // namespace
+
+ConnectionPool::ConnectionPool()
+    : free_list_(std::make_shared<FreeList>()), buffer_pool_(kBufferSize) {
+}
+
+ConnectionPool::~ConnectionPool() {
+  std::vector<std::unique_ptr<Connection>> connections;
+  {
+    std::lock_guard<std::mutex> lock(free_list_->mutex);
+    free_list_->recycling = false;
+    connections.swap(free_list_->connections);
+  }
+}
+
+ConnectionPtr ConnectionPool::Reuse(boost::asio::ip::tcp::socket& socket) {
+  std::unique_ptr<Connection> c;
+  {
+    std::lock_guard<std::mutex> lock(free_list_->mutex);
+    if (free_list_->connections.empty()) {
+      return ConnectionPtr();
+    }
+    c = std::move(free_list_->connections.back());
+    free_list_->connections.pop_back();
+  }
+
+  c->Reset(std::move(socket));
+
+  return Adopt(c.release());
+}
+
+ConnectionPtr ConnectionPool::Adopt(Connection* c) {
+  std::shared_ptr<FreeList> free_list = free_list_;
+  return ConnectionPtr(c, [free_list](Connection* c) {
+    Recycle(free_list, c);
+  });
+}
+
 void ConnectionPool::Start(ConnectionPtr c) {
   LOG_VERB("Starting connection...");
 
@@ -41,4 +85,27 @@ void ConnectionPool::Clear() {
   }
 }
 
+std::size_t ConnectionPool::free_size() const {
+  std::lock_guard<std::mutex> lock(free_list_->mutex);
+  return free_list_->connections.size();
+}
+
+void ConnectionPool::Recycle(const std::shared_ptr<FreeList>& free_list,
+                             Connection* c) {
+  // No more operations are pending on the connection, release it outside the
+  // lock.
+  c->Release();
+
+  {
+    std::lock_guard<std::mutex> lock(free_list->mutex);
+    if (free_list->recycling &&
+        free_list->connections.size() < kMaxFreeConnections) {
+      free_list->connections.emplace_back(c);
+      return;
+    }
+  }
+
+  delete c;
+}
+
 }  // namespace webcc
@@ -1,20 +1,34 @@
 #ifndef WEBCC_CONNECTION_POOL_H_
 #define WEBCC_CONNECTION_POOL_H_
 
+#include <memory>
 #include <mutex>
 #include <set>
+#include <vector>
 
+#include "webcc/buffer_pool.h"
 #include "webcc/connection.h"
 
 namespace webcc {
 
 class ConnectionPool {
 public:
-  ConnectionPool() = default;
+  ConnectionPool();
+
+  ~ConnectionPool();
 
   ConnectionPool(const ConnectionPool&) = delete;
   ConnectionPool& operator=(const ConnectionPool&) = delete;
 
+  // Get a released connection for the newly accepted socket, with the buffers
+  // of its last use retained.
+  // Return null (and leave the socket alone) if there's no connection to reuse.
+  ConnectionPtr Reuse(boost::asio::ip::tcp::socket& socket);
+
+  // Share a new connection. It will be released to this pool for reuse instead
+  // of being deleted once it's no longer referenced.
+  ConnectionPtr Adopt(Connection* c);
+
   // Add the connection and start to read the request from it.
   // Called when a new connection has just been accepted.
   void Start(ConnectionPtr c);
@@ -27,12 +41,40 @@ public:
   // Called when the server is about to stop.
   void Clear();
 
+  // The number of the released connections waiting for reuse.
+  std::size_t free_size() const;
+
+  // The read buffers shared by the connections.
+  // See ConnectionSettings::pooled_read_buffers.
+  BufferPool* buffer_pool() {
+    return &buffer_pool_;
+  }
+
 private:
+  // The released connections.
+  // It's shared with the deleters of the connections, which might outlive the
+  // pool (e.g., in the handlers being destroyed with the io_context).
+  struct FreeList {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Connection>> connections;
+
+    // Keep the released connections or delete them.
+    bool recycling = true;
+  };
+
+  // Release the connection to the free list or delete it.
+  static void Recycle(const std::shared_ptr<FreeList>& free_list,
+                      Connection* c);
+
   std::set<ConnectionPtr> connections_;
 
   // Mutex is necessary if the loop is running in multiple threads.
   // See Server::Run().
   std::mutex mutex_;
+
+  std::shared_ptr<FreeList> free_list_;
+
+  BufferPool buffer_pool_;
 };
 
 }  // namespace webcc
@@ -0,0 +1,32 @@
+#include "webcc/coroutine_view.h"
+
+#include <exception>
+
+#include "boost/asio/co_spawn.hpp"
+
+#include "webcc/logger.h"
+
+namespace webcc {
+
+void CoroutineView::AsyncHandle(RequestPtr request, ResponderPtr responder) {
+  boost::asio::co_spawn(
+      responder->get_executor(), CoHandle(request),
+      [responder](std::exception_ptr e, ResponsePtr response) {
+        if (e) {
+          try {
+            std::rethrow_exception(e);
+          } catch (const std::exception& error) {
+            LOG_ERRO("Coroutine view error: %s.", error.what());
+          } catch (...) {
+            LOG_ERRO("Coroutine view error.");
+          }
+          responder->Send(Status::kInternalServerError);
+        } else if (response) {
+          responder->Send(response);
+        } else {
+          responder->Send(Status::kBadRequest);
+        }
+      });
+}
+
+}  // namespace webcc
@@ -0,0 +1,48 @@
+#ifndef WEBCC_COROUTINE_VIEW_H_
+#define WEBCC_COROUTINE_VIEW_H_
+
+// C++20 coroutine support (WEBCC_ENABLE_COROUTINE).
+
+#include "webcc/config.h"
+
+#if !WEBCC_ENABLE_COROUTINE
+#error "Coroutine support is not enabled (WEBCC_ENABLE_COROUTINE)."
+#endif
+
+// NOTE: Asio 1.74's awaitable.hpp uses std::exchange without including it.
+#include <utility>
+
+#include "boost/asio/awaitable.hpp"
+
+#include "webcc/view.h"
+
+namespace webcc {
+
+// A view written as a coroutine.
+// The coroutine runs in the loop of the connection, it could co_await socket
+// I/O, timers or AsyncRequest() (see async_client.h) without blocking any
+// thread, so a single loop thread can serve thousands of in-flight requests.
+// E.g.,
+//   class ProxyView : public webcc::CoroutineView {
+//   public:
+//     boost::asio::awaitable<webcc::ResponsePtr> CoHandle(
+//         webcc::RequestPtr request) override {
+//       auto r = co_await webcc::AsyncRequest(...);
+//       co_return webcc::ResponseBuilder{}.OK().Body(r->data())();
+//     }
+//   };
+// Route it as non-blocking so that the requests are dispatched to the
+// coroutines right in the loop thread:
+//   server.Route("/proxy", std::make_shared<ProxyView>(), { "GET" }, true);
+// A null response results in a 400 (Bad Request) and an exception escaping the
+// coroutine results in a 500 (Internal Server Error).
+class CoroutineView : public AsyncView {
+public:
+  void AsyncHandle(RequestPtr request, ResponderPtr responder) final;
+
+  virtual boost::asio::awaitable<ResponsePtr> CoHandle(RequestPtr request) = 0;
+};
+
+}  // namespace webcc
+
+#endif  // WEBCC_COROUTINE_VIEW_H_
@@ -0,0 +1,196 @@
+#include "webcc/file_cache.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "webcc/logger.h"
+#include "webcc/utility.h"
+
+namespace webcc {
+
+const std::size_t FileCache::kEntryOverhead;
+
+FileCache::FileCache(std::size_t capacity, std::size_t max_file_size,
+                     std::chrono::milliseconds valid_time)
+    : capacity_(capacity), max_file_size_(max_file_size),
+      valid_time_(valid_time) {
+}
+
+StaticFilePtr FileCache::Get(const Path& path) {
+  return Lookup(path, true, true);
+}
+
+StaticFilePtr FileCache::Find(const Path& path) {
+  return Lookup(path, false, false);
+}
+
+StaticFilePtr FileCache::Match(const Path& path) {
+  return Lookup(path, true, false);
+}
+
+StaticFilePtr FileCache::Load(const Path& path, StaticFilePtr file) {
+  assert(file);
+
+  if (capacity_ == 0 || file->data || file->size > max_file_size_ ||
+      file->size + kEntryOverhead > capacity_) {
+    return file;
+  }
+
+  auto data = std::make_shared<std::string>();
+  if (!utility::ReadFile(path, data.get()) || data->size() != file->size) {
+    LOG_WARN("Failed to read the file to cache: %s", path.string().c_str());
+    return file;
+  }
+
+  auto loaded = std::make_shared<StaticFile>(*file);
+  loaded->data = data;
+  Insert(MakeKey(path), loaded);
+  return loaded;
+}
+
+void FileCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  lru_.clear();
+  bytes_ = 0;
+}
+
+std::size_t FileCache::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+std::size_t FileCache::Bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+std::string FileCache::MakeKey(const Path& path) {
+  return path.lexically_normal().string();
+}
+
+std::size_t FileCache::Cost(const StaticFile& file) {
+  return (file.data ? file.data->size() : 0) + kEntryOverhead;
+}
+
+std::shared_ptr<StaticFile> FileCache::Stat(const Path& path) {
+  // A single stat() for the type, size and mtime. Each of bfs::status(),
+  // bfs::file_size() and bfs::last_write_time() is a stat() of its own.
+#if defined(_WIN32)
+  struct _stat64 st;
+  if (::_wstat64(path.c_str(), &st) != 0) {
+    return {};
+  }
+#else
+  struct stat st;
+  if (::stat(path.c_str(), &st) != 0) {
+    return {};
+  }
+#endif
+
+  if ((st.st_mode & S_IFMT) != S_IFREG) {
+    return {};
+  }
+
+  auto size = static_cast<std::uint64_t>(st.st_size);
+  auto mtime = static_cast<std::time_t>(st.st_mtime);
+
+  auto file = std::make_shared<StaticFile>();
+  file->size = static_cast<std::size_t>(size);
+  file->mtime = mtime;
+  file->media_type = media_types::FromExtension(path.extension().string());
+
+  char etag[64];
+  std::snprintf(etag, sizeof(etag), "\"%llx-%llx\"",
+                static_cast<unsigned long long>(mtime),
+                static_cast<unsigned long long>(size));
+  file->etag = etag;
+
+  file->last_modified = utility::FormatHttpDate(mtime);
+  file->checked = std::chrono::steady_clock::now();
+  return file;
+}
+
+StaticFilePtr FileCache::Lookup(const Path& path, bool stat, bool load) {
+  const std::string key = MakeKey(path);
+
+  StaticFilePtr cached;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      // Move to the front of the LRU list.
+      lru_.splice(lru_.begin(), lru_, it->second.lru_it);
+
+      cached = it->second.file;
+      if (std::chrono::steady_clock::now() - cached->checked < valid_time_) {
+        return cached;
+      }
+    }
+  }
+
+  if (!cached && !stat) {
+    return {};
+  }
+
+  // Not cached or to be revalidated.
+  // Touch the file system without the lock.
+  auto file = Stat(path);
+
+  if (!file) {
+    if (cached) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = entries_.find(key);
+      if (it != entries_.end()) {
+        Erase(it);
+      }
+    }
+    return {};
+  }
+
+  if (cached && cached->mtime == file->mtime && cached->size == file->size) {
+    // Not changed, keep the data.
+    file->data = cached->data;
+    Insert(key, file);
+    return file;
+  }
+
+  if (!load) {
+    return stat ? file : StaticFilePtr{};
+  }
+
+  return Load(path, file);
+}
+
+void FileCache::Insert(const std::string& key, StaticFilePtr file) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    Erase(it);
+  }
+
+  std::size_t size = Cost(*file);
+
+  // Evict the least recently used files.
+  while (!lru_.empty() && bytes_ + size > capacity_) {
+    Erase(entries_.find(lru_.back()));
+  }
+
+  lru_.push_front(key);
+  entries_[key] = Entry{ file, lru_.begin() };
+  bytes_ += size;
+}
+
+void FileCache::Erase(std::unordered_map<std::string, Entry>::iterator it) {
+  bytes_ -= Cost(*it->second.file);
+  lru_.erase(it->second.lru_it);
+  entries_.erase(it);
+}
+
+}  // namespace webcc
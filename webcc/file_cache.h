@@ -0,0 +1,149 @@
+#ifndef WEBCC_FILE_CACHE_H_
+#define WEBCC_FILE_CACHE_H_
+
+#include <chrono>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "webcc/globals.h"
+
+namespace webcc {
+
+// A static file with the information for the conditional requests.
+struct StaticFile {
+  // The data of the file, null if the file is not cached (e.g., too large).
+  std::shared_ptr<const std::string> data;
+
+  // The size in bytes of the file.
+  std::size_t size = 0;
+
+  // The last modification time of the file.
+  std::time_t mtime = 0;
+
+  // The media type from the file extension.
+  std::string media_type;
+
+  // A strong entity tag made of the mtime and size, e.g., "5e8c1b2a-1f4".
+  std::string etag;
+
+  // The mtime as an HTTP date.
+  std::string last_modified;
+
+  // When the file was checked (stat) for the last time.
+  std::chrono::steady_clock::time_point checked;
+};
+
+using StaticFilePtr = std::shared_ptr<const StaticFile>;
+
+// A memory-budgeted LRU cache of the static files.
+// The files are keyed by their normalized paths, so the aliases of a path
+// (e.g., "a//b", "a/./b") share the same entry.
+// A cached file is revalidated (by its mtime and size) at most once per
+// |valid_time| instead of on every hit, so a hit usually touches neither the
+// disk nor the file system. A changed file is reloaded on the next hit after
+// the revalidation.
+// Thread safe.
+class FileCache {
+public:
+  // The bytes charged for each cached file in addition to its data, so that
+  // even the empty files take up the capacity.
+  static const std::size_t kEntryOverhead = 256;
+
+  // |capacity|: the max bytes of the cached files (see Bytes()), 0 disables
+  // the caching (but Get() still works).
+  // |max_file_size|: files larger than this are not cached.
+  explicit FileCache(std::size_t capacity = 0,
+                     std::size_t max_file_size = 1024 * 1024,
+                     std::chrono::milliseconds valid_time =
+                         std::chrono::seconds(1));
+
+  FileCache(const FileCache&) = delete;
+  FileCache& operator=(const FileCache&) = delete;
+
+  // Must be called before the cache is used.
+  void set_capacity(std::size_t capacity) {
+    capacity_ = capacity;
+  }
+
+  void set_max_file_size(std::size_t max_file_size) {
+    max_file_size_ = max_file_size;
+  }
+
+  // Get the file, load (and cache) it if it's not cached or it's changed.
+  // The data of a file not fitting into the cache is not loaded.
+  // Return null if the file doesn't exist or it's a directory.
+  StaticFilePtr Get(const Path& path);
+
+  // Get the file only if it's cached and still valid, never load it.
+  StaticFilePtr Find(const Path& path);
+
+  // Get the file if it's cached and still valid, otherwise stat it without
+  // loading the data (i.e., the data is null). See Load().
+  // Return null if the file doesn't exist or it's a directory.
+  StaticFilePtr Match(const Path& path);
+
+  // Load (and cache) the data of the file got by Match(), without the stats
+  // again. The file is returned as it is if it has the data already or the
+  // data doesn't fit into the cache.
+  StaticFilePtr Load(const Path& path, StaticFilePtr file);
+
+  // Remove all the files.
+  void Clear();
+
+  // The number of the cached files.
+  std::size_t Size() const;
+
+  // The bytes charged for the cached files, i.e., the data plus
+  // kEntryOverhead per file.
+  std::size_t Bytes() const;
+
+private:
+  using Lru = std::list<std::string>;
+
+  struct Entry {
+    StaticFilePtr file;
+    Lru::iterator lru_it;
+  };
+
+  static std::string MakeKey(const Path& path);
+
+  // The bytes charged for a cached file.
+  static std::size_t Cost(const StaticFile& file);
+
+  // Stat the file with a single stat() call, the size, mtime and ETag are all
+  // made of its result.
+  // Return null if the file doesn't exist or it's not a regular file.
+  static std::shared_ptr<StaticFile> Stat(const Path& path);
+
+  // Find the file, revalidate it if necessary.
+  // If it's not cached or it's changed, load it if |load| is true, otherwise
+  // return the stats of it if |stat| is true, or null.
+  StaticFilePtr Lookup(const Path& path, bool stat, bool load);
+
+  // Insert (or replace) a file, evict the least recently used files to make
+  // room for it.
+  void Insert(const std::string& key, StaticFilePtr file);
+
+  void Erase(std::unordered_map<std::string, Entry>::iterator it);
+
+  std::size_t capacity_;
+  std::size_t max_file_size_;
+  std::chrono::milliseconds valid_time_;
+
+  mutable std::mutex mutex_;
+
+  std::unordered_map<std::string, Entry> entries_;
+
+  // The keys of the entries, the most recently used first.
+  Lru lru_;
+
+  std::size_t bytes_ = 0;
+};
+
+}  // namespace webcc
+
+#endif  // WEBCC_FILE_CACHE_H_
@@ -79,6 +79,21 @@ const std::size_t kBufferSize = 1024;
 // gzip-all-content-from-your-web-server.html
 const std::size_t kGzipThreshold = 1400;
 
+// The default max ratio of the decompressed size to the compressed size of the
+// content of a request received by the server. The content expanding further
+// (e.g., a "zip bomb") is rejected as soon as it's detected, instead of after
+// it has filled up the memory or the disk. Legitimate request data rarely
+// exceeds 100:1 (deflate itself tops out at about 1000:1).
+// The client doesn't limit the ratio by default, since large and highly
+// compressible responses (e.g., JSON, logs) could exceed it.
+// See Server::set_max_decompression_ratio() and
+// ClientSession::set_max_decompression_ratio().
+const std::size_t kMaxDecompressionRatio = 100;
+
+// The ratio above is only checked once the decompressed size exceeds this, so
+// small contents are never rejected.
+const std::size_t kDecompressionRatioMinSize = 1024 * 1024;
+
 // -----------------------------------------------------------------------------
 
 namespace literal_buffers {
@@ -120,9 +135,11 @@ enum Status {
   kCreated = 201,
   kAccepted = 202,
   kNoContent = 204,
+  kPartialContent = 206,
   kNotModified = 304,
   kBadRequest = 400,
   kNotFound = 404,
+  kRangeNotSatisfiable = 416,
   kInternalServerError = 500,
   kNotImplemented = 501,
   kServiceUnavailable = 503,
@@ -132,20 +149,31 @@ namespace headers {
 
 // NOTE: Field names are case-insensitive.
 //   See https://stackoverflow.com/a/5259004 for more details.
-
-const char* const kHost = "Host";
-const char* const kDate = "Date";
-const char* const kAuthorization = "Authorization";
-const char* const kContentType = "Content-Type";
-const char* const kContentLength = "Content-Length";
-const char* const kContentEncoding = "Content-Encoding";
-const char* const kContentDisposition = "Content-Disposition";
-const char* const kConnection = "Connection";
-const char* const kTransferEncoding = "Transfer-Encoding";
-const char* const kAccept = "Accept";
-const char* const kAcceptEncoding = "Accept-Encoding";
-const char* const kUserAgent = "User-Agent";
-const char* const kServer = "Server";
+// The names are constexpr so that their hashes can be computed at compile time
+// (see HeaderId in common.h).
+
+constexpr const char* kHost = "Host";
+constexpr const char* kDate = "Date";
+constexpr const char* kAuthorization = "Authorization";
+constexpr const char* kContentType = "Content-Type";
+constexpr const char* kContentLength = "Content-Length";
+constexpr const char* kContentEncoding = "Content-Encoding";
+constexpr const char* kContentDisposition = "Content-Disposition";
+constexpr const char* kConnection = "Connection";
+constexpr const char* kTransferEncoding = "Transfer-Encoding";
+constexpr const char* kAccept = "Accept";
+constexpr const char* kAcceptEncoding = "Accept-Encoding";
+constexpr const char* kUserAgent = "User-Agent";
+constexpr const char* kServer = "Server";
+constexpr const char* kETag = "ETag";
+constexpr const char* kLastModified = "Last-Modified";
+constexpr const char* kIfNoneMatch = "If-None-Match";
+constexpr const char* kIfModifiedSince = "If-Modified-Since";
+constexpr const char* kRange = "Range";
+constexpr const char* kIfRange = "If-Range";
+constexpr const char* kAcceptRanges = "Accept-Ranges";
+constexpr const char* kContentRange = "Content-Range";
+constexpr const char* kVary = "Vary";
 
 }  // namespace headers
 
@@ -1,5 +1,6 @@
 #include "webcc/gzip.h"
 
+#include <algorithm>
 #include <cassert>
 #include <utility>  // std::move
 
@@ -10,122 +11,247 @@
 namespace webcc {
 namespace gzip {
 
-bool Compress(const std::string& input, std::string* output) {
+// -----------------------------------------------------------------------------
+
+namespace {
+
+// The min size of the output buffer for each deflate().
+const std::size_t kMinOutputSize = 4096;
+
+}  // namespace
+
+bool Compress(const std::string& input, std::string* output, int level) {
+  output->clear();
+
+  if (input.empty()) {
+    return true;
+  }
+
+  // Allocating the zlib state (about 256KB) per call costs more than
+  // compressing a small input.
+  thread_local Compressor compressor;
+
+  // The output is sized by deflateBound() so it's done in one deflate().
+  return compressor.Init(level) &&
+         compressor.Compress(input.data(), input.size(), true, output);
+}
+
+bool Decompress(const std::string& input, std::string* output) {
   output->clear();
 
   if (input.empty()) {
     return true;
   }
 
-  z_stream stream;
-  stream.next_in = (Bytef*)input.data();
-  stream.avail_in = (uInt)input.size();
-  stream.zalloc = Z_NULL;
-  stream.zfree = Z_NULL;
-  stream.opaque = Z_NULL;
+  thread_local Decompressor decompressor;
 
-  int ret = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
-                         MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY);
-  if (ret != Z_OK) {
+  if (!decompressor.Init() ||
+      !decompressor.Decompress(input.data(), input.size(), output)) {
     return false;
   }
 
-  std::string buf;
-  buf.resize(input.size() / 2);  // TODO
+  if (!decompressor.finished()) {
+    LOG_ERRO("The compressed data is incomplete.");
+    return false;
+  }
 
-  // Run deflate() on input until output buffer is not full.
-  do {
-    stream.avail_out = (uInt)buf.size();
-    stream.next_out = (Bytef*)buf.data();
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+
+Compressor::Compressor() : stream_(new z_stream{}) {
+}
 
-    int err = deflate(&stream, Z_FINISH);
+Compressor::~Compressor() {
+  End();
+}
+
+bool Compressor::Init(int level) {
+  if (initialized_) {
+    // Reuse the allocated state.
+    initialized_ = deflateReset(stream_.get()) == Z_OK;
+
+    // Nothing has been compressed yet, so the level can be changed without
+    // any output.
+    if (initialized_ && level != level_) {
+      initialized_ =
+          deflateParams(stream_.get(), level, Z_DEFAULT_STRATEGY) == Z_OK;
+      level_ = level;
+    }
+    return initialized_;
+  }
+
+  stream_->zalloc = Z_NULL;
+  stream_->zfree = Z_NULL;
+  stream_->opaque = Z_NULL;
+
+  // About the windowBits parameter:
+  //   (https://stackoverflow.com/a/1838702)
+  //   (http://www.zlib.net/manual.html)
+  // Add 16 to windowBits to write a simple gzip header and trailer instead of
+  // the zlib wrapper.
+  int ret = deflateInit2(stream_.get(), level, Z_DEFLATED, MAX_WBITS + 16, 8,
+                         Z_DEFAULT_STRATEGY);
+  initialized_ = ret == Z_OK;
+  level_ = level;
+  return initialized_;
+}
 
-    if (err != Z_OK && err != Z_STREAM_END) {
-      deflateEnd(&stream);
-      if (stream.msg != nullptr) {
-        LOG_ERRO("zlib deflate error: %s", stream.msg);
+bool Compressor::Compress(const char* data, std::size_t size, bool finish,
+                          std::string* output) {
+  assert(initialized_);
+
+  stream_->next_in = (Bytef*)data;
+  stream_->avail_in = (uInt)size;
+
+  int flush = finish ? Z_FINISH : Z_NO_FLUSH;
+
+  while (true) {
+    // Deflate to the end of |output| directly.
+    // The bound doesn't count the data held by the compressor, so it's only
+    // a hint of the output size.
+    std::size_t offset = output->size();
+    std::size_t avail = std::max<std::size_t>(
+        deflateBound(stream_.get(), stream_->avail_in), kMinOutputSize);
+    output->resize(offset + avail);
+
+    stream_->next_out = (Bytef*)&(*output)[offset];
+    stream_->avail_out = (uInt)avail;
+
+    int err = deflate(stream_.get(), flush);
+
+    output->resize(offset + avail - stream_->avail_out);
+
+    if (err == Z_STREAM_END) {
+      break;
+    }
+
+    if (err == Z_BUF_ERROR) {
+      break;  // No progress is possible, i.e., no more input.
+    }
+
+    if (err != Z_OK) {
+      if (stream_->msg != nullptr) {
+        LOG_ERRO("zlib deflate error: %s", stream_->msg);
       }
       return false;
     }
 
-    std::size_t size = buf.size() - stream.avail_out;
-    output->append(buf.data(), size);
+    // Keep going until all the input is consumed and, if finishing, the
+    // stream is ended.
+    if (!finish && stream_->avail_in == 0 && stream_->avail_out != 0) {
+      break;
+    }
+  }
 
-  } while (stream.avail_out == 0);
+  return true;
+}
 
-  if (deflateEnd(&stream) != Z_OK) {
-    return false;
+void Compressor::End() {
+  if (initialized_) {
+    deflateEnd(stream_.get());
+    initialized_ = false;
   }
+}
 
-  return true;
+// -----------------------------------------------------------------------------
+
+Decompressor::Decompressor() : stream_(new z_stream{}) {
 }
 
-// Modified from:
-//   http://windrealm.org/tutorials/decompress-gzip-stream.php
-bool Decompress(const std::string& input, std::string* output) {
-  output->clear();
+Decompressor::~Decompressor() {
+  End();
+}
 
-  if (input.empty()) {
-    return true;
-  }
+bool Decompressor::Init() {
+  finished_ = false;
 
-  // Initialize the output buffer with the same size as the input.
-  std::string buf;
-  buf.resize(input.size());
+  if (initialized_) {
+    // Reuse the allocated state.
+    initialized_ = inflateReset(stream_.get()) == Z_OK;
+    return initialized_;
+  }
 
-  z_stream stream;
-  stream.next_in = (Bytef*)input.data();
-  stream.avail_in = (uInt)input.size();
-  stream.total_out = 0;
-  stream.zalloc = Z_NULL;
-  stream.zfree = Z_NULL;
+  stream_->zalloc = Z_NULL;
+  stream_->zfree = Z_NULL;
+  stream_->opaque = Z_NULL;
+  stream_->next_in = Z_NULL;
+  stream_->avail_in = 0;
 
   // About the windowBits parameter:
-  //   (https://stackoverflow.com/a/1838702)
-  //   (http://www.zlib.net/manual.html)
   // windowBits can also be greater than 15 for optional gzip decoding. Add 32
   // to windowBits to enable zlib and gzip decoding with automatic header
   // detection, or add 16 to decode only the gzip format (the zlib format will
   // return a Z_DATA_ERROR).
-  if (inflateInit2(&stream, MAX_WBITS + 32) != Z_OK) {
+  initialized_ = inflateInit2(stream_.get(), MAX_WBITS + 32) == Z_OK;
+  return initialized_;
+}
+
+bool Decompressor::Decompress(const char* data, std::size_t size,
+                              std::string* output) {
+  assert(initialized_);
+
+  if (size == 0) {
+    return true;
+  }
+
+  if (finished_) {
+    LOG_ERRO("Data after the end of the compressed stream.");
     return false;
   }
 
-  while (true) {
-    // Enlarge the output buffer if it's too small.
-    if (stream.total_out >= buf.size()) {
-      buf.resize(buf.size() + input.size() / 2);
-    }
+  stream_->next_in = (Bytef*)data;
+  stream_->avail_in = (uInt)size;
+
+  // Run inflate() until all the input is consumed and the output buffer is
+  // not full.
+  do {
+    // Inflate to the end of |output| directly.
+    // Double the output each time so a highly compressed input doesn't cause
+    // repeated small reallocations.
+    std::size_t offset = output->size();
+    std::size_t avail = std::max({ size * 2, offset, kMinOutputSize });
+    output->resize(offset + avail);
+
+    stream_->next_out = (Bytef*)&(*output)[offset];
+    stream_->avail_out = (uInt)avail;
 
-    stream.next_out = (Bytef*)(buf.data() + stream.total_out);
-    stream.avail_out = (uInt)buf.size() - stream.total_out;
+    int err = inflate(stream_.get(), Z_NO_FLUSH);
 
-    // Inflate another chunk.
-    int err = inflate(&stream, Z_SYNC_FLUSH);
+    output->resize(offset + avail - stream_->avail_out);
 
     if (err == Z_STREAM_END) {
+      finished_ = true;
+      if (stream_->avail_in > 0) {
+        LOG_ERRO("Data after the end of the compressed stream.");
+        return false;
+      }
       break;
     }
 
+    if (err == Z_BUF_ERROR) {
+      break;  // No progress is possible, i.e., no more input.
+    }
+
     if (err != Z_OK) {
-      inflateEnd(&stream);
-      if (stream.msg != nullptr) {
-        LOG_ERRO("zlib inflate error: %s", stream.msg);
+      if (stream_->msg != nullptr) {
+        LOG_ERRO("zlib inflate error: %s", stream_->msg);
       }
       return false;
     }
-  }
-
-  if (inflateEnd(&stream) != Z_OK) {
-    return false;
-  }
 
-  // Remove the unused part then move to the output
-  buf.erase(stream.total_out);
-  *output = std::move(buf);
+  } while (stream_->avail_in > 0 || stream_->avail_out == 0);
 
   return true;
 }
 
+void Decompressor::End() {
+  if (initialized_) {
+    inflateEnd(stream_.get());
+    initialized_ = false;
+  }
+}
+
 }  // namespace gzip
 }  // namespace webcc
@@ -1,18 +1,103 @@
 #ifndef WEBCC_GZIP_H_
 #define WEBCC_GZIP_H_
 
+#include <memory>
 #include <string>
 
+// Forward declaration of z_stream.
+struct z_stream_s;
+
 namespace webcc {
 namespace gzip {
 
+// Compression levels, from 1 (best speed) to 9 (best compression).
+// The default (-1) is currently equivalent to 6.
+const int kBestSpeed = 1;
+const int kBestCompression = 9;
+const int kDefaultLevel = -1;
+
 // Compress the input string to gzip format output.
-bool Compress(const std::string& input, std::string* output);
+// The zlib state is kept per thread and reused by the later calls, and the
+// output is sized up front by the bound of the compressed size, so a call
+// allocates nothing but the output.
+bool Compress(const std::string& input, std::string* output,
+              int level = kDefaultLevel);
 
 // Decompress the input string with auto detecting both gzip and zlib (deflate)
 // formats.
+// The zlib state is kept per thread and reused by the later calls.
 bool Decompress(const std::string& input, std::string* output);
 
+// A streaming compressor producing the gzip format.
+// The input is compressed piece by piece, so the memory it takes is fixed
+// (the zlib state plus the output of a piece) no matter how large the input
+// is.
+// Usage:
+//   Compressor compressor;
+//   compressor.Init();
+//   compressor.Compress(data1, size1, false, &output);
+//   compressor.Compress(data2, size2, false, &output);
+//   compressor.Compress(nullptr, 0, true, &output);
+class Compressor {
+public:
+  Compressor();
+  ~Compressor();
+
+  Compressor(const Compressor&) = delete;
+  Compressor& operator=(const Compressor&) = delete;
+
+  // Initialize (or re-initialize) the compressor for a new stream.
+  // The allocated state is reused on re-initialization, even if the level
+  // changes.
+  bool Init(int level = kDefaultLevel);
+
+  // Compress the input and append the output (if any) to |output|.
+  // The output of a piece might be held by the compressor until more input
+  // comes. If |finish| is true, all the output is flushed and the stream is
+  // ended.
+  bool Compress(const char* data, std::size_t size, bool finish,
+                std::string* output);
+
+private:
+  void End();
+
+  std::unique_ptr<z_stream_s> stream_;
+  bool initialized_ = false;
+  int level_ = kDefaultLevel;
+};
+
+// A streaming decompressor auto detecting both gzip and zlib (deflate)
+// formats.
+// The input is decompressed piece by piece as it comes, e.g., as the content
+// of a message is received.
+class Decompressor {
+public:
+  Decompressor();
+  ~Decompressor();
+
+  Decompressor(const Decompressor&) = delete;
+  Decompressor& operator=(const Decompressor&) = delete;
+
+  // Initialize (or re-initialize) the decompressor for a new stream.
+  bool Init();
+
+  // Decompress the input and append the output to |output|.
+  // Return false on invalid data, or data beyond the end of the stream.
+  bool Decompress(const char* data, std::size_t size, std::string* output);
+
+  // Has the end of the stream been reached?
+  bool finished() const {
+    return finished_;
+  }
+
+private:
+  void End();
+
+  std::unique_ptr<z_stream_s> stream_;
+  bool initialized_ = false;
+  bool finished_ = false;
+};
+
 }  // namespace gzip
 }  // namespace webcc
 
@@ -1,5 +1,6 @@
 #include "webcc/message.h"
 
+#include <cstdlib>
 #include <sstream>
 
 #include "boost/algorithm/string.hpp"
@@ -9,7 +10,25 @@
 
 namespace webcc {
 
-Message::Message() : body_(new Body{}), content_length_(kInvalidLength) {
+namespace {
+
+// The empty body is stateless, so it's shared by all the messages without a
+// body instead of being allocated for each one.
+const BodyPtr& EmptyBody() {
+  static const BodyPtr s_empty_body = std::make_shared<Body>();
+  return s_empty_body;
+}
+
+}  // namespace
+
+Message::Message() : body_(EmptyBody()), content_length_(kInvalidLength) {
+}
+
+void Message::Clear() {
+  body_ = EmptyBody();
+  headers_.Clear();
+  start_line_.clear();
+  content_length_ = kInvalidLength;
 }
 
 void Message::SetBody(BodyPtr body, bool set_length) {
@@ -18,14 +37,20 @@ void Message::SetBody(BodyPtr body, bool set_length) {
   }
 
   if (!body) {
-    body_.reset(new Body{});
+    body_ = EmptyBody();
   } else {
     body_ = body;
   }
 
   if (set_length) {
     content_length_ = body_->GetSize();
-    SetHeader(headers::kContentLength, std::to_string(content_length_));
+    if (content_length_ == kInvalidLength) {
+      // The size is unknown (e.g., StreamBody), use the chunked transfer
+      // coding instead.
+      SetHeader(headers::kTransferEncoding, "chunked");
+    } else {
+      SetHeader(headers::kContentLength, std::to_string(content_length_));
+    }
   }
 }
 
@@ -43,27 +68,27 @@ std::shared_ptr<FileBody> Message::file_body() const {
 }
 
 bool Message::IsConnectionKeepAlive() const {
-  using headers::kConnection;
-
   bool existed = false;
-  const std::string& connection = GetHeader(kConnection, &existed);
+  const std::string& connection = GetHeader(HeaderId::kConnection, &existed);
 
   if (!existed) {
     // Keep-Alive is by default for HTTP/1.1.
     return true;
   }
 
-  if (boost::iequals(connection, "Keep-Alive")) {
+  if (utility::IEquals(connection, "Keep-Alive")) {
     return true;
   }
 
   return false;
 }
 
-ContentEncoding Message::GetContentEncoding() const {
-  using headers::kContentEncoding;
+bool Message::IsChunked() const {
+  return utility::IEquals(GetHeader(HeaderId::kTransferEncoding), "chunked");
+}
 
-  const std::string& encoding = GetHeader(kContentEncoding);
+ContentEncoding Message::GetContentEncoding() const {
+  const std::string& encoding = GetHeader(HeaderId::kContentEncoding);
 
   if (encoding == "gzip") {
     return ContentEncoding::kGzip;
@@ -77,9 +102,35 @@ ContentEncoding Message::GetContentEncoding() const {
 }
 
 bool Message::AcceptEncodingGzip() const {
-  using headers::kAcceptEncoding;
+  return GetHeader(HeaderId::kAcceptEncoding).find("gzip") != std::string::npos;
+}
+
+bool Message::AcceptEncoding(const std::string& coding) const {
+  // E.g., "gzip, deflate, br;q=0.9"
+  const std::string& value = GetHeader(HeaderId::kAcceptEncoding);
+
+  std::vector<std::string> items;
+  boost::split(items, value, boost::is_any_of(","));
 
-  return GetHeader(kAcceptEncoding).find("gzip") != std::string::npos;
+  for (const std::string& item : items) {
+    std::size_t pos = item.find(';');
+    if (!boost::iequals(boost::trim_copy(item.substr(0, pos)), coding)) {
+      continue;
+    }
+
+    if (pos != std::string::npos) {
+      std::string key;
+      std::string value;
+      if (utility::SplitKV(item.substr(pos + 1), '=', &key, &value) &&
+          key == "q" && std::strtod(value.c_str(), nullptr) <= 0.0) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  return false;
 }
 
 void Message::SetContentType(const std::string& media_type,
@@ -103,7 +154,7 @@ Payload Message::GetPayload() const {
   payload.push_back(buffer(start_line_));
   payload.push_back(buffer(literal_buffers::CRLF));
 
-  for (const Header& h : headers_.data()) {
+  for (const Header& h : headers_) {
     payload.push_back(buffer(h.first));
     payload.push_back(buffer(literal_buffers::HEADER_SEPARATOR));
     payload.push_back(buffer(h.second));
@@ -115,12 +166,32 @@ Payload Message::GetPayload() const {
   return payload;
 }
 
+void Message::SerializeHeaders(std::string* data) const {
+  std::size_t size = start_line_.size() + 4;  // +4 for two CRLFs
+  for (const Header& h : headers_) {
+    size += h.first.size() + h.second.size() + 4;  // +4 for ": " and CRLF
+  }
+  data->reserve(data->size() + size);
+
+  data->append(start_line_);
+  data->append(kCRLF);
+
+  for (const Header& h : headers_) {
+    data->append(h.first);
+    data->append(literal_buffers::HEADER_SEPARATOR, 2);
+    data->append(h.second);
+    data->append(kCRLF);
+  }
+
+  data->append(kCRLF);
+}
+
 void Message::Dump(std::ostream& os) const {
   const std::string prefix = "    > ";
 
   os << prefix << start_line_ << std::endl;
 
-  for (const Header& h : headers_.data()) {
+  for (const Header& h : headers_) {
     os << prefix << h.first << ": " << h.second << std::endl;
   }
 
@@ -20,6 +20,10 @@ public:
 
   // ---------------------------------------------------------------------------
 
+  // Set the body.
+  // If |set_length| is true, `Content-Length` header will be set by the size
+  // of the body, or `Transfer-Encoding: chunked` if the size is unknown (see
+  // StreamBody).
   void SetBody(BodyPtr body, bool set_length);
 
   BodyPtr body() const {
@@ -44,23 +48,37 @@ public:
     headers_.Set(key, value);
   }
 
-  const std::string& GetHeader(const std::string& key,
+  // Set a header from the views, reusing the memory of the cleared headers.
+  void AssignHeader(boost::string_view key, boost::string_view value) {
+    headers_.Assign(key, value);
+  }
+
+  const std::string& GetHeader(boost::string_view key,
                                bool* existed = nullptr) const {
     return headers_.Get(key, existed);
   }
 
-  bool HasHeader(const std::string& key) const {
+  // Get a well-known header by ID, faster than by name.
+  const std::string& GetHeader(HeaderId id, bool* existed = nullptr) const {
+    return headers_.Get(id, existed);
+  }
+
+  bool HasHeader(boost::string_view key) const {
     return headers_.Has(key);
   }
 
+  bool HasHeader(HeaderId id) const {
+    return headers_.Has(id);
+  }
+
   // ---------------------------------------------------------------------------
 
   const std::string& start_line() const {
     return start_line_;
   }
 
-  void set_start_line(const std::string& start_line) {
-    start_line_ = start_line;
+  void set_start_line(boost::string_view start_line) {
+    start_line_.assign(start_line.data(), start_line.size());
   }
 
   std::size_t content_length() const {
@@ -76,6 +94,10 @@ public:
   // Check `Connection` header to see if it's "Keep-Alive".
   bool IsConnectionKeepAlive() const;
 
+  // Check `Transfer-Encoding` header to see if the body is sent with the
+  // chunked transfer coding.
+  bool IsChunked() const;
+
   // Determine content encoding (gzip, deflate or unknown) from
   // `Content-Encoding` header.
   ContentEncoding GetContentEncoding() const;
@@ -83,6 +105,10 @@ public:
   // Check `Accept-Encoding` header to see if it contains "gzip".
   bool AcceptEncodingGzip() const;
 
+  // Check `Accept-Encoding` header to see if the given content coding (e.g.,
+  // "br") is acceptable, i.e., it's listed without "q=0".
+  bool AcceptEncoding(const std::string& coding) const;
+
   // Set `Content-Type` header. E.g.,
   //   SetContentType("application/json; charset=utf-8")
   void SetContentType(const std::string& content_type) {
@@ -99,10 +125,20 @@ public:
   // Make the message complete in order to be sent.
   virtual void Prepare() = 0;
 
+  // Reset the message to the state just constructed.
+  // The memory of the start line and the headers is kept for the next message,
+  // e.g., a request recycled for the next one on the same connection.
+  virtual void Clear();
+
   // Get the payload for the socket to write.
   // This doesn't include the payload(s) of the body!
   Payload GetPayload() const;
 
+  // Serialize the start line and the headers, i.e., the same data as the
+  // payload above, into a single buffer (appended to |data|).
+  // A single buffer takes only one I/O vector of a gathered write.
+  void SerializeHeaders(std::string* data) const;
+
   // ---------------------------------------------------------------------------
 
   // Dump to output stream for logging purpose.
@@ -0,0 +1,232 @@
+#ifndef WEBCC_MPMC_QUEUE_H_
+#define WEBCC_MPMC_QUEUE_H_
+
+// A bounded lock-free multi-producer multi-consumer queue.
+// Based on Dmitry Vyukov's bounded MPMC queue:
+//   http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+// Messages are stored in a pre-allocated ring, so pushing doesn't allocate and
+// neither pushing nor popping takes a lock. Only the consumers finding the
+// queue empty park themselves on a condition variable, and a producer wakes up
+// at most one of them per push (no thundering herd). The producers don't touch
+// the mutex at all if no consumer is parked.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace webcc {
+
+template <typename T>
+class MpmcQueue {
+public:
+  // The |capacity| will be rounded up to a power of 2.
+  explicit MpmcQueue(std::size_t capacity = 16384) {
+    std::size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+
+    mask_ = size - 1;
+    cells_.reset(new Cell[size]);
+
+    for (std::size_t i = 0; i < size; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    enqueue_pos_.store(0, std::memory_order_relaxed);
+    dequeue_pos_.store(0, std::memory_order_relaxed);
+  }
+
+  MpmcQueue(const MpmcQueue&) = delete;
+  MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+  std::size_t capacity() const {
+    return mask_ + 1;
+  }
+
+  // Push a message, return false if the queue is full.
+  bool TryPush(const T& message) {
+    Cell* cell = nullptr;
+    std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::intptr_t>(seq) -
+                  static_cast<std::intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // Full
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->message = message;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    WakeOne();
+    return true;
+  }
+
+  // Push a message, yield (i.e., busy wait) while the queue is full.
+  // Only for the pushes which must not fail and rarely find the queue full
+  // (e.g., the null connections stopping the workers). A loop thread should
+  // call TryPush() and reject the message instead.
+  void Push(const T& message) {
+    while (!TryPush(message)) {
+      std::this_thread::yield();
+    }
+  }
+
+  // Pop a message, return false if the queue is empty.
+  bool TryPop(T* message) {
+    Cell* cell = nullptr;
+    std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::intptr_t>(seq) -
+                  static_cast<std::intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // Empty
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    *message = std::move(cell->message);
+    // Don't hold the resource (e.g., a connection) in the ring.
+    cell->message = T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Pop a message, return T() if the queue is empty.
+  T Pop() {
+    T message{};
+    TryPop(&message);
+    return message;
+  }
+
+  // Pop a message, park the calling thread until a message is available if
+  // the queue is empty.
+  T PopOrWait() {
+    T message{};
+
+    // Spin a little before parking, the producer is often only a moment ahead.
+    for (int i = 0; i < kSpinCount; ++i) {
+      if (TryPop(&message)) {
+        return message;
+      }
+      std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    waiters_.fetch_add(1);
+    // Pairs with the fence in WakeOne(): either the producer sees this waiter
+    // or this waiter sees the pushed message.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    while (!TryPop(&message)) {
+      not_empty_cv_.wait(lock);
+    }
+
+    waiters_.fetch_sub(1);
+    return message;
+  }
+
+  // Pop at most |max| messages into |messages| (appended), wait for the first
+  // one if the queue is empty. Return the number of messages popped.
+  std::size_t PopBatch(std::vector<T>* messages, std::size_t max) {
+    if (max == 0) {
+      return 0;
+    }
+
+    messages->push_back(PopOrWait());
+
+    std::size_t count = 1;
+    T message{};
+    while (count < max && TryPop(&message)) {
+      messages->push_back(std::move(message));
+      ++count;
+    }
+    return count;
+  }
+
+  void Clear() {
+    T message{};
+    while (TryPop(&message)) {
+    }
+  }
+
+  // Get the size of the queue.
+  // It's only a snapshot if other threads are pushing or popping.
+  std::size_t Size() const {
+    std::size_t enqueue_pos = enqueue_pos_.load(std::memory_order_acquire);
+    std::size_t dequeue_pos = dequeue_pos_.load(std::memory_order_acquire);
+    return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+  }
+
+private:
+  // Wake up one parked consumer, if any.
+  void WakeOne() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (waiters_.load(std::memory_order_relaxed) > 0) {
+      // Lock to make sure the consumer is either waiting on the condition
+      // variable or will see the message before it waits.
+      std::lock_guard<std::mutex> lock(mutex_);
+      not_empty_cv_.notify_one();
+    }
+  }
+
+  static const int kSpinCount = 16;
+
+  // Assume the cache line size is 64 bytes.
+  static const std::size_t kCacheLineSize = 64;
+
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    T message{};
+  };
+
+  using Padding = char[kCacheLineSize];
+
+  Padding pad0_;
+  std::unique_ptr<Cell[]> cells_;
+  std::size_t mask_;
+
+  // Keep the positions in separate cache lines to avoid false sharing between
+  // the producers and the consumers.
+  Padding pad1_;
+  std::atomic<std::size_t> enqueue_pos_;
+  Padding pad2_;
+  std::atomic<std::size_t> dequeue_pos_;
+  Padding pad3_;
+
+  // The number of parked consumers.
+  std::atomic<int> waiters_{ 0 };
+
+  std::mutex mutex_;
+  std::condition_variable not_empty_cv_;
+};
+
+}  // namespace webcc
+
+#endif  // WEBCC_MPMC_QUEUE_H_
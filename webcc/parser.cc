@@ -1,64 +1,119 @@
 #include "webcc/parser.h"
 
-#include "boost/algorithm/string.hpp"
+#include <algorithm>
+
 #include "boost/filesystem/operations.hpp"
 
 #include "webcc/logger.h"
 #include "webcc/message.h"
+#include "webcc/search.h"
 #include "webcc/utility.h"
 
-#if WEBCC_ENABLE_GZIP
-#include "webcc/gzip.h"
-#endif
-
 namespace bfs = boost::filesystem;
 
 namespace webcc {
 
+namespace {
+
+// The max chunk size, so that the size plus the CRLF after the chunk data
+// never overflows (nor reaches kInvalidLength).
+const std::size_t kMaxChunkSize = kInvalidLength - 3;
+
+}  // namespace
+
 // -----------------------------------------------------------------------------
 
+BodyHandler::BodyHandler(Message* message) : message_(message) {
+#if WEBCC_ENABLE_GZIP
+  // The headers have been parsed when the body handler is created.
+  if (IsCompressed()) {
+    decompressor_.reset(new gzip::Decompressor);
+    if (!decompressor_->Init()) {
+      LOG_ERRO("Failed to initialize the decompressor.");
+      decompressor_.reset();
+    }
+  }
+#endif  // WEBCC_ENABLE_GZIP
+}
+
+BodyHandler::~BodyHandler() = default;
+
 bool BodyHandler::IsCompressed() const {
   return message_->GetContentEncoding() != ContentEncoding::kUnknown;
 }
 
-// -----------------------------------------------------------------------------
+bool BodyHandler::decompressed() const {
+#if WEBCC_ENABLE_GZIP
+  return !!decompressor_;
+#else
+  return false;
+#endif
+}
+
+bool BodyHandler::AddContent(const char* data, std::size_t count) {
+  content_length_ += count;
 
-// TODO
-//  // Reserve memory to avoid frequent reallocation when append.
-//  try {
-//    content_.reserve(content_length_);
-//  } catch (const std::exception& e) {
-//    LOG_ERRO("Failed to reserve content memory: %s.", e.what());
-//  }
+#if WEBCC_ENABLE_GZIP
+  if (decompressor_) {
+    decompressed_data_.clear();
+    if (!decompressor_->Decompress(data, count, &decompressed_data_)) {
+      LOG_ERRO("Cannot decompress the HTTP content!");
+      return false;
+    }
+
+    decompressed_size_ += decompressed_data_.size();
+
+    if (max_decompression_ratio_ > 0 &&
+        decompressed_size_ > kDecompressionRatioMinSize &&
+        decompressed_size_ / content_length_ > max_decompression_ratio_) {
+      LOG_ERRO("The HTTP content expands too far on decompression!");
+      return false;
+    }
 
-void StringBodyHandler::AddContent(const char* data, std::size_t count) {
-  content_.append(data, count);
+    if (!decompressed_data_.empty()) {
+      AddData(decompressed_data_.data(), decompressed_data_.size());
+    }
+    return true;
+  }
+#endif  // WEBCC_ENABLE_GZIP
+
+  AddData(data, count);
+  return true;
 }
 
-void StringBodyHandler::AddContent(const std::string& data) {
-  content_.append(data);
+bool BodyHandler::FinishDecompress() {
+#if WEBCC_ENABLE_GZIP
+  if (decompressor_ && content_length_ > 0 && !decompressor_->finished()) {
+    LOG_ERRO("The compressed HTTP content is incomplete!");
+    return false;
+  }
+#endif  // WEBCC_ENABLE_GZIP
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+
+void StringBodyHandler::AddData(const char* data, std::size_t count) {
+  data_.append(data, count);
 }
 
 bool StringBodyHandler::Finish() {
-  if (content_.empty()) {
+  if (!FinishDecompress()) {
+    return false;
+  }
+
+  if (data_.empty()) {
     // The call to message_->SetBody() is not necessary since message is
     // always initialized with an empty body.
     return true;
   }
 
-  auto body = std::make_shared<StringBody>(std::move(content_), IsCompressed());
-
-#if WEBCC_ENABLE_GZIP
-  LOG_INFO("Decompress the HTTP content...");
-  if (!body->Decompress()) {
-    LOG_ERRO("Cannot decompress the HTTP content!");
-    return false;
-  }
-#else
-  if (body->compressed()) {
+  bool compressed = IsCompressed() && !decompressed();
+  if (compressed) {
     LOG_WARN("Compressed HTTP content remains untouched.");
   }
-#endif  // WEBCC_ENABLE_GZIP
+
+  auto body = std::make_shared<StringBody>(std::move(data_), compressed);
 
   message_->SetBody(body, false);
 
@@ -87,24 +142,24 @@ bool FileBodyHandler::OpenFile() {
   return true;
 }
 
-void FileBodyHandler::AddContent(const char* data, std::size_t count) {
+void FileBodyHandler::AddData(const char* data, std::size_t count) {
   ofstream_.write(data, count);
-  streamed_size_ += count;
-}
-
-void FileBodyHandler::AddContent(const std::string& data) {
-  ofstream_ << data;
-  streamed_size_ += data.size();
 }
 
 bool FileBodyHandler::Finish() {
   ofstream_.close();
 
+  if (!FinishDecompress()) {
+    return false;
+  }
+
+  if (IsCompressed() && !decompressed()) {
+    LOG_WARN("Compressed HTTP content remains untouched.");
+  }
+
   // Create a file body based on the streamed temp file.
   auto body = std::make_shared<FileBody>(temp_path_, true);
 
-  // TODO: Compress
-
   message_->SetBody(body, false);
 
   return true;
@@ -112,6 +167,29 @@ bool FileBodyHandler::Finish() {
 
 // -----------------------------------------------------------------------------
 
+void PendingData::Append(const char* data, std::size_t size) {
+  if (off_ > 0 && off_ >= data_.size() - off_) {
+    // Reclaim the consumed space, moving no more than what was consumed.
+    data_.erase(0, off_);
+    off_ = 0;
+  }
+  data_.append(data, size);
+}
+
+std::string PendingData::Take() {
+  std::string data;
+  if (off_ == 0) {
+    data.swap(data_);
+  } else {
+    data.assign(data_, off_, std::string::npos);
+    data_.clear();
+  }
+  off_ = 0;
+  return data;
+}
+
+// -----------------------------------------------------------------------------
+
 Parser::Parser() {
   Reset();
 }
@@ -127,7 +205,7 @@ bool Parser::Parse(const char* data, std::size_t length) {
   }
 
   // Append the new data to the pending data.
-  pending_data_.append(data, length);
+  pending_data_.Append(data, length);
 
   if (!ParseHeaders()) {
     return false;
@@ -158,12 +236,18 @@ bool Parser::Parse(const char* data, std::size_t length) {
   return ParseContent("", 0);
 }
 
+std::string Parser::TakeLeftover() {
+  assert(finished_);
+
+  return pending_data_.Take();
+}
+
 void Parser::Reset() {
   message_ = nullptr;
   body_handler_.reset();
   stream_ = false;
 
-  pending_data_.clear();
+  pending_data_.Clear();
 
   content_length_ = kInvalidLength;
   content_type_.Reset();
@@ -176,16 +260,22 @@ void Parser::Reset() {
 }
 
 bool Parser::ParseHeaders() {
-  std::size_t off = 0;
+  const char* begin = pending_data_.data();
+  const char* end = begin + pending_data_.size();
+
+  // The beginning of the line to parse.
+  const char* p = begin;
 
   while (true) {
-    std::string line;
-    if (!GetNextLine(off, &line, false)) {
+    const char* cr = search::FindCRLF(p, end);
+    if (cr == nullptr) {
       // Can't find a full header line, need more data from next read.
       break;
     }
 
-    off = off + line.size() + 2;  // +2 for CRLF
+    boost::string_view line{ p, static_cast<std::size_t>(cr - p) };
+
+    p = cr + 2;  // +2 for CRLF
 
     if (line.empty()) {
       header_ended_ = true;
@@ -194,11 +284,12 @@ bool Parser::ParseHeaders() {
 
     if (!start_line_parsed_) {
       start_line_parsed_ = true;
-      message_->set_start_line(line);
 
-      if (!ParseStartLine(line)) {
+      message_->set_start_line(line);
+      if (!ParseStartLine(message_->start_line())) {
         return false;
       }
+
     } else {
       if (!ParseHeaderLine(line)) {
         return false;
@@ -206,8 +297,8 @@ bool Parser::ParseHeaders() {
     }
   }
 
-  // Remove the data which has just been parsed.
-  pending_data_.erase(0, off);
+  // Consume the data which has just been parsed.
+  pending_data_.Consume(p - begin);
 
   return true;
 }
@@ -224,61 +315,96 @@ void Parser::CreateBodyHandler() {
   } else {
     body_handler_.reset(new StringBodyHandler{ message_ });
   }
-}
 
-bool Parser::GetNextLine(std::size_t off, std::string* line, bool erase) {
-  std::size_t pos = pending_data_.find(kCRLF, off);
+  if (body_handler_) {
+    body_handler_->set_max_decompression_ratio(max_decompression_ratio_);
+  }
+}
 
-  if (pos == std::string::npos) {
+bool Parser::GetNextLine(std::size_t off, std::string* line, bool consume) {
+  boost::string_view view;
+  if (!GetNextLine(off, &view, consume)) {
     return false;
   }
 
-  std::size_t count = pos - off;
+  line->assign(view.data(), view.size());
+  return true;
+}
+
+bool Parser::GetNextLine(std::size_t off, boost::string_view* line,
+                         bool consume) {
+  assert(!consume || off == 0);
+
+  const char* begin = pending_data_.data();
+  const char* cr = search::FindCRLF(begin + off, begin + pending_data_.size());
+
+  if (cr == nullptr) {
+    return false;
+  }
 
-  if (count > 0) {
-    *line = pending_data_.substr(off, count);
-  }  // else: empty line
+  *line = boost::string_view{ begin + off,
+                              static_cast<std::size_t>(cr - begin - off) };
 
-  if (erase) {
-    pending_data_.erase(off, count + 2);
+  if (consume) {
+    pending_data_.Consume(line->size() + 2);
   }
 
   return true;
 }
 
-bool Parser::ParseHeaderLine(const std::string& line) {
-  Header header;
-  if (!utility::SplitKV(line, ':', &header.first, &header.second)) {
-    LOG_ERRO("Invalid header: %s", line.c_str());
+bool Parser::ParseHeaderLine(boost::string_view line) {
+  const char* colon = search::FindChar(line.begin(), line.end(), ':');
+  if (colon == nullptr) {
+    LOG_ERRO("Invalid header: %s", line.to_string().c_str());
     return false;
   }
 
-  if (boost::iequals(header.first, headers::kContentLength)) {
-    content_length_parsed_ = true;
+  std::size_t pos = colon - line.begin();
 
+  boost::string_view name = utility::Trim(line.substr(0, pos));
+  boost::string_view value = utility::Trim(line.substr(pos + 1));
+
+  if (utility::IEquals(name, headers::kContentLength)) {
     std::size_t content_length = kInvalidLength;
-    if (!utility::ToSize(header.second, 10, &content_length)) {
-      LOG_ERRO("Invalid content length: %s.", header.second.c_str());
+    if (!utility::ToSize(value, &content_length)) {
+      LOG_ERRO("Invalid content length: %s.", value.to_string().c_str());
+      return false;
+    }
+
+    // The message boundary must be unambiguous, otherwise the data taken as
+    // the next pipelined message might not be what the peer meant.
+    if (content_length_parsed_ && content_length != content_length_) {
+      LOG_ERRO("Conflicting content lengths: %zu, %zu.", content_length_,
+               content_length);
+      return false;
+    }
+    if (chunked_) {
+      LOG_ERRO("Content length with chunked transfer encoding.");
       return false;
     }
 
     LOG_INFO("Content length: %u.", content_length);
+    content_length_parsed_ = true;
     content_length_ = content_length;
 
-  } else if (boost::iequals(header.first, headers::kContentType)) {
-    content_type_.Parse(header.second);
+  } else if (utility::IEquals(name, headers::kContentType)) {
+    content_type_.Parse(value.to_string());
     if (!content_type_.Valid()) {
-      LOG_ERRO("Invalid content-type header: %s", header.second.c_str());
+      LOG_ERRO("Invalid content-type header: %s", value.to_string().c_str());
       return false;
     }
-  } else if (boost::iequals(header.first, headers::kTransferEncoding)) {
-    if (header.second == "chunked") {
+  } else if (utility::IEquals(name, headers::kTransferEncoding)) {
+    if (value == "chunked") {
+      if (content_length_parsed_) {
+        LOG_ERRO("Chunked transfer encoding with content length.");
+        return false;
+      }
       // The content is chunked.
       chunked_ = true;
     }
   }
 
-  message_->SetHeader(std::move(header));
+  message_->AssignHeader(name, value);
 
   return true;
 }
@@ -294,6 +420,7 @@ bool Parser::ParseContent(const char* data, std::size_t length) {
 bool Parser::ParseFixedContent(const char* data, std::size_t length) {
   if (!content_length_parsed_) {
     // No Content-Length, no content.
+    // The pending data, if any, belongs to the next message.
     Finish();
     return true;
   }
@@ -305,23 +432,52 @@ bool Parser::ParseFixedContent(const char* data, std::size_t length) {
 
   if (!pending_data_.empty()) {
     // This is the data left after the headers are parsed.
-    body_handler_->AddContent(pending_data_);
-    pending_data_.clear();
+    // The data beyond the content, if any, stays for the next message.
+    std::size_t count = 0;
+    if (!AddFixedContent(pending_data_.data(), pending_data_.size(),
+                         &count)) {
+      return false;
+    }
+    pending_data_.Consume(count);
   }
 
   // Don't have to firstly put the data to the pending data.
-  body_handler_->AddContent(data, length);
+  std::size_t count = 0;
+  if (!AddFixedContent(data, length, &count)) {
+    return false;
+  }
+
+  if (count < length) {
+    // Keep the data of the next (pipelined) message.
+    pending_data_.Append(data + count, length - count);
+  }
 
   if (IsFixedContentFull()) {
     // All content has been read.
-    Finish();
+    return Finish();
+  }
+
+  return true;
+}
+
+bool Parser::AddFixedContent(const char* data, std::size_t length,
+                             std::size_t* count) {
+  std::size_t size = body_handler_->GetContentLength();
+
+  *count = 0;
+  if (size < content_length_) {
+    *count = std::min(length, content_length_ - size);
+  }
+
+  if (*count > 0 && !body_handler_->AddContent(data, *count)) {
+    return false;
   }
 
   return true;
 }
 
 bool Parser::ParseChunkedContent(const char* data, std::size_t length) {
-  pending_data_.append(data, length);
+  pending_data_.Append(data, length);
 
   while (true) {
     // Read chunk-size if necessary.
@@ -330,18 +486,28 @@ bool Parser::ParseChunkedContent(const char* data, std::size_t length) {
         return false;
       }
 
+      if (chunk_size_ == kInvalidLength) {
+        // Wait for the chunk-size line from next read.
+        break;
+      }
+
       LOG_VERB("Chunk size: %u.", chunk_size_);
     }
 
     if (chunk_size_ == 0) {
-      Finish();
+      if (SkipTrailers()) {
+        return Finish();
+      }  // else: Wait for more data from next read.
       return true;
     }
 
-    if (chunk_size_ + 2 <= pending_data_.size()) {  // +2 for CRLF
-      body_handler_->AddContent(pending_data_.c_str(), chunk_size_);
+    if (pending_data_.size() >= 2 &&
+        chunk_size_ <= pending_data_.size() - 2) {  // -2 for CRLF
+      if (!body_handler_->AddContent(pending_data_.data(), chunk_size_)) {
+        return false;
+      }
 
-      pending_data_.erase(0, chunk_size_ + 2);
+      pending_data_.Consume(chunk_size_ + 2);
 
       // Reset chunk-size (NOT to 0).
       chunk_size_ = kInvalidLength;
@@ -350,11 +516,14 @@ bool Parser::ParseChunkedContent(const char* data, std::size_t length) {
       continue;
 
     } else if (chunk_size_ > pending_data_.size()) {
-      body_handler_->AddContent(pending_data_);
+      if (!body_handler_->AddContent(pending_data_.data(),
+                                     pending_data_.size())) {
+        return false;
+      }
 
       chunk_size_ -= pending_data_.size();
 
-      pending_data_.clear();
+      pending_data_.Consume(pending_data_.size());
 
       // Wait for more data from next read.
       break;
@@ -374,30 +543,59 @@ bool Parser::ParseChunkedContent(const char* data, std::size_t length) {
 bool Parser::ParseChunkSize() {
   LOG_VERB("Parse chunk size.");
 
-  std::string line;
+  boost::string_view line;
   if (!GetNextLine(0, &line, true)) {
     return true;
   }
 
-  LOG_VERB("Chunk size line: [%s].", line.c_str());
-
-  std::string hex_str;  // e.g., "cf0" (3312)
+  // E.g., "cf0" (3312), might be followed by chunk extensions (";name=value")
+  // which are ignored.
+  std::size_t size = 0;
+  std::size_t digits = 0;
+  for (; digits < line.size(); ++digits) {
+    char c = line[digits];
+    std::size_t digit = 0;
+    if (c >= '0' && c <= '9') {
+      digit = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      digit = c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      digit = c - 'A' + 10;
+    } else {
+      break;
+    }
 
-  std::size_t pos = line.find(' ');
-  if (pos != std::string::npos) {
-    hex_str = line.substr(0, pos);
-  } else {
-    hex_str = line;
+    if (size > (kMaxChunkSize - digit) / 16) {
+      digits = 0;  // Too large
+      break;
+    }
+    size = size * 16 + digit;
   }
 
-  if (!utility::ToSize(hex_str, 16, &chunk_size_)) {
-    LOG_ERRO("Invalid chunk-size: %s.", hex_str.c_str());
+  if (digits == 0) {
+    LOG_ERRO("Invalid chunk-size: %s.", line.to_string().c_str());
     return false;
   }
 
+  chunk_size_ = size;
+
   return true;
 }
 
+bool Parser::SkipTrailers() {
+  // The last chunk is followed by optional trailer fields and an empty line.
+  while (true) {
+    boost::string_view line;
+    if (!GetNextLine(0, &line, true)) {
+      return false;
+    }
+    if (line.empty()) {
+      return true;
+    }
+    LOG_VERB("Skip trailer: %s.", line.to_string().c_str());
+  }
+}
+
 bool Parser::IsFixedContentFull() const {
   assert(content_length_ != kInvalidLength);
   return body_handler_->GetContentLength() >= content_length_;
@@ -1,13 +1,20 @@
 #ifndef WEBCC_PARSER_H_
 #define WEBCC_PARSER_H_
 
+#include <cassert>
+#include <memory>
 #include <string>
 
 #include "boost/filesystem/fstream.hpp"
+#include "boost/utility/string_view.hpp"
 
 #include "webcc/common.h"
 #include "webcc/globals.h"
 
+#if WEBCC_ENABLE_GZIP
+#include "webcc/gzip.h"
+#endif
+
 namespace webcc {
 
 class Message;
@@ -16,24 +23,62 @@ class Message;
 
 class BodyHandler {
 public:
-  explicit BodyHandler(Message* message) : message_(message) {
-  }
+  explicit BodyHandler(Message* message);
 
-  virtual ~BodyHandler() = default;
+  virtual ~BodyHandler();
 
-  virtual void AddContent(const char* data, std::size_t count) = 0;
+  // Add the content received, decompress it on the fly if it's compressed.
+  // Return false if it can't be decompressed or it expands too far (see
+  // set_max_decompression_ratio()).
+  bool AddContent(const char* data, std::size_t count);
 
-  virtual void AddContent(const std::string& data) = 0;
+  bool AddContent(const std::string& data) {
+    return AddContent(data.data(), data.size());
+  }
 
-  virtual std::size_t GetContentLength() const = 0;
+  // Set the max ratio of the decompressed size to the compressed size,
+  // 0 means no limit. See kMaxDecompressionRatio.
+  void set_max_decompression_ratio(std::size_t max_decompression_ratio) {
+    max_decompression_ratio_ = max_decompression_ratio;
+  }
+
+  // Get the length of the content received (before decompression).
+  std::size_t GetContentLength() const {
+    return content_length_;
+  }
 
   virtual bool Finish() = 0;
 
 protected:
   bool IsCompressed() const;
 
+  // Add the (decompressed) data to the body.
+  virtual void AddData(const char* data, std::size_t count) = 0;
+
+  // Check if the compressed content, if any, has been completely
+  // decompressed. Called by Finish().
+  bool FinishDecompress();
+
+  // Is the data added decompressed from the content?
+  bool decompressed() const;
+
 protected:
   Message* message_;
+
+  std::size_t content_length_ = 0;
+
+  std::size_t max_decompression_ratio_ = 0;
+
+#if WEBCC_ENABLE_GZIP
+  // Null if the content is not compressed.
+  std::unique_ptr<gzip::Decompressor> decompressor_;
+
+  // The data decompressed from a piece of the content.
+  std::string decompressed_data_;
+
+  // The size of all the data decompressed.
+  std::size_t decompressed_size_ = 0;
+#endif  // WEBCC_ENABLE_GZIP
 };
 
 // -----------------------------------------------------------------------------
@@ -45,17 +90,13 @@ public:
 
   ~StringBodyHandler() override = default;
 
-  void AddContent(const char* data, std::size_t count) override;
-  void AddContent(const std::string& data) override;
-
-  std::size_t GetContentLength() const override {
-    return content_.size();
-  }
-
   bool Finish() override;
 
+protected:
+  void AddData(const char* data, std::size_t count) override;
+
 private:
-  std::string content_;
+  std::string data_;
 };
 
 // -----------------------------------------------------------------------------
@@ -71,23 +112,63 @@ public:
   // Open a temp file for data streaming.
   bool OpenFile();
 
-  void AddContent(const char* data, std::size_t count) override;
-  void AddContent(const std::string& data) override;
-
-  std::size_t GetContentLength() const override {
-    return streamed_size_;
-  }
-
   bool Finish() override;
 
+protected:
+  void AddData(const char* data, std::size_t count) override;
+
 private:
-  std::size_t streamed_size_ = 0;
   boost::filesystem::ofstream ofstream_;
   Path temp_path_;
 };
 
 // -----------------------------------------------------------------------------
 
+// The data waiting to be parsed, consumed from the front.
+// Consuming only moves a read cursor. The consumed space is reclaimed when
+// more data is appended and it's not smaller than the unconsumed data, so
+// each byte is moved at most once on average and the parsing stays linear in
+// the size of the data, however small the pieces it's consumed in are.
+class PendingData {
+public:
+  const char* data() const {
+    return data_.data() + off_;
+  }
+
+  std::size_t size() const {
+    return data_.size() - off_;
+  }
+
+  bool empty() const {
+    return off_ == data_.size();
+  }
+
+  void Append(const char* data, std::size_t size);
+
+  // Consume |size| (<= size()) bytes from the front.
+  // The consumed data stays valid until the next Append().
+  void Consume(std::size_t size) {
+    assert(size <= this->size());
+    off_ += size;
+  }
+
+  void Clear() {
+    data_.clear();
+    off_ = 0;
+  }
+
+  // Take all the unconsumed data.
+  std::string Take();
+
+private:
+  std::string data_;
+
+  // The read cursor.
+  std::size_t off_ = 0;
+};
+
+// -----------------------------------------------------------------------------
+
 // HTTP request and response parser.
 class Parser {
 public:
@@ -99,16 +180,33 @@ public:
 
   void Init(Message* message);
 
+  // Set the max ratio of the decompressed size to the compressed size of the
+  // content, 0 means no limit. See kMaxDecompressionRatio.
+  // It's kept across Init().
+  void set_max_decompression_ratio(std::size_t max_decompression_ratio) {
+    max_decompression_ratio_ = max_decompression_ratio;
+  }
+
+  bool header_ended() const {
+    return header_ended_;
+  }
+
   bool finished() const {
     return finished_;
   }
 
   bool Parse(const char* data, std::size_t length);
 
+  // Take the data left after the message has finished, i.e., the beginning of
+  // the next message pipelined on the same connection.
+  std::string TakeLeftover();
+
 protected:
   void Reset();
 
   // Parse headers from pending data.
+  // The lines are scanned in place, no line is copied out of the pending
+  // data.
   // Return false only on syntax errors.
   bool ParseHeaders();
 
@@ -118,23 +216,41 @@ protected:
 
   void CreateBodyHandler();
 
-  // Get next line (using delimiter CRLF) from the pending data.
+  // Get next line (using delimiter CRLF) from the pending data, starting at
+  // |off|.
   // The line will not contain a trailing CRLF.
-  // If |erase| is true, the line, as well as the trailing CRLF, will be erased
-  // from the pending data.
-  bool GetNextLine(std::size_t off, std::string* line, bool erase);
+  // If |consume| is true, the line, as well as the trailing CRLF, will be
+  // consumed from the pending data, and |off| must be 0.
+  bool GetNextLine(std::size_t off, std::string* line, bool consume);
+
+  // The same as above but the line is a view of the pending data, valid until
+  // more data is appended.
+  bool GetNextLine(std::size_t off, boost::string_view* line, bool consume);
 
   virtual bool ParseStartLine(const std::string& line) = 0;
 
-  bool ParseHeaderLine(const std::string& line);
+  // Parse a header line in place, i.e., a view of the pending data.
+  // Only the field name and value are copied (into the message).
+  bool ParseHeaderLine(boost::string_view line);
 
   virtual bool ParseContent(const char* data, std::size_t length);
 
   bool ParseFixedContent(const char* data, std::size_t length);
 
+  // Add the data as fixed content, up to the content length.
+  // |count| is set to the size of the data added, the data beyond that
+  // belongs to the next message.
+  // Return false if the content can't be added (e.g., decompression error).
+  bool AddFixedContent(const char* data, std::size_t length,
+                       std::size_t* count);
+
   bool ParseChunkedContent(const char* data, std::size_t length);
   bool ParseChunkSize();
 
+  // Skip the trailer fields after the last chunk.
+  // Return false if more data is needed.
+  bool SkipTrailers();
+
   bool IsFixedContentFull() const;
 
   // Return false if the compressed content cannot be decompressed.
@@ -149,7 +265,7 @@ protected:
   bool stream_;
 
   // Data waiting to be parsed.
-  std::string pending_data_;
+  PendingData pending_data_;
 
   // Temporary data and helper flags for parsing.
   std::size_t content_length_;
@@ -160,6 +276,9 @@ protected:
   bool chunked_;
   std::size_t chunk_size_;
   bool finished_;
+
+  // Not reset by Init().
+  std::size_t max_decompression_ratio_ = 0;
 };
 
 }  // namespace webcc
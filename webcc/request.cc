@@ -40,4 +40,15 @@ void Request::Prepare() {
   }
 }
 
+void Request::Clear() {
+  Message::Clear();
+
+  method_.clear();
+  url_.Clear();
+  args_.clear();
+  ip_.clear();
+  view_.reset();
+  static_file_.reset();
+}
+
 }  // namespace webcc
@@ -10,6 +10,9 @@
 
 namespace webcc {
 
+class View;
+struct StaticFile;
+
 class Request : public Message {
 public:
   Request() = default;
@@ -35,6 +38,11 @@ public:
     url_ = std::move(url);
   }
 
+  // Parse the URL in place, reusing the memory of the last one.
+  void ParseUrl(boost::string_view url) {
+    url_.Parse(url);
+  }
+
   const std::string& host() const {
     return url_.host();
   }
@@ -55,6 +63,29 @@ public:
     args_ = args;
   }
 
+  void set_args(UrlArgs&& args) {
+    args_ = std::move(args);
+  }
+
+  // The view matched when the headers were parsed, null if none.
+  const std::shared_ptr<View>& view() const {
+    return view_;
+  }
+
+  void set_view(std::shared_ptr<View> view) {
+    view_ = std::move(view);
+  }
+
+  // The cached static file matched when the headers were parsed (instead of
+  // a view), null if none or it's not cached.
+  const std::shared_ptr<const StaticFile>& static_file() const {
+    return static_file_;
+  }
+
+  void set_static_file(std::shared_ptr<const StaticFile> static_file) {
+    static_file_ = std::move(static_file);
+  }
+
   const std::string& ip() const {
     return ip_;
   }
@@ -73,6 +104,8 @@ public:
 
   void Prepare() override;
 
+  void Clear() override;
+
 private:
   std::string method_;
 
@@ -82,6 +115,11 @@ private:
   // Used by server only.
   UrlArgs args_;
 
+  // The route matched, saved so that the request is routed only once.
+  // Used by server only.
+  std::shared_ptr<View> view_;
+  std::shared_ptr<const StaticFile> static_file_;
+
   // Client IP address.
   std::string ip_;
 };
@@ -1,16 +1,17 @@
 #include "webcc/request_parser.h"
 
-#include <vector>
-
-#include "boost/algorithm/string.hpp"
+#include <algorithm>
 
 #include "webcc/logger.h"
 #include "webcc/request.h"
+#include "webcc/search.h"
 #include "webcc/utility.h"
 
 namespace webcc {
 
-RequestParser::RequestParser() : request_(nullptr) {
+RequestParser::RequestParser() : request_(nullptr), non_blocking_(false) {
+  // The requests are untrusted, limit the decompression by default.
+  set_max_decompression_ratio(kMaxDecompressionRatio);
 }
 
 void RequestParser::Init(Request* request, ViewMatcher view_matcher) {
@@ -20,11 +21,20 @@ void RequestParser::Init(Request* request, ViewMatcher view_matcher) {
 
   request_ = request;
   view_matcher_ = view_matcher;
+  non_blocking_ = false;
+
+  step_ = kStart;
+  delimiter_.clear();
+  part_.reset();
+  form_parts_.clear();
+
+  content_started_ = false;
+  content_size_ = 0;
+  next_data_.clear();
 }
 
 bool RequestParser::OnHeadersEnd() {
-  bool matched = view_matcher_(request_->method(), request_->url().path(),
-                               &stream_);
+  bool matched = view_matcher_(request_, &stream_, &non_blocking_);
 
   if (!matched) {
     LOG_WARN("No view matches the request: %s %s", request_->method().c_str(),
@@ -35,15 +45,27 @@ bool RequestParser::OnHeadersEnd() {
 }
 
 bool RequestParser::ParseStartLine(const std::string& line) {
-  std::vector<std::string> strs;
-  boost::split(strs, line, boost::is_any_of(" "), boost::token_compress_on);
+  // E.g., "GET /path?query HTTP/1.1", the parts are separated by spaces.
+  std::size_t method_end = line.find(' ');
+  if (method_end == 0 || method_end == std::string::npos) {
+    return false;
+  }
 
-  if (strs.size() != 3) {
+  std::size_t url_begin = line.find_first_not_of(' ', method_end);
+  std::size_t url_end = line.find(' ', url_begin);
+  if (url_end == std::string::npos) {
     return false;
   }
 
-  request_->set_method(std::move(strs[0]));
-  request_->set_url(Url(strs[1]));
+  std::size_t version_begin = line.find_first_not_of(' ', url_end);
+  if (version_begin == std::string::npos ||
+      line.find(' ', version_begin) != std::string::npos) {
+    return false;
+  }
+
+  request_->set_method(line.substr(0, method_end));
+  request_->ParseUrl(
+      boost::string_view{ line }.substr(url_begin, url_end - url_begin));
 
   // HTTP version is ignored.
 
@@ -64,29 +86,36 @@ bool RequestParser::ParseContent(const char* data, std::size_t length) {
 
 bool RequestParser::ParseMultipartContent(const char* data,
                                           std::size_t length) {
-  pending_data_.append(data, length);
-
   if (!content_length_parsed_ || content_length_ == kInvalidLength) {
     // Invalid content length (syntax error).
     return false;
   }
 
-  while (true) {
+  if (!content_started_) {
+    content_started_ = true;
+    // The data left after the headers are parsed might go beyond the content.
+    std::string left = pending_data_.Take();
+    AppendMultipartData(left.data(), left.size());
+  }
+
+  AppendMultipartData(data, length);
+
+  while (step_ != Step::kEnded) {
     if (pending_data_.empty()) {
       // Wait data from next read.
       break;
     }
 
     if (step_ == Step::kStart) {
-      std::string line;
+      boost::string_view line;
       if (!GetNextLine(0, &line, true)) {
         break;  // Not enough data
       }
-      if (!IsBoundary(line, 0, line.size())) {
-        LOG_ERRO("Invalid boundary: %s", line.c_str());
+      if (!IsBoundary(line)) {
+        LOG_ERRO("Invalid boundary: %s", line.to_string().c_str());
         return false;
       }
-      LOG_INFO("Boundary line: %s", line.c_str());
+      LOG_INFO("Boundary line: %s", line.to_string().c_str());
       // Go to next step.
       step_ = Step::kBoundaryParsed;
       continue;
@@ -116,8 +145,13 @@ bool RequestParser::ParseMultipartContent(const char* data,
       std::size_t off = 0;
       std::size_t count = 0;
       bool ended = false;
-      // TODO: Remember last CRLF position.
-      if (!GetNextBoundaryLine(&off, &count, &ended)) {
+      if (!FindBoundary(&off, &count, &ended)) {
+        // The data before |off| can't be a part of the next boundary, move it
+        // to the part so that it won't be searched again.
+        if (off > 0) {
+          part_->AppendData(pending_data_.data(), off);
+          pending_data_.Consume(off);
+        }
         // Wait until next boundary.
         break;
       }
@@ -125,17 +159,10 @@ bool RequestParser::ParseMultipartContent(const char* data,
       LOG_INFO("Next boundary found.");
 
       // This part has ended.
-      if (off > 2) {
-        // -2 for excluding the CRLF after the data.
-        part_->AppendData(pending_data_.data(), off - 2);
+      part_->AppendData(pending_data_.data(), off);
 
-        // Erase the data of this part and the next boundary.
-        // +2 for including the CRLF after the boundary.
-        pending_data_.erase(0, off + count + 2);
-      } else {
-        LOG_ERRO("Invalid part data.");
-        return false;
-      }
+      // Consume the data of this part and the next boundary.
+      pending_data_.Consume(off + count);
 
       // Save this part
       form_parts_.push_back(part_);
@@ -155,27 +182,56 @@ bool RequestParser::ParseMultipartContent(const char* data,
     }
   }
 
-  if (step_ == Step::kEnded) {
-    LOG_INFO("Multipart data has ended.");
+  if (step_ != Step::kEnded) {
+    if (content_size_ == content_length_) {
+      LOG_ERRO("The multipart data ends before the last boundary.");
+      return false;
+    }
+    // Wait data from next read.
+    return true;
+  }
+
+  // Discard the epilogue, i.e., the data after the last boundary within the
+  // content length.
+  pending_data_.Clear();
+
+  if (content_size_ < content_length_) {
+    // Wait for the rest of the epilogue from next read.
+    return true;
+  }
 
-    // Create a body and set to the request.
+  LOG_INFO("Multipart data has ended.");
 
-    auto body = std::make_shared<FormBody>(form_parts_,
-                                           content_type_.boundary());
+  // Create a body and set to the request.
 
-    request_->SetBody(body, false);  // TODO: set_length?
+  auto body = std::make_shared<FormBody>(form_parts_,
+                                         content_type_.boundary());
 
-    Finish();
-  }
+  request_->SetBody(body, false);  // TODO: set_length?
 
-  return true;
+  // The data beyond the content belongs to the next (pipelined) request.
+  pending_data_.Append(next_data_.data(), next_data_.size());
+  next_data_.clear();
+
+  return Finish();
+}
+
+void RequestParser::AppendMultipartData(const char* data, std::size_t length) {
+  std::size_t count = std::min(length, content_length_ - content_size_);
+
+  pending_data_.Append(data, count);
+  content_size_ += count;
+
+  if (count < length) {
+    next_data_.append(data + count, length - count);
+  }
 }
 
 bool RequestParser::ParsePartHeaders(bool* need_more_data) {
   std::size_t off = 0;
 
   while (true) {
-    std::string line;
+    boost::string_view line;
     if (!GetNextLine(off, &line, false)) {
       // Need more data from next read.
       *need_more_data = true;
@@ -189,21 +245,24 @@ bool RequestParser::ParsePartHeaders(bool* need_more_data) {
       break;
     }
 
-    Header header;
-    if (!utility::SplitKV(line, ':', &header.first, &header.second)) {
-      LOG_ERRO("Invalid part header line: %s", line.c_str());
+    std::size_t pos = line.find(':');
+    if (pos == boost::string_view::npos) {
+      LOG_ERRO("Invalid part header line: %s", line.to_string().c_str());
       return false;
     }
 
-    LOG_INFO("Part header (%s: %s).", header.first.c_str(),
-             header.second.c_str());
+    boost::string_view name = utility::Trim(line.substr(0, pos));
+    boost::string_view value = utility::Trim(line.substr(pos + 1));
+
+    LOG_INFO("Part header (%s: %s).", name.to_string().c_str(),
+             value.to_string().c_str());
 
     // Parse Content-Disposition.
-    if (boost::iequals(header.first, headers::kContentDisposition)) {
-      ContentDisposition content_disposition(header.second);
+    if (utility::IEquals(name, headers::kContentDisposition)) {
+      ContentDisposition content_disposition(value.to_string());
       if (!content_disposition.valid()) {
         LOG_ERRO("Invalid content-disposition header: %s",
-                 header.second.c_str());
+                 value.to_string().c_str());
         return false;
       }
       part_->set_name(content_disposition.name());
@@ -215,63 +274,68 @@ bool RequestParser::ParsePartHeaders(bool* need_more_data) {
     // TODO: Parse other headers.
   }
 
-  // Remove the data which has just been parsed.
-  pending_data_.erase(0, off);
+  // Consume the data which has just been parsed.
+  pending_data_.Consume(off);
 
   return true;
 }
 
-bool RequestParser::GetNextBoundaryLine(std::size_t* b_off,
-                                        std::size_t* b_count,
-                                        bool* ended) {
-  std::size_t off = 0;
+bool RequestParser::FindBoundary(std::size_t* off, std::size_t* count,
+                                 bool* ended) {
+  // The part data is followed by a CRLF and the boundary line.
+  if (delimiter_.empty()) {
+    delimiter_ = "\r\n--" + content_type_.boundary();
+  }
 
+  const char* begin = pending_data_.data();
+  const char* end = begin + pending_data_.size();
+
+  const char* p = begin;
   while (true) {
-    std::size_t pos = pending_data_.find(kCRLF, off);
-    if (pos == std::string::npos) {
-      break;
+    p = search::Find(p, end, delimiter_.data(), delimiter_.size());
+
+    if (p == nullptr) {
+      // The tail might be the beginning of the delimiter.
+      std::size_t tail = std::min(pending_data_.size(), delimiter_.size() - 1);
+      *off = pending_data_.size() - tail;
+      return false;
+    }
+
+    // The delimiter must be followed by CRLF, or "--" and CRLF for the last
+    // boundary.
+    const char* q = p + delimiter_.size();
+    if (end - q < 2 || (q[0] == '-' && q[1] == '-' && end - q < 4)) {
+      *off = p - begin;  // Wait for more data
+      return false;
     }
 
-    std::size_t count = pos - off;
-    if (count == 0) {
-      off = pos + 2;
-      continue;  // Empty line
+    bool last = q[0] == '-' && q[1] == '-';
+    if (last) {
+      q += 2;
     }
 
-    if (IsBoundary(pending_data_, off, count, ended)) {
-      *b_off = off;
-      *b_count = count;
+    if (q[0] == '\r' && q[1] == '\n') {
+      *off = p - begin;
+      *count = q + 2 - p;
+      *ended = last;
       return true;
     }
 
-    off = pos + 2;
+    // Not a boundary line, e.g., "--boundary" followed by other characters.
+    ++p;
   }
-
-  return false;
 }
 
-bool RequestParser::IsBoundary(const std::string& str, std::size_t off,
-                               std::size_t count, bool* end) const {
+bool RequestParser::IsBoundary(boost::string_view line) const {
   const std::string& boundary = content_type_.boundary();
 
-  if (count != boundary.size() + 2 && count != boundary.size() + 4) {
-    return false;
-  }
-
-  if (str[off] != '-' || str[off + 1] != '-') {
+  // "--" + boundary
+  if (line.size() != boundary.size() + 2 || line[0] != '-' ||
+      line[1] != '-') {
     return false;
   }
 
-  if (count == boundary.size() + 4) {
-    if (str[off + count - 1] != '-' || str[off + count - 2] != '-') {
-      return false;
-    }
-    if (end != nullptr) {
-      *end = true;
-    }
-  }
-  
-  return strncmp(boundary.c_str(), &str[off + 2], boundary.size()) == 0;
+  return line.substr(2) == boundary;
 }
 
 }  // namespace webcc
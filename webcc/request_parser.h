@@ -8,11 +8,15 @@
 
 namespace webcc {
 
-using ViewMatcher =
-    std::function<bool(const std::string&, const std::string&, bool*)>;
-
 class Request;
 
+// A function for matching the view of a request by HTTP method and URL (path)
+// once its headers have been parsed. The match could be saved to the request
+// (e.g., Request::set_view()) to not route the request again.
+// The last two arguments receive if the view asks for data streaming and if
+// the view is non-blocking.
+using ViewMatcher = std::function<bool(Request*, bool*, bool*)>;
+
 class RequestParser : public Parser {
 public:
   RequestParser();
@@ -21,6 +25,12 @@ public:
 
   void Init(Request* request, ViewMatcher view_matcher);
 
+  // Is the matched view non-blocking?
+  // The request could then be handled right in the loop thread.
+  bool non_blocking() const {
+    return non_blocking_;
+  }
+
 private:
   // Override to match the URL against views and check if the matched view
   // asks for data streaming.
@@ -36,13 +46,21 @@ private:
   // Multipart specific parsing helpers.
 
   bool ParseMultipartContent(const char* data, std::size_t length);
+
+  // Append the data to the pending data up to the content length, keep the
+  // data beyond that for the next (pipelined) request.
+  void AppendMultipartData(const char* data, std::size_t length);
   bool ParsePartHeaders(bool* need_more_data);
-  bool GetNextBoundaryLine(std::size_t* b_off, std::size_t* b_count,
-                           bool* ended);
 
-  // Check if the str.substr(off, count) is a boundary.
-  bool IsBoundary(const std::string& str, std::size_t off,
-                  std::size_t count, bool* end = nullptr) const;
+  // Find the next boundary line (with the CRLF before it) in the pending
+  // data. If found, |off| and |count| are set to the position and the size
+  // of it, and |ended| tells if it's the last boundary.
+  // If not found, |off| is set to the size of the data which can't be a part
+  // of the next boundary.
+  bool FindBoundary(std::size_t* off, std::size_t* count, bool* ended);
+
+  // Check if the line is the first boundary line.
+  bool IsBoundary(boost::string_view line) const;
 
 private:
   Request* request_;
@@ -51,6 +69,9 @@ private:
   // received. The parsing will stop and fail if no view can be matched.
   ViewMatcher view_matcher_;
 
+  // Is the matched view non-blocking?
+  bool non_blocking_;
+
   // Form data parsing step.
   enum Step {
     kStart,
@@ -60,11 +81,23 @@ private:
   };
   Step step_ = kStart;
 
+  // The delimiter before a boundary line, i.e., CRLF + "--" + boundary.
+  std::string delimiter_;
+
   // The current form part being parsed.
   FormPartPtr part_;
 
   // All form parts parsed.
   std::vector<FormPartPtr> form_parts_;
+
+  // Has the multipart data (i.e., the content) started to be parsed?
+  bool content_started_ = false;
+
+  // The size of the content appended to the pending data.
+  std::size_t content_size_ = 0;
+
+  // The data beyond the content, i.e., the beginning of the next request.
+  std::string next_data_;
 };
 
 }  // namespace webcc
@@ -0,0 +1,38 @@
+#ifndef WEBCC_RESPONDER_H_
+#define WEBCC_RESPONDER_H_
+
+#include <memory>
+
+#include "boost/asio/ip/tcp.hpp"
+
+#include "webcc/globals.h"
+#include "webcc/response.h"
+
+namespace webcc {
+
+// A handle for sending the response of a request later, from any thread.
+// See AsyncView.
+class Responder {
+public:
+  // The executor of the connection (i.e., of its loop).
+  using executor_type = boost::asio::ip::tcp::socket::executor_type;
+
+  virtual ~Responder() = default;
+
+  // Get the executor of the connection.
+  // Any async operation started on it runs in the loop of the connection.
+  virtual executor_type get_executor() const = 0;
+
+  // Send the response back to the client.
+  // It's thread-safe and only the first call takes effect.
+  virtual void Send(ResponsePtr response) = 0;
+
+  // Send a response with the given status and an empty body to the client.
+  virtual void Send(Status status) = 0;
+};
+
+using ResponderPtr = std::shared_ptr<Responder>;
+
+}  // namespace webcc
+
+#endif  // WEBCC_RESPONDER_H_
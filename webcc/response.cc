@@ -1,5 +1,6 @@
 #include "webcc/response.h"
 
+#include "webcc/body.h"
 #include "webcc/utility.h"
 
 namespace webcc {
@@ -9,9 +10,11 @@ static const std::pair<int, const char*> kTable[] = {
   { Status::kCreated, "Created" },
   { Status::kAccepted, "Accepted" },
   { Status::kNoContent, "No Content" },
+  { Status::kPartialContent, "Partial Content" },
   { Status::kNotModified, "Not Modified" },
   { Status::kBadRequest, "Bad Request" },
   { Status::kNotFound, "Not Found" },
+  { Status::kRangeNotSatisfiable, "Range Not Satisfiable" },
   { Status::kInternalServerError, "Internal Server Error" },
   { Status::kNotImplemented, "Not Implemented" },
   { Status::kServiceUnavailable, "Service Unavailable" },
@@ -27,6 +30,12 @@ static const char* GetReason(int status) {
 }
 
 void Response::Prepare() {
+  // The size of the body is unknown, the chunked transfer coding is the only
+  // framing other than closing the connection.
+  if (body_->GetSize() == kInvalidLength && !IsChunked()) {
+    SetHeader(headers::kTransferEncoding, "chunked");
+  }
+
   if (!start_line_.empty()) {
     return;
   }
@@ -44,4 +53,35 @@ void Response::Prepare() {
   SetHeader(headers::kServer, utility::UserAgent());
 }
 
+const std::string* Response::GetCanned(int status, bool keep_alive) {
+  static const std::size_t kSize = sizeof(kTable) / sizeof(kTable[0]);
+
+  // The canned responses of kTable, with Keep-Alive and Close.
+  struct CannedResponses {
+    CannedResponses() {
+      for (std::size_t i = 0; i < kSize; ++i) {
+        for (int k = 0; k < 2; ++k) {
+          Response response{ static_cast<Status>(kTable[i].first) };
+          response.SetBody(std::make_shared<Body>(), true);
+          response.SetHeader(headers::kConnection,
+                             k == 0 ? "Close" : "Keep-Alive");
+          response.Prepare();
+          response.SerializeHeaders(&data[i][k]);
+        }
+      }
+    }
+
+    std::string data[kSize][2];
+  };
+
+  static const CannedResponses s_canned;
+
+  for (std::size_t i = 0; i < kSize; ++i) {
+    if (kTable[i].first == status) {
+      return &s_canned.data[i][keep_alive ? 1 : 0];
+    }
+  }
+  return nullptr;
+}
+
 }  // namespace webcc
@@ -31,8 +31,17 @@ public:
     reason_ = reason;
   }
 
+  // Also set `Transfer-Encoding: chunked` if the size of the body is unknown
+  // (e.g., StreamBody) but the body was set without it.
   void Prepare() override;
 
+  // Get the serialized response (i.e., the start line and the headers) of the
+  // status with an empty body, e.g., the 404 of the server, the same as the
+  // response prepared by Connection::SendResponse(Status).
+  // The responses of the common statuses are serialized once and shared.
+  // Return null for the other statuses.
+  static const std::string* GetCanned(int status, bool keep_alive);
+
 private:
   int status_;  // Status code
   std::string reason_;  // Reason phrase
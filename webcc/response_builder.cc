@@ -28,6 +28,10 @@ ResponsePtr ResponseBuilder::operator()() {
       if (request_ && request_->AcceptEncodingGzip()) {
         if (body_->Compress()) {
           response->SetHeader(headers::kContentEncoding, "gzip");
+        } else if (NeedGzipBody()) {
+          // Compress the other bodies (e.g., a file) on the fly.
+          body_ = std::make_shared<GzipBody>(body_);
+          response->SetHeader(headers::kContentEncoding, "gzip");
         }
       }
     }
@@ -55,6 +59,20 @@ ResponseBuilder& ResponseBuilder::File(const webcc::Path& path,
   return *this;
 }
 
+#if WEBCC_ENABLE_GZIP
+
+bool ResponseBuilder::NeedGzipBody() const {
+  // A string body is compressed in place (see StringBody::Compress()).
+  if (std::dynamic_pointer_cast<StringBody>(body_)) {
+    return false;
+  }
+
+  std::size_t size = body_->GetSize();
+  return size == kInvalidLength || size > kGzipThreshold;
+}
+
+#endif  // WEBCC_ENABLE_GZIP
+
 ResponseBuilder& ResponseBuilder::Date() {
   headers_.push_back(headers::kDate);
   headers_.push_back(utility::GetTimestamp());
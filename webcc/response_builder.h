@@ -92,6 +92,13 @@ public:
     return *this;
   }
 
+  // Use the data produced by the generator as body.
+  // It's sent with the chunked transfer coding, see StreamBody.
+  ResponseBuilder& Stream(StreamBody::Generator generator) {
+    body_.reset(new StreamBody{ std::move(generator) });
+    return *this;
+  }
+
   // Use the file content as body.
   // NOTE: Error::kFileError might be thrown.
   ResponseBuilder& File(const webcc::Path& path, bool infer_media_type = true,
@@ -114,6 +121,11 @@ public:
 #endif  // WEBCC_ENABLE_GZIP
 
 private:
+#if WEBCC_ENABLE_GZIP
+  // Should the body be compressed on the fly by a GzipBody or not.
+  bool NeedGzipBody() const;
+#endif  // WEBCC_ENABLE_GZIP
+
   RequestPtr request_;
 
   // Status code.
@@ -129,7 +141,9 @@ private:
   std::string charset_;
 
 #if WEBCC_ENABLE_GZIP
-  // Compress the body data (only for string body).
+  // Compress the body data.
+  // A string body is compressed in place, the other bodies (e.g., a file) are
+  // compressed on the fly while they are sent (see GzipBody).
   bool gzip_ = false;
 #endif  // WEBCC_ENABLE_GZIP
 
@@ -2,38 +2,85 @@
 
 #include <algorithm>
 
-#include "boost/algorithm/string.hpp"
-
 #include "webcc/logger.h"
+#include "webcc/utility.h"
 
 namespace webcc {
 
+namespace {
+
+inline char ToLower(char c) {
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+// Case-insensitive (ASCII) less-than, for the literal segments.
+bool ILess(boost::string_view str1, boost::string_view str2) {
+  std::size_t size = std::min(str1.size(), str2.size());
+  for (std::size_t i = 0; i < size; ++i) {
+    unsigned char c1 = ToLower(str1[i]);
+    unsigned char c2 = ToLower(str2[i]);
+    if (c1 != c2) {
+      return c1 < c2;
+    }
+  }
+  return str1.size() < str2.size();
+}
+
+bool IsDigits(boost::string_view str) {
+  if (str.empty()) {
+    return false;
+  }
+  for (char c : str) {
+    if (c < '0' || c > '9') {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
 bool Router::Route(const std::string& url, ViewPtr view,
-                   const Strings& methods) {
+                   const Strings& methods, bool non_blocking) {
   assert(view);
 
-  // TODO: More error check
+  std::size_t index = routes_.size();
 
-  routes_.push_back({ url, {}, view, methods });
+  routes_.push_back({ url, {}, view, methods, 0, non_blocking });
+
+  for (const std::string& method : methods) {
+    routes_.back().method_bits |= MethodBit(method);
+  }
+
+  if (!AddToTrie(url, index)) {
+    routes_.pop_back();
+    return false;
+  }
 
   return true;
 }
 
 bool Router::Route(const UrlRegex& regex_url, ViewPtr view,
-                   const Strings& methods) {
+                   const Strings& methods, bool non_blocking) {
   assert(view);
 
   // TODO: More error check
 
   try {
 
-    routes_.push_back({ "", regex_url(), view, methods });
+    routes_.push_back({ "", regex_url(), view, methods, 0, non_blocking });
 
   } catch (const std::regex_error& e) {
     LOG_ERRO("Not a valid regular expression: %s", e.what());
     return false;
   }
 
+  for (const std::string& method : methods) {
+    routes_.back().method_bits |= MethodBit(method);
+  }
+
+  regex_routes_.push_back(routes_.size() - 1);
+
   return true;
 }
 
@@ -41,61 +88,316 @@ ViewPtr Router::FindView(const std::string& method, const std::string& url,
                          UrlArgs* args) {
   assert(args != nullptr);
 
-  for (auto& route : routes_) {
-    if (std::find(route.methods.begin(), route.methods.end(), method) ==
-        route.methods.end()) {
-      continue;
+  const RouteInfo* route = Match(method, url, args);
+  if (route == nullptr) {
+    return ViewPtr();
+  }
+
+  return route->view;
+}
+
+bool Router::MatchView(const std::string& method, const std::string& url,
+                       bool* stream, bool* non_blocking) {
+  assert(stream != nullptr);
+  *stream = false;
+
+  if (non_blocking != nullptr) {
+    *non_blocking = false;
+  }
+
+  const RouteInfo* route = Match(method, url, nullptr);
+  if (route == nullptr) {
+    return false;
+  }
+
+  *stream = route->view->Stream(method);
+
+  if (non_blocking != nullptr) {
+    *non_blocking = route->non_blocking;
+  }
+
+  return true;
+}
+
+bool Router::MatchView(Request* request, bool* stream, bool* non_blocking) {
+  assert(request != nullptr);
+  assert(stream != nullptr);
+  *stream = false;
+
+  if (non_blocking != nullptr) {
+    *non_blocking = false;
+  }
+
+  UrlArgs args;
+  const RouteInfo* route =
+      Match(request->method(), request->url().path(), &args);
+  if (route == nullptr) {
+    return false;
+  }
+
+  *stream = route->view->Stream(request->method());
+
+  if (non_blocking != nullptr) {
+    *non_blocking = route->non_blocking;
+  }
+
+  request->set_view(route->view);
+  request->set_args(std::move(args));
+
+  return true;
+}
+
+unsigned Router::MethodBit(const std::string& method) {
+  static const char* const kMethods[] = {
+    methods::kGet,     methods::kHead,    methods::kPost,
+    methods::kPut,     methods::kDelete,  methods::kConnect,
+    methods::kOptions, methods::kTrace,   methods::kPatch,
+  };
+
+  for (std::size_t i = 0; i < sizeof(kMethods) / sizeof(kMethods[0]); ++i) {
+    if (method == kMethods[i]) {
+      return 1u << i;
+    }
+  }
+  return 0;
+}
+
+bool Router::MatchMethod(const RouteInfo& route, const std::string& method,
+                         unsigned method_bit) {
+  if (method_bit != 0) {
+    return (route.method_bits & method_bit) != 0;
+  }
+
+  // Not a common method.
+  return std::find(route.methods.begin(), route.methods.end(), method) !=
+         route.methods.end();
+}
+
+bool Router::AddToTrie(const std::string& url, std::size_t route) {
+  if (url.empty() || url[0] != '/') {
+    LOG_ERRO("The URL should start with '/': %s", url.c_str());
+    return false;
+  }
+
+  Node* node = &root_;
+
+  boost::string_view rest{ url };
+  rest.remove_prefix(1);
+
+  while (true) {
+    std::size_t slash = rest.find('/');
+    boost::string_view segment = rest.substr(0, slash);
+
+    SegmentType type = SegmentType::kLiteral;
+
+    if (segment == "*") {
+      if (slash != boost::string_view::npos) {
+        LOG_ERRO("The wildcard should be the last segment: %s", url.c_str());
+        return false;
+      }
+      type = SegmentType::kWildcard;
+
+    } else if (segment.size() >= 2 && segment.front() == '{' &&
+               segment.back() == '}') {
+      // E.g., "{id}", "{id:int}", the name is only for the readability.
+      boost::string_view param = segment.substr(1, segment.size() - 2);
+      std::size_t colon = param.find(':');
+      boost::string_view param_type =
+          colon == boost::string_view::npos ? "" : param.substr(colon + 1);
+
+      if (param_type.empty() || param_type == "str") {
+        type = SegmentType::kString;
+      } else if (param_type == "int") {
+        type = SegmentType::kInt;
+      } else {
+        LOG_ERRO("Unknown parameter type: %s", url.c_str());
+        return false;
+      }
     }
 
-    if (route.url.empty()) {
-      std::smatch match;
+    Node* child = nullptr;
+
+    if (type == SegmentType::kLiteral) {
+      std::string literal = segment.to_string();
+      std::transform(literal.begin(), literal.end(), literal.begin(), ToLower);
 
-      if (std::regex_match(url, match, route.url_regex)) {
-        // Any sub-matches?
-        // Start from 1 because match[0] is the whole string itself.
-        for (size_t i = 1; i < match.size(); ++i) {
-          args->push_back(match[i].str());
-        }
+      auto it = std::lower_bound(
+          node->literals.begin(), node->literals.end(), literal,
+          [](const std::unique_ptr<Node>& n, const std::string& str) {
+            return ILess(n->literal, str);
+          });
+
+      if (it == node->literals.end() || (*it)->literal != literal) {
+        std::unique_ptr<Node> new_node{ new Node };
+        new_node->literal = std::move(literal);
+        it = node->literals.insert(it, std::move(new_node));
+      }
+      child = it->get();
 
-        return route.view;
+    } else if (type == SegmentType::kWildcard) {
+      if (!node->wildcard) {
+        node->wildcard.reset(new Node);
+        node->wildcard->type = type;
       }
+      child = node->wildcard.get();
+
     } else {
-      if (boost::iequals(route.url, url)) {
-        return route.view;
+      auto it = std::find_if(node->params.begin(), node->params.end(),
+                             [type](const std::unique_ptr<Node>& n) {
+                               return n->type == type;
+                             });
+
+      if (it == node->params.end()) {
+        std::unique_ptr<Node> new_node{ new Node };
+        new_node->type = type;
+        // The more specific type first.
+        it = node->params.insert(
+            type == SegmentType::kInt ? node->params.begin()
+                                      : node->params.end(),
+            std::move(new_node));
       }
+      child = it->get();
+    }
+
+    node = child;
+
+    if (slash == boost::string_view::npos) {
+      break;
     }
+    rest.remove_prefix(slash + 1);
   }
 
-  return ViewPtr();
+  node->routes.push_back(route);
+  return true;
 }
 
-bool Router::MatchView(const std::string& method, const std::string& url,
-                       bool* stream) {
-  assert(stream != nullptr);
-  *stream = false;
+const Router::RouteInfo* Router::Match(const std::string& method,
+                                       const std::string& url,
+                                       UrlArgs* args) const {
+  unsigned method_bit = MethodBit(method);
+
+  if (!url.empty() && url[0] == '/') {
+    boost::string_view rest{ url };
+    rest.remove_prefix(1);
+
+    const RouteInfo* route = MatchNode(root_, rest, method, method_bit, args);
+    if (route != nullptr) {
+      return route;
+    }
+  }
+
+  // The slow path.
+  for (std::size_t index : regex_routes_) {
+    const RouteInfo& route = routes_[index];
+
+    if (!MatchMethod(route, method, method_bit)) {
+      continue;
+    }
 
-  for (auto& route : routes_) {
-    if (std::find(route.methods.begin(), route.methods.end(), method) ==
-        route.methods.end()) {
+    if (args == nullptr) {
+      if (std::regex_match(url, route.url_regex)) {
+        return &route;
+      }
       continue;
     }
 
-    if (route.url.empty()) {
-      std::smatch match;
+    std::smatch match;
 
-      if (std::regex_match(url, match, route.url_regex)) {
-        *stream = route.view->Stream(method);
-        return true;
+    if (std::regex_match(url, match, route.url_regex)) {
+      // Any sub-matches?
+      // Start from 1 because match[0] is the whole string itself.
+      for (std::size_t i = 1; i < match.size(); ++i) {
+        args->push_back(match[i].str());
       }
-    } else {
-      if (boost::iequals(route.url, url)) {
-        *stream = route.view->Stream(method);
-        return true;
+
+      return &route;
+    }
+  }
+
+  return nullptr;
+}
+
+const Router::RouteInfo* Router::MatchNode(const Node& node,
+                                           boost::string_view rest,
+                                           const std::string& method,
+                                           unsigned method_bit,
+                                           UrlArgs* args) const {
+  std::size_t slash = rest.find('/');
+  boost::string_view segment = rest.substr(0, slash);
+
+  // Literals first, then the parameters, and the wildcard at last.
+
+  auto it = std::lower_bound(
+      node.literals.begin(), node.literals.end(), segment,
+      [](const std::unique_ptr<Node>& n, boost::string_view str) {
+        return ILess(n->literal, str);
+      });
+
+  if (it != node.literals.end() && utility::IEquals((*it)->literal, segment)) {
+    const RouteInfo* route =
+        MatchChild(**it, rest, slash, method, method_bit, args);
+    if (route != nullptr) {
+      return route;
+    }
+  }
+
+  for (const auto& param : node.params) {
+    if (segment.empty() ||
+        (param->type == SegmentType::kInt && !IsDigits(segment))) {
+      continue;
+    }
+
+    if (args != nullptr) {
+      args->push_back(segment.to_string());
+    }
+
+    const RouteInfo* route =
+        MatchChild(*param, rest, slash, method, method_bit, args);
+    if (route != nullptr) {
+      return route;
+    }
+
+    if (args != nullptr) {
+      args->pop_back();
+    }
+  }
+
+  if (node.wildcard) {
+    const RouteInfo* route = FindRoute(*node.wildcard, method, method_bit);
+    if (route != nullptr) {
+      if (args != nullptr) {
+        args->push_back(rest.to_string());
       }
+      return route;
     }
   }
 
-  return false;
+  return nullptr;
+}
+
+const Router::RouteInfo* Router::MatchChild(const Node& node,
+                                            boost::string_view rest,
+                                            std::size_t slash,
+                                            const std::string& method,
+                                            unsigned method_bit,
+                                            UrlArgs* args) const {
+  if (slash == boost::string_view::npos) {
+    // The last segment.
+    return FindRoute(node, method, method_bit);
+  }
+
+  return MatchNode(node, rest.substr(slash + 1), method, method_bit, args);
+}
+
+const Router::RouteInfo* Router::FindRoute(const Node& node,
+                                           const std::string& method,
+                                           unsigned method_bit) const {
+  for (std::size_t index : node.routes) {
+    if (MatchMethod(routes_[index], method, method_bit)) {
+      return &routes_[index];
+    }
+  }
+  return nullptr;
 }
 
 }  // namespace webcc
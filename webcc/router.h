@@ -1,28 +1,47 @@
 #ifndef WEBCC_ROUTER_H_
 #define WEBCC_ROUTER_H_
 
+#include <memory>
 #include <regex>
 #include <string>
+#include <vector>
+
+#include "boost/utility/string_view.hpp"
 
 #include "webcc/globals.h"
 #include "webcc/view.h"
 
 namespace webcc {
 
+// The routes of plain URLs are compiled into a trie of the path segments,
+// which matches a URL in the time of its length instead of the number of
+// routes. The routes of regular expressions are matched one by one after the
+// trie, as the slow path.
 class Router {
 public:
   virtual ~Router() = default;
 
   // Route a URL to a view.
   // The URL should start with "/". E.g., "/instances".
+  // A segment of the URL could also be a parameter, which is passed to the
+  // view as an URL argument (see Request::args()):
+  //   - "{name}" matches any non-empty segment;
+  //   - "{name:int}" matches a segment of digits only;
+  //   - "*" (the last segment only) matches all the rest of the URL.
+  // E.g., "/books/{id:int}", "/static/*".
+  // If |non_blocking| is true, the view promises not to block (e.g., a health
+  // check or an in-memory lookup) and its requests will be handled directly in
+  // the loop thread which parsed them instead of being queued for the workers.
   bool Route(const std::string& url, ViewPtr view,
-             const Strings& methods = { "GET" });
+             const Strings& methods = { "GET" }, bool non_blocking = false);
 
   // Route a URL (as regular expression) to a view.
   // The URL should start with "/" and be a regular expression.
   // E.g., "/instances/(\\d+)".
+  // The regular expressions are only tried if no URL above matches.
+  // See the above overload for |non_blocking|.
   bool Route(const UrlRegex& regex_url, ViewPtr view,
-             const Strings& methods = { "GET" });
+             const Strings& methods = { "GET" }, bool non_blocking = false);
 
   // Find the view by HTTP method and URL (path).
   ViewPtr FindView(const std::string& method, const std::string& url,
@@ -31,8 +50,14 @@ public:
   // Match the view by HTTP method and URL (path).
   // Return if a view is matched or not.
   // If the view asks for data streaming, |stream| will be set to true.
+  // If the view was routed as non-blocking, |non_blocking| (optional) will be
+  // set to true.
   bool MatchView(const std::string& method, const std::string& url,
-                 bool* stream);
+                 bool* stream, bool* non_blocking = nullptr);
+
+  // Match the view of the request as above, and save the view and the URL
+  // arguments to the request if matched.
+  bool MatchView(Request* request, bool* stream, bool* non_blocking = nullptr);
 
 private:
   struct RouteInfo {
@@ -40,10 +65,73 @@ private:
     std::regex url_regex;
     ViewPtr view;
     Strings methods;
+    // The bits of the common methods, see MethodBit().
+    unsigned method_bits;
+    bool non_blocking;
+  };
+
+  enum class SegmentType {
+    kLiteral,
+    kInt,
+    kString,
+    kWildcard,
+  };
+
+  // A node of the trie, for a segment of the URLs.
+  struct Node {
+    SegmentType type = SegmentType::kLiteral;
+
+    // The lower-cased segment of a literal node.
+    std::string literal;
+
+    // The literal children sorted by |literal|.
+    std::vector<std::unique_ptr<Node>> literals;
+
+    // The parameter children, kInt before kString.
+    std::vector<std::unique_ptr<Node>> params;
+
+    std::unique_ptr<Node> wildcard;
+
+    // The indexes of the routes ending at this node, in the order routed.
+    std::vector<std::size_t> routes;
   };
 
+  // Get the bit of a common method, or 0 for the others.
+  static unsigned MethodBit(const std::string& method);
+
+  static bool MatchMethod(const RouteInfo& route, const std::string& method,
+                          unsigned method_bit);
+
+  // Add the route of index |route| to the trie.
+  bool AddToTrie(const std::string& url, std::size_t route);
+
+  // Find the route of the method and the URL, and get the URL arguments if
+  // |args| is not null.
+  const RouteInfo* Match(const std::string& method, const std::string& url,
+                         UrlArgs* args) const;
+
+  // Match the segments in |rest| (the URL after a "/") from |node|.
+  const RouteInfo* MatchNode(const Node& node, boost::string_view rest,
+                             const std::string& method, unsigned method_bit,
+                             UrlArgs* args) const;
+
+  // Match the rest segments after the segment of |node|.
+  const RouteInfo* MatchChild(const Node& node, boost::string_view rest,
+                              std::size_t slash, const std::string& method,
+                              unsigned method_bit, UrlArgs* args) const;
+
+  // Get the first route ending at |node| which allows the method.
+  const RouteInfo* FindRoute(const Node& node, const std::string& method,
+                             unsigned method_bit) const;
+
   // Route table.
   std::vector<RouteInfo> routes_;
+
+  // The trie of the plain URLs, the root is for the leading "/".
+  Node root_;
+
+  // The indexes of the routes of regular expressions.
+  std::vector<std::size_t> regex_routes_;
 };
 
 }  // namespace webcc
@@ -0,0 +1,286 @@
+#include "webcc/search.h"
+
+#include <cstring>
+
+// SSE2 is always available on x64 (and enabled by -msse2 on x86).
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define WEBCC_SEARCH_SSE2 1
+#include <emmintrin.h>
+#else
+#define WEBCC_SEARCH_SSE2 0
+#endif
+
+// AVX2 is compiled for the functions with the target attribute (GCC and
+// Clang), so the library itself doesn't require an AVX2 CPU.
+#if WEBCC_SEARCH_SSE2 && defined(__GNUC__)
+#define WEBCC_SEARCH_AVX2 1
+#include <immintrin.h>
+#define WEBCC_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define WEBCC_SEARCH_AVX2 0
+#endif
+
+namespace webcc {
+namespace search {
+
+namespace {
+
+// Index of the lowest set bit of a non-zero mask.
+inline int LowestBit(unsigned mask) {
+#if defined(__GNUC__)
+  return __builtin_ctz(mask);
+#else
+  int i = 0;
+  for (; (mask & 1) == 0; mask >>= 1) {
+    ++i;
+  }
+  return i;
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// Scalar (i.e., portable) implementations, also for the tails of the data
+// which are too short for the SIMD blocks.
+
+// The single character search is left to memchr() at all the levels, which is
+// vectorized by the C library already (and faster than the kernels below on
+// the CPUs with AVX-512).
+const char* FindCharScalar(const char* begin, const char* end, char c) {
+  if (begin >= end) {
+    return nullptr;
+  }
+  return static_cast<const char*>(std::memchr(begin, c, end - begin));
+}
+
+const char* FindCRLFScalar(const char* begin, const char* end) {
+  while (begin < end) {
+    const char* cr = FindCharScalar(begin, end, '\r');
+    if (cr == nullptr || cr + 1 >= end) {
+      return nullptr;
+    }
+    if (cr[1] == '\n') {
+      return cr;
+    }
+    begin = cr + 1;
+  }
+  return nullptr;
+}
+
+const char* FindScalar(const char* begin, const char* end, const char* needle,
+                       std::size_t size) {
+  if (static_cast<std::size_t>(end - begin) < size) {
+    return nullptr;
+  }
+
+  // The last position the needle could start at.
+  const char* last = end - size;
+
+  while (begin <= last) {
+    const char* p = FindCharScalar(begin, last + 1, needle[0]);
+    if (p == nullptr) {
+      return nullptr;
+    }
+    if (std::memcmp(p + 1, needle + 1, size - 1) == 0) {
+      return p;
+    }
+    begin = p + 1;
+  }
+  return nullptr;
+}
+
+// -----------------------------------------------------------------------------
+
+#if WEBCC_SEARCH_SSE2
+
+const char* FindCRLFSse2(const char* begin, const char* end) {
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+
+  // Match CR at i and LF at i + 1 at the same time, so a lone CR (e.g., in
+  // binary data) doesn't stop the block loop.
+  for (; end - begin >= 17; begin += 16) {
+    __m128i block1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    __m128i block2 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin + 1));
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpeq_epi8(block1, cr), _mm_cmpeq_epi8(block2, lf))));
+    if (mask != 0) {
+      return begin + LowestBit(mask);
+    }
+  }
+
+  return FindCRLFScalar(begin, end);
+}
+
+// Compare the first and the last bytes of the needle with 16 positions at a
+// time, and the whole needle only at the positions both match. See:
+//   http://0x80.pl/articles/simd-strfind.html
+const char* FindSse2(const char* begin, const char* end, const char* needle,
+                     std::size_t size) {
+  if (size == 1) {
+    return FindCharScalar(begin, end, needle[0]);
+  }
+
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i last = _mm_set1_epi8(needle[size - 1]);
+
+  for (; end - begin >= static_cast<std::ptrdiff_t>(size + 15); begin += 16) {
+    __m128i block1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    __m128i block2 = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(begin + size - 1));
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpeq_epi8(block1, first), _mm_cmpeq_epi8(block2, last))));
+
+    while (mask != 0) {
+      int i = LowestBit(mask);
+      if (std::memcmp(begin + i + 1, needle + 1, size - 2) == 0) {
+        return begin + i;
+      }
+      mask &= mask - 1;
+    }
+  }
+
+  return FindScalar(begin, end, needle, size);
+}
+
+#endif  // WEBCC_SEARCH_SSE2
+
+// -----------------------------------------------------------------------------
+
+#if WEBCC_SEARCH_AVX2
+
+WEBCC_TARGET_AVX2
+const char* FindCRLFAvx2(const char* begin, const char* end) {
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i lf = _mm256_set1_epi8('\n');
+
+  for (; end - begin >= 33; begin += 32) {
+    __m256i block1 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+    __m256i block2 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin + 1));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(block1, cr),
+                         _mm256_cmpeq_epi8(block2, lf))));
+    if (mask != 0) {
+      return begin + LowestBit(mask);
+    }
+  }
+
+  return FindCRLFSse2(begin, end);
+}
+
+WEBCC_TARGET_AVX2
+const char* FindAvx2(const char* begin, const char* end, const char* needle,
+                     std::size_t size) {
+  if (size == 1) {
+    return FindCharScalar(begin, end, needle[0]);
+  }
+
+  const __m256i first = _mm256_set1_epi8(needle[0]);
+  const __m256i last = _mm256_set1_epi8(needle[size - 1]);
+
+  for (; end - begin >= static_cast<std::ptrdiff_t>(size + 31); begin += 32) {
+    __m256i block1 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+    __m256i block2 = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(begin + size - 1));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(block1, first),
+                         _mm256_cmpeq_epi8(block2, last))));
+
+    while (mask != 0) {
+      int i = LowestBit(mask);
+      if (std::memcmp(begin + i + 1, needle + 1, size - 2) == 0) {
+        return begin + i;
+      }
+      mask &= mask - 1;
+    }
+  }
+
+  return FindSse2(begin, end, needle, size);
+}
+
+#endif  // WEBCC_SEARCH_AVX2
+
+// -----------------------------------------------------------------------------
+
+struct Kernels {
+  Level level;
+  const char* (*find_crlf)(const char*, const char*);
+  const char* (*find)(const char*, const char*, const char*, std::size_t);
+};
+
+Kernels MakeKernels(Level level) {
+  switch (level) {
+#if WEBCC_SEARCH_AVX2
+    case Level::kAvx2:
+      return { level, &FindCRLFAvx2, &FindAvx2 };
+#endif
+#if WEBCC_SEARCH_SSE2
+    case Level::kSse2:
+      return { level, &FindCRLFSse2, &FindSse2 };
+#endif
+    default:
+      return { Level::kScalar, &FindCRLFScalar, &FindScalar };
+  }
+}
+
+Kernels& GetKernels() {
+  static Kernels kernels = MakeKernels(SupportedLevel());
+  return kernels;
+}
+
+}  // namespace
+
+Level SupportedLevel() {
+#if WEBCC_SEARCH_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    return Level::kAvx2;
+  }
+#endif
+#if WEBCC_SEARCH_SSE2
+  return Level::kSse2;
+#else
+  return Level::kScalar;
+#endif
+}
+
+Level GetLevel() {
+  return GetKernels().level;
+}
+
+bool SetLevel(Level level) {
+  if (level > SupportedLevel()) {
+    return false;
+  }
+  GetKernels() = MakeKernels(level);
+  return true;
+}
+
+const char* LevelName(Level level) {
+  switch (level) {
+    case Level::kAvx2:
+      return "avx2";
+    case Level::kSse2:
+      return "sse2";
+    default:
+      return "scalar";
+  }
+}
+
+const char* FindChar(const char* begin, const char* end, char c) {
+  return FindCharScalar(begin, end, c);
+}
+
+const char* FindCRLF(const char* begin, const char* end) {
+  return GetKernels().find_crlf(begin, end);
+}
+
+const char* Find(const char* begin, const char* end, const char* needle,
+                 std::size_t size) {
+  return GetKernels().find(begin, end, needle, size);
+}
+
+}  // namespace search
+}  // namespace webcc
@@ -0,0 +1,52 @@
+#ifndef WEBCC_SEARCH_H_
+#define WEBCC_SEARCH_H_
+
+#include <cstddef>
+
+namespace webcc {
+namespace search {
+
+// Searching the delimiters (CRLF, colon, multipart boundary) in the received
+// data, which is the hot loop of the parser.
+// The searches of multi-byte delimiters are implemented with SSE2 and AVX2
+// (x86/x64) besides the plain scalar code, and the best one supported by the
+// CPU is selected at runtime. They match the first and the last bytes of the
+// delimiter at 16 or 32 positions at a time, instead of stopping at every
+// occurrence of the first byte.
+
+enum class Level {
+  kScalar,
+  kSse2,
+  kAvx2,
+};
+
+// The best level supported by the CPU (and the compiler).
+Level SupportedLevel();
+
+// The level in use, SupportedLevel() by default.
+Level GetLevel();
+
+// Use another level, e.g., to compare the implementations in the tests or
+// benchmarks. Return false if the level is not supported.
+// Not thread safe, call it before any search.
+bool SetLevel(Level level);
+
+// Get the name of the level, e.g., "avx2".
+const char* LevelName(Level level);
+
+// Find the first |c| in [begin, end), return null if not found.
+// It's always memchr(), which is vectorized by the C library.
+const char* FindChar(const char* begin, const char* end, char c);
+
+// Find the first CRLF in [begin, end), return null if not found.
+const char* FindCRLF(const char* begin, const char* end);
+
+// Find the first occurrence of |needle| (of |size| > 0 bytes) in [begin, end),
+// return null if not found.
+const char* Find(const char* begin, const char* end, const char* needle,
+                 std::size_t size);
+
+}  // namespace search
+}  // namespace webcc
+
+#endif  // WEBCC_SEARCH_H_
@@ -3,6 +3,10 @@
 #include <csignal>
 #include <utility>
 
+#include "boost/algorithm/string.hpp"
+#include "boost/asio/post.hpp"
+#include "boost/asio/strand.hpp"
+#include "boost/version.hpp"
 #include "boost/filesystem/fstream.hpp"
 #include "boost/filesystem/operations.hpp"
 
@@ -12,20 +16,114 @@
 #include "webcc/response.h"
 #include "webcc/utility.h"
 
+#if WEBCC_ENABLE_GZIP
+#include "webcc/gzip.h"
+#endif
+
 namespace bfs = boost::filesystem;
 
 using tcp = boost::asio::ip::tcp;
 
 namespace webcc {
 
+namespace {
+
+// Check if the entity tag matches any in the list of If-None-Match.
+// The weak comparison is used, see:
+//   https://tools.ietf.org/html/rfc7232#section-3.2
+bool MatchETag(const std::string& list, const std::string& etag) {
+  if (boost::trim_copy(list) == "*") {
+    return true;
+  }
+
+  std::vector<std::string> tags;
+  boost::split(tags, list, boost::is_any_of(","));
+
+  for (std::string& tag : tags) {
+    boost::trim(tag);
+    if (boost::starts_with(tag, "W/")) {
+      tag.erase(0, 2);
+    }
+    if (tag == etag) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Evaluate the conditional headers of the request against the file.
+// If-Modified-Since is ignored if If-None-Match is present, see:
+//   https://tools.ietf.org/html/rfc7232#section-6
+bool IsNotModified(const Request& request, const StaticFile& file) {
+  bool existed = false;
+
+  const std::string& if_none_match =
+      request.GetHeader(HeaderId::kIfNoneMatch, &existed);
+  if (existed) {
+    return MatchETag(if_none_match, file.etag);
+  }
+
+  const std::string& if_modified_since =
+      request.GetHeader(HeaderId::kIfModifiedSince, &existed);
+  if (existed) {
+    std::time_t since = 0;
+    if (utility::ParseHttpDate(if_modified_since, &since)) {
+      return file.mtime <= since;
+    }
+  }
+
+  return false;
+}
+
+// Check the If-Range header, the Range header should be ignored if the file
+// has been changed, see:
+//   https://tools.ietf.org/html/rfc7233#section-3.2
+bool MatchIfRange(const Request& request, const StaticFile& file) {
+  bool existed = false;
+
+  const std::string& if_range = request.GetHeader(HeaderId::kIfRange, &existed);
+  if (!existed) {
+    return true;
+  }
+
+  // The strong comparison is used for the entity tag.
+  if (boost::starts_with(if_range, "\"") ||
+      boost::starts_with(if_range, "W/")) {
+    return if_range == file.etag;
+  }
+
+  std::time_t date = 0;
+  return utility::ParseHttpDate(if_range, &date) && date == file.mtime;
+}
+
+}  // namespace
+
+#if defined(SO_REUSEPORT)
+// Asio doesn't provide SO_REUSEPORT as a socket option.
+using so_reuse_port = boost::asio::detail::socket_option::boolean<SOL_SOCKET,
+                                                                  SO_REUSEPORT>;
+#endif
+
 Server::Server(std::uint16_t port, const Path& doc_root)
-    : port_(port), doc_root_(doc_root), file_chunk_size_(1024), running_(false),
-      acceptor_(io_context_), signals_(io_context_) {
+    : port_(port), doc_root_(doc_root), file_chunk_size_(1024),
+      precompressed_(false), running_(false), sharded_(false),
+      acceptor_(io_context_),
+      timer_wheel_(std::make_shared<TimerWheel>(io_context_)),
+      signals_(io_context_) {
   AddSignals();
 }
 
 void Server::Run(std::size_t workers, std::size_t loops) {
   assert(workers > 0);
+  assert(loops > 0);
+
+#if !defined(SO_REUSEPORT)
+  if (sharded_) {
+    LOG_WARN("SO_REUSEPORT is not supported, fall back to the shared mode.");
+    sharded_ = false;
+  }
+#endif
 
   {
     std::lock_guard<std::mutex> lock(state_mutex_);
@@ -40,21 +138,42 @@ void Server::Run(std::size_t workers, std::size_t loops) {
     running_ = true;
     io_context_.restart();
 
-    if (!Listen(port_)) {
-      LOG_ERRO("Server is NOT going to run.");
-      return;
+    // The shards of the last run are kept until now so that the responses
+    // posted to them late (see AsyncView) are simply dropped.
+    shards_.clear();
+
+    if (sharded_) {
+      for (std::size_t i = 0; i < loops; ++i) {
+        shards_.emplace_back(new Shard{});
+
+        if (!Listen(shards_.back()->acceptor, port_, true)) {
+          LOG_ERRO("Server is NOT going to run.");
+          shards_.clear();
+          return;
+        }
+      }
+    } else {
+      if (!Listen(acceptor_, port_)) {
+        LOG_ERRO("Server is NOT going to run.");
+        return;
+      }
     }
 
     LOG_INFO("Server is going to run...");
 
     AsyncWaitSignals();
 
-    AsyncAccept();
-
-    // Create worker threads.
-    for (std::size_t i = 0; i < workers; ++i) {
-      worker_threads_.emplace_back(std::bind(&Server::WorkerRoutine, this));
+    if (sharded_) {
+      for (auto& shard : shards_) {
+        shard->timer_wheel->Start();
+        AsyncAccept(shard->acceptor, shard->pool, shard->timer_wheel);
+      }
+    } else {
+      timer_wheel_->Start();
+      AsyncAccept(acceptor_, pool_, timer_wheel_);
     }
+
+    StartWorkers(workers);
   }
 
   // Start the event loop.
@@ -63,6 +182,108 @@ void Server::Run(std::size_t workers, std::size_t loops) {
   // asynchronous operation outstanding: the asynchronous accept call waiting
   // for new incoming connections.
 
+  if (sharded_) {
+    RunSharded();
+  } else {
+    RunShared(loops);
+  }
+}
+
+void Server::Stop() {
+  std::lock_guard<std::mutex> lock(state_mutex_);
+
+  DoStop();
+}
+
+#if WEBCC_ENABLE_GZIP
+
+std::size_t Server::PrecompressStatic(std::size_t min_size, int level) {
+  if (doc_root_.empty()) {
+    return 0;
+  }
+
+  std::size_t count = 0;
+
+  boost::system::error_code ec;
+  bfs::recursive_directory_iterator it(doc_root_, ec);
+  bfs::recursive_directory_iterator end;
+
+  for (; !ec && it != end; it.increment(ec)) {
+    const Path& path = it->path();
+
+    if (!bfs::is_regular_file(it->status())) {
+      continue;
+    }
+
+    std::string extension = path.extension().string();
+    if (extension == ".gz" || extension == ".br") {
+      continue;
+    }
+
+    boost::system::error_code file_ec;
+    if (bfs::file_size(path, file_ec) <= min_size || file_ec) {
+      continue;
+    }
+
+    Path sidecar = path;
+    sidecar += ".gz";
+
+    if (bfs::exists(sidecar, file_ec) &&
+        bfs::last_write_time(sidecar, file_ec) >=
+            bfs::last_write_time(path, file_ec)) {
+      continue;  // Up to date
+    }
+
+    std::string data;
+    std::string compressed;
+    if (!utility::ReadFile(path, &data) ||
+        !gzip::Compress(data, &compressed, level)) {
+      LOG_WARN("Failed to compress the file: %s.", path.string().c_str());
+      continue;
+    }
+
+    if (compressed.size() >= data.size()) {
+      continue;  // Not compressible, e.g., an image.
+    }
+
+    // Write to a temporary file then rename, so a partial sidecar is never
+    // served.
+    Path temp = sidecar;
+    temp += ".tmp";
+    {
+      bfs::ofstream ofs(temp, std::ios::binary);
+      ofs.write(compressed.data(), compressed.size());
+      if (!ofs) {
+        LOG_WARN("Failed to write the file: %s.", temp.string().c_str());
+        continue;
+      }
+    }
+
+    bfs::rename(temp, sidecar, file_ec);
+    if (file_ec) {
+      LOG_WARN("Failed to rename the file: %s.", temp.string().c_str());
+      bfs::remove(temp, file_ec);
+      continue;
+    }
+
+    ++count;
+  }
+
+  if (ec) {
+    LOG_WARN("Failed to iterate the doc root: %s.", ec.message().c_str());
+  }
+
+  LOG_INFO("%u static files precompressed.", static_cast<unsigned>(count));
+  return count;
+}
+
+#endif  // WEBCC_ENABLE_GZIP
+
+bool Server::IsRunning() const {
+  return running_ && !io_context_.stopped();
+}
+
+void Server::RunShared(std::size_t loops) {
   LOG_INFO("Loop is running in %u thread(s).", loops);
 
   if (loops == 1) {
@@ -78,16 +299,30 @@ void Server::Run(std::size_t workers, std::size_t loops) {
       loop_threads[i].join();
     }
   }
+
+  timer_wheel_->Stop();
 }
 
-void Server::Stop() {
-  std::lock_guard<std::mutex> lock(state_mutex_);
+void Server::RunSharded() {
+  LOG_INFO("Loop is running in %zu shard(s).", shards_.size());
 
-  DoStop();
-}
+  std::vector<std::thread> loop_threads;
+  for (auto& shard : shards_) {
+    loop_threads.emplace_back(&boost::asio::io_context::run,
+                              &shard->io_context);
+  }
 
-bool Server::IsRunning() const {
-  return running_ && !io_context_.stopped();
+  // The signals are still served by the main io_context in current thread.
+  io_context_.run();
+
+  // Join the threads for blocking.
+  for (auto& t : loop_threads) {
+    t.join();
+  }
+
+  for (auto& shard : shards_) {
+    shard->timer_wheel->Stop();
+  }
 }
 
 void Server::AddSignals() {
@@ -111,13 +346,14 @@ void Server::AsyncWaitSignals() {
       });
 }
 
-bool Server::Listen(std::uint16_t port) {
+bool Server::Listen(tcp::acceptor& acceptor, std::uint16_t port,
+                    bool reuse_port) {
   boost::system::error_code ec;
 
   tcp::endpoint endpoint(tcp::v4(), port);
 
   // Open the acceptor.
-  acceptor_.open(endpoint.protocol(), ec);
+  acceptor.open(endpoint.protocol(), ec);
   if (ec) {
     LOG_ERRO("Acceptor open error (%s).", ec.message().c_str());
     return false;
@@ -129,10 +365,23 @@ bool Server::Listen(std::uint16_t port) {
   // More details:
   // - https://stackoverflow.com/a/3233022
   // - http://www.andy-pearce.com/blog/posts/2013/Feb/so_reuseaddr-on-windows/
-  acceptor_.set_option(tcp::acceptor::reuse_address(true));
+  acceptor.set_option(tcp::acceptor::reuse_address(true));
+
+#if defined(SO_REUSEPORT)
+  // Set option SO_REUSEPORT on if necessary.
+  // With SO_REUSEPORT, each shard binds its own acceptor to the same port and
+  // the kernel balances the incoming connections among them.
+  if (reuse_port) {
+    acceptor.set_option(so_reuse_port(true), ec);
+    if (ec) {
+      LOG_ERRO("Acceptor set SO_REUSEPORT error (%s).", ec.message().c_str());
+      return false;
+    }
+  }
+#endif
 
   // Bind to the server address.
-  acceptor_.bind(endpoint, ec);
+  acceptor.bind(endpoint, ec);
   if (ec) {
     LOG_ERRO("Acceptor bind error (%s).", ec.message().c_str());
     return false;
@@ -141,7 +390,7 @@ bool Server::Listen(std::uint16_t port) {
   // Start listening for connections.
   // After listen, the client is able to connect to the server even the server
   // has not started to accept the connection yet.
-  acceptor_.listen(boost::asio::socket_base::max_listen_connections, ec);
+  acceptor.listen(boost::asio::socket_base::max_listen_connections, ec);
   if (ec) {
     LOG_ERRO("Acceptor listen error (%s).", ec.message().c_str());
     return false;
@@ -150,50 +399,95 @@ bool Server::Listen(std::uint16_t port) {
   return true;
 }
 
-void Server::AsyncAccept() {
-  acceptor_.async_accept(
-      [this](boost::system::error_code ec, tcp::socket socket) {
-        // Check whether the server was stopped by a signal before this
-        // completion handler had a chance to run.
-        if (!acceptor_.is_open()) {
+void Server::AsyncAccept(tcp::acceptor& acceptor, ConnectionPool& pool,
+                         TimerWheelPtr timer_wheel) {
+  auto on_accept =
+      [this, &acceptor, &pool, timer_wheel](boost::system::error_code ec,
+                                            tcp::socket socket) {
+        // Check whether the server was stopped (by a signal or from another
+        // thread) before this completion handler had a chance to run.
+        if (!running_ || !acceptor.is_open()) {
           return;
         }
 
         if (!ec) {
           LOG_INFO("Accepted a connection.");
 
-          using namespace std::placeholders;
-          auto view_matcher = std::bind(&Server::MatchViewOrStatic, this, _1,
-                                        _2, _3);
+          // Disable Nagle's algorithm. Otherwise, the responses of pipelined
+          // requests, each written separately, would be held back until the
+          // client acknowledges the previous one, which could be delayed.
+          boost::system::error_code no_delay_ec;
+          socket.set_option(tcp::no_delay(true), no_delay_ec);
+
+          // Reuse a released connection, with its buffers, if any.
+          ConnectionPtr connection = pool.Reuse(socket);
 
-          auto connection = std::make_shared<Connection>(
-              std::move(socket), &pool_, &queue_, std::move(view_matcher));
+          if (!connection) {
+            using namespace std::placeholders;
+            auto view_matcher =
+                std::bind(&Server::MatchViewOrStatic, this, _1, _2, _3);
+            auto handler = std::bind(&Server::Handle, this, _1);
 
-          pool_.Start(connection);
+            connection = pool.Adopt(new Connection(
+                std::move(socket), &pool, &queue_, std::move(view_matcher),
+                std::move(handler), timer_wheel, &settings_));
+          }
+
+          pool.Start(connection);
         }
 
-        AsyncAccept();
-      });
+        AsyncAccept(acceptor, pool, timer_wheel);
+      };
+
+#if BOOST_VERSION >= 107000
+  // Accept the socket on a strand of its own, so that the handlers of a
+  // connection, including the timeouts posted by the timer wheel, are never
+  // called concurrently when the loop runs in multiple threads.
+  acceptor.async_accept(boost::asio::make_strand(acceptor.get_executor()),
+                        std::move(on_accept));
+#else
+  acceptor.async_accept(std::move(on_accept));
+#endif
 }
 
 void Server::DoStop() {
+  running_ = false;
+
   // Stop accepting new connections.
+  // The acceptor of a shard belongs to the loop thread of the shard, close it
+  // in that thread instead of racing with the pending accept there.
   acceptor_.close();
+  for (auto& shard : shards_) {
+    Shard* s = shard.get();
+    boost::asio::post(s->io_context, [s]() { s->acceptor.close(); });
+  }
 
   // Stop worker threads.
   // This might take some time if the threads are still processing.
   StopWorkers();
 
   // Close all pending connections.
+  // Also in the loop threads of the shards, which are stopped right after.
   pool_.Clear();
+  for (auto& shard : shards_) {
+    Shard* s = shard.get();
+    boost::asio::post(s->io_context, [s]() {
+      s->pool.Clear();
+      s->io_context.stop();
+    });
+  }
 
   // Finally, stop the event processing loop.
   // This function does not block, but instead simply signals the io_context to
   // stop. All invocations of its run() or run_one() member functions should
   // return as soon as possible.
   io_context_.stop();
+}
 
-  running_ = false;
+void Server::StartWorkers(std::size_t workers) {
+  for (std::size_t i = 0; i < workers; ++i) {
+    worker_threads_.emplace_back(std::bind(&Server::WorkerRoutine, this));
+  }
 }
 
 void Server::WorkerRoutine() {
@@ -253,8 +547,8 @@ void Server::Handle(ConnectionPtr connection) {
   const Url& url = request->url();
   LOG_INFO("Request URL path: %s", url.path().c_str());
 
-  UrlArgs args;
-  auto view = FindView(request->method(), url.path(), &args);
+  // The view (and the URL args) has been matched when the headers ended.
+  const ViewPtr& view = request->view();
 
   if (!view) {
     LOG_WARN("No view matches the request: %s %s", request->method().c_str(),
@@ -276,8 +570,12 @@ void Server::Handle(ConnectionPtr connection) {
     return;
   }
 
-  // Save the (regex matched) URL args to request object.
-  request->set_args(args);
+  // Let the async view send the response whenever it's ready.
+  auto async_view = std::dynamic_pointer_cast<AsyncView>(view);
+  if (async_view) {
+    async_view->AsyncHandle(request, connection->MakeResponder());
+    return;
+  }
 
   // Ask the matched view to process the request.
   ResponsePtr response = view->Handle(request);
@@ -290,16 +588,21 @@ void Server::Handle(ConnectionPtr connection) {
   }
 }
 
-bool Server::MatchViewOrStatic(const std::string& method,
-                               const std::string& url, bool* stream) {
-  if (Router::MatchView(method, url, stream)) {
+bool Server::MatchViewOrStatic(Request* request, bool* stream,
+                               bool* non_blocking) {
+  if (Router::MatchView(request, stream, non_blocking)) {
     return true;
   }
 
   // Try to match a static file.
-  if (method == methods::kGet && !doc_root_.empty()) {
-    Path path = doc_root_ / url;
-    if (!bfs::is_directory(path) && bfs::exists(path)) {
+  if (request->method() == methods::kGet && !doc_root_.empty()) {
+    Path path = doc_root_ / request->url().path();
+
+    // Stat the file (unless it's cached) only once, here. The data is not
+    // loaded in the loop thread but when the request is handled.
+    auto file = file_cache_.Match(path);
+    if (file) {
+      request->set_static_file(std::move(file));
       return true;
     }
   }
@@ -317,24 +620,176 @@ ResponsePtr Server::ServeStatic(RequestPtr request) {
 
   Path path = doc_root_ / request->url().path();
 
-  try {
-    // NOTE: FileBody might throw Error::kFileError.
-    auto body = std::make_shared<FileBody>(path, file_chunk_size_);
+  // Reuse the file matched with the request, if any, and load its data only
+  // if it's to be cached.
+  StaticFilePtr file = request->static_file();
+  if (file) {
+    file = file_cache_.Load(path, file);
+  } else {
+    file = file_cache_.Get(path);
+  }
+  if (!file) {
+    LOG_WARN("No such static file: %s.", path.string().c_str());
+    return {};
+  }
 
-    auto response = std::make_shared<Response>(Status::kOK);
+  if (!precompressed_) {
+    return ServeFile(*request, path, *file);
+  }
 
-    std::string extension = path.extension().string();
-    response->SetContentType(media_types::FromExtension(extension), "");
+  // The content coding of the file served, empty for the original file.
+  std::string encoding;
+  file = FindPrecompressed(*request, file, &path, &encoding);
 
-    // NOTE: Gzip compression is not supported.
-    response->SetBody(body, true);
+  auto response = ServeFile(*request, path, *file);
+  if (response) {
+    // The response varies with Accept-Encoding no matter which file is served.
+    response->SetHeader(headers::kVary, headers::kAcceptEncoding);
 
+    int status = response->status();
+    if (!encoding.empty() &&
+        (status == Status::kOK || status == Status::kPartialContent)) {
+      response->SetHeader(headers::kContentEncoding, encoding);
+    }
+  }
+  return response;
+}
+
+StaticFilePtr Server::FindPrecompressed(const Request& request,
+                                        StaticFilePtr file, Path* path,
+                                        std::string* encoding) {
+  // The content coding and the extension of the sidecars, by preference.
+  static const std::pair<const char*, const char*> kSidecars[] = {
+    { "br", ".br" },
+    { "gzip", ".gz" },
+  };
+
+  for (auto& sidecar : kSidecars) {
+    if (!request.AcceptEncoding(sidecar.first)) {
+      continue;
+    }
+
+    Path sidecar_path = *path;
+    sidecar_path += sidecar.second;
+
+    auto sidecar_file = file_cache_.Get(sidecar_path);
+
+    // Ignore the sidecar older than the original file, it might be stale.
+    if (!sidecar_file || sidecar_file->mtime < file->mtime) {
+      continue;
+    }
+
+    // Serve the sidecar as the original file but encoded.
+    auto encoded = std::make_shared<StaticFile>(*sidecar_file);
+    encoded->media_type = file->media_type;
+
+    *path = sidecar_path;
+    *encoding = sidecar.first;
+    return encoded;
+  }
+
+  return file;
+}
+
+ResponsePtr Server::ServeFile(const Request& request, const Path& path,
+                              const StaticFile& file) {
+  if (IsNotModified(request, file)) {
+    auto response = std::make_shared<Response>(Status::kNotModified);
+    response->SetHeader(headers::kETag, file.etag);
+    response->SetHeader(headers::kLastModified, file.last_modified);
     return response;
+  }
+
+  bool existed = false;
+  const std::string& range = request.GetHeader(HeaderId::kRange, &existed);
+  if (existed && MatchIfRange(request, file)) {
+    Range parsed_range(range, file.size);
+    if (parsed_range.valid()) {
+      return ServeRanges(path, file, parsed_range);
+    }
+  }
+
+  BodyPtr body;
+
+  if (file.data) {
+    // Serve the cached data without copying it.
+    body = std::make_shared<SharedBody>(file.data);
+  } else {
+    try {
+      // NOTE: FileBody might throw Error::kFileError.
+      body = std::make_shared<FileBody>(path, file_chunk_size_);
+    } catch (const Error& error) {
+      LOG_ERRO("File error: %s.", error.message().c_str());
+      return {};
+    }
+  }
+
+  auto response = std::make_shared<Response>(Status::kOK);
+
+  response->SetContentType(file.media_type, "");
+  response->SetHeader(headers::kETag, file.etag);
+  response->SetHeader(headers::kLastModified, file.last_modified);
+  response->SetHeader(headers::kAcceptRanges, "bytes");
 
+  response->SetBody(body, true);
+
+  return response;
+}
+
+ResponsePtr Server::ServeRanges(const Path& path, const StaticFile& file,
+                                const Range& range) {
+  if (!range.satisfiable()) {
+    auto response = std::make_shared<Response>(Status::kRangeNotSatisfiable);
+    response->SetHeader(headers::kContentRange, Range::ContentRange(file.size));
+    response->SetBody(std::make_shared<Body>(), true);
+    return response;
+  }
+
+  auto response = std::make_shared<Response>(Status::kPartialContent);
+
+  const std::vector<ByteRange>& ranges = range.ranges();
+
+  BodyPtr body;
+
+  try {
+    if (ranges.size() == 1) {
+      const ByteRange& r = ranges.front();
+
+      if (file.data) {
+        body = std::make_shared<SharedBody>(file.data, r.first, r.length());
+      } else {
+        // NOTE: FileBody might throw Error::kFileError.
+        auto file_body = std::make_shared<FileBody>(path, file_chunk_size_);
+        file_body->SetRange(r.first, r.length());
+        body = file_body;
+      }
+
+      response->SetContentType(file.media_type, "");
+      response->SetHeader(headers::kContentRange,
+                          Range::ContentRange(r, file.size));
+
+    } else {
+      std::string boundary = utility::RandomUuid();
+
+      // NOTE: ByteRangesBody might throw Error::kFileError.
+      body = std::make_shared<ByteRangesBody>(path, file.size, ranges,
+                                              file.media_type, boundary,
+                                              file_chunk_size_);
+
+      response->SetContentType("multipart/byteranges; boundary=" + boundary);
+    }
   } catch (const Error& error) {
     LOG_ERRO("File error: %s.", error.message().c_str());
     return {};
   }
+
+  response->SetHeader(headers::kETag, file.etag);
+  response->SetHeader(headers::kLastModified, file.last_modified);
+  response->SetHeader(headers::kAcceptRanges, "bytes");
+
+  response->SetBody(body, true);
+
+  return response;
 }
 
 }  // namespace webcc
@@ -1,6 +1,8 @@
 #ifndef WEBCC_SERVER_H_
 #define WEBCC_SERVER_H_
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <thread>
 #include <vector>
@@ -11,10 +13,15 @@
 
 #include "webcc/connection.h"
 #include "webcc/connection_pool.h"
-#include "webcc/queue.h"
+#include "webcc/file_cache.h"
 #include "webcc/router.h"
+#include "webcc/timer_wheel.h"
 #include "webcc/url.h"
 
+#if WEBCC_ENABLE_GZIP
+#include "webcc/gzip.h"
+#endif
+
 namespace webcc {
 
 class Server : public Router {
@@ -31,6 +38,108 @@ public:
     file_chunk_size_ = file_chunk_size;
   }
 
+  // Set the timeout (seconds) of waiting for the next request on a keep-alive
+  // connection. 0 means no timeout. Default: 60.
+  // Must be called before Run(), so are the other connection settings.
+  void set_idle_timeout(int idle_timeout) {
+    settings_.idle_timeout = idle_timeout;
+  }
+
+  // Set the timeout (seconds) of reading the headers of a request, counted
+  // from the first byte of the request (or from the connection being
+  // accepted). It stops slow clients (e.g., slowloris) from holding the
+  // connections. 0 means no timeout. Default: 30.
+  void set_header_timeout(int header_timeout) {
+    settings_.header_timeout = header_timeout;
+  }
+
+  // Set the timeout (seconds) of waiting for the next piece of the body of a
+  // request. 0 means no timeout. Default: 60.
+  void set_body_timeout(int body_timeout) {
+    settings_.body_timeout = body_timeout;
+  }
+
+  // Set the max number of requests served on a connection. The connection
+  // will be closed after the response of the last request is sent.
+  // 0 means no limit. Default: 0.
+  void set_max_requests(std::size_t max_requests) {
+    settings_.max_requests = max_requests;
+  }
+
+  // Send the file bodies (e.g., the static files) with sendfile() or not.
+  // With sendfile(), a file is sent from the page cache straight to the socket
+  // instead of being read into the memory and written chunk by chunk (see
+  // set_file_chunk_size()). Only supported on Linux. Default: true.
+  void set_sendfile(bool sendfile) {
+    settings_.sendfile = sendfile;
+  }
+
+  // Share the read buffers among the connections or not.
+  // If true, a connection waits for the data without any read buffer, and
+  // takes a buffer from a pool only to read the data which has arrived. It
+  // saves the memory of the massive idle (keep-alive) connections, at the cost
+  // of a wait before each read. Default: false.
+  void set_pooled_read_buffers(bool pooled_read_buffers) {
+    settings_.pooled_read_buffers = pooled_read_buffers;
+  }
+
+  // Set the max ratio of the decompressed size to the compressed size of the
+  // content of a request. A request expanding further (e.g., a "zip bomb") is
+  // rejected. Only checked once the decompressed size exceeds 1MB.
+  // 0 means no limit. Default: kMaxDecompressionRatio (100).
+  void set_max_decompression_ratio(std::size_t max_decompression_ratio) {
+    settings_.max_decompression_ratio = max_decompression_ratio;
+  }
+
+  // Cache the static files in the memory, at most |capacity| bytes in total.
+  // The files larger than |max_file_size| are not cached.
+  // The cached files are served without touching the disk, and revalidated
+  // (by the mtime and size) at most once per second. 0 |capacity| disables
+  // the caching. Default: 0.
+  // Must be called before Run().
+  void set_file_cache(std::size_t capacity,
+                      std::size_t max_file_size = 1024 * 1024) {
+    file_cache_.set_capacity(capacity);
+    file_cache_.set_max_file_size(max_file_size);
+  }
+
+  // Serve the precompressed sidecar of a static file, i.e., "app.js.br" or
+  // "app.js.gz" for "app.js", with `Content-Encoding` if the client accepts
+  // the encoding. It costs no compression at the request time. The sidecars
+  // older than the original files are ignored.
+  // See also PrecompressStatic(). Default: false.
+  void set_precompressed(bool precompressed) {
+    precompressed_ = precompressed;
+  }
+
+#if WEBCC_ENABLE_GZIP
+
+  // Generate the missing (or stale) gzip sidecars (".gz") of the static files
+  // under the doc root for set_precompressed().
+  // The files not larger than |min_size|, or not getting smaller after the
+  // compression, are skipped.
+  // It's done once per file, so the best compression |level| is used by
+  // default.
+  // Return the number of the sidecars generated. It's blocking and should be
+  // called before Run().
+  std::size_t PrecompressStatic(std::size_t min_size = kGzipThreshold,
+                                int level = gzip::kBestCompression);
+
+#endif  // WEBCC_ENABLE_GZIP
+
+  // Run the loops in the sharded mode or not.
+  // In the sharded mode, each loop thread owns its own io_context, acceptor
+  // (bound to the same port with SO_REUSEPORT) and connection pool, so a
+  // connection lives its whole life on one loop and the loops share nothing
+  // but the worker queue. The kernel distributes the incoming connections
+  // among the acceptors.
+  // Only supported on the platforms with SO_REUSEPORT (e.g., Linux 3.9+),
+  // otherwise the server falls back to the shared mode.
+  // Must be called before Run().
+  void set_sharded(bool sharded) {
+    sharded_ = sharded;
+  }
+
   // Start and run the server.
   // This method is blocking so will not return until Stop() is called (from
   // another thread) or a signal like SIGINT is caught.
@@ -43,6 +152,8 @@ public:
   // Meanwhile, the (event) loop, i.e., io_context, is also running in a number
   // (|loops|) of threads. Normally, one thread for the loop is good enough, but
   // it could be more than that.
+  // In the sharded mode (see set_sharded()), each of the |loops| threads runs
+  // its own io_context instead of sharing a single one.
   void Run(std::size_t workers = 1, std::size_t loops = 1);
 
   // Stop the server.
@@ -53,6 +164,28 @@ public:
   bool IsRunning() const;
 
 private:
+  // A loop with its own io_context, acceptor, connection pool and timer
+  // wheel. Used in the sharded mode only.
+  struct Shard {
+    Shard()
+        : acceptor(io_context),
+          timer_wheel(std::make_shared<TimerWheel>(io_context)) {
+    }
+
+    boost::asio::io_context io_context;
+    boost::asio::ip::tcp::acceptor acceptor;
+    ConnectionPool pool;
+    TimerWheelPtr timer_wheel;
+  };
+
+  // Run the loops in the shared mode: all the loop threads run the same
+  // io_context.
+  void RunShared(std::size_t loops);
+
+  // Run the loops in the sharded mode: each loop thread runs its own shard.
+  // The shards (one per loop) must have been created.
+  void RunSharded();
+
   // Register signals which indicate when the server should exit.
   void AddSignals();
 
@@ -60,10 +193,18 @@ private:
   void AsyncWaitSignals();
 
   // Listen on the given port.
-  bool Listen(std::uint16_t port);
+  // If |reuse_port| is true, SO_REUSEPORT will be set so that multiple
+  // acceptors can be bound to the same port.
+  bool Listen(boost::asio::ip::tcp::acceptor& acceptor, std::uint16_t port,
+              bool reuse_port = false);
 
   // Accept connections asynchronously.
-  void AsyncAccept();
+  // The timeouts of the accepted connections are driven by the |timer_wheel|.
+  void AsyncAccept(boost::asio::ip::tcp::acceptor& acceptor,
+                   ConnectionPool& pool, TimerWheelPtr timer_wheel);
+
+  // Create worker threads.
+  void StartWorkers(std::size_t workers);
 
   // Stop acceptor and worker threads, close all pending connections, and
   // finally stop the event loop.
@@ -82,15 +223,35 @@ private:
   // request comes, this connection will be put back to the queue again.
   virtual void Handle(ConnectionPtr connection);
  
-  // Match the view by HTTP method and URL (path).
-  // Return if a view or static file is matched or not.
+  // Match the view by HTTP method and URL (path) when the headers of the
+  // request have been parsed.
+  // Return if a view or static file is matched or not. The matched view (or
+  // cached static file) is saved to the request for Handle().
   // If the view asks for data streaming, |stream| will be set to true.
-  bool MatchViewOrStatic(const std::string& method, const std::string& url,
-                         bool* stream);
+  // If the view is non-blocking, |non_blocking| will be set to true.
+  bool MatchViewOrStatic(Request* request, bool* stream, bool* non_blocking);
 
   // Serve static files from the doc root.
+  // Conditional requests (If-None-Match, If-Modified-Since) are answered with
+  // 304 Not Modified if the file is not modified.
+  // Range requests (with an optional If-Range) are answered with the ranges.
   ResponsePtr ServeStatic(RequestPtr request);
 
+  // Find the precompressed sidecar of the |file| acceptable to the |request|
+  // (see set_precompressed()). If found, update the |path| and |encoding| and
+  // return the sidecar, otherwise, return the |file| itself.
+  StaticFilePtr FindPrecompressed(const Request& request, StaticFilePtr file,
+                                  Path* path, std::string* encoding);
+
+  // Serve a static file (or its precompressed sidecar).
+  ResponsePtr ServeFile(const Request& request, const Path& path,
+                        const StaticFile& file);
+
+  // Serve the ranges of a static file (206 Partial Content), or 416 Range Not
+  // Satisfiable if none of the ranges is satisfiable.
+  ResponsePtr ServeRanges(const Path& path, const StaticFile& file,
+                          const Range& range);
+
 private:
   // Port number.
   std::uint16_t port_;
@@ -102,8 +263,19 @@ private:
   // static file.
   std::size_t file_chunk_size_;
 
+  // The cache of the static files.
+  FileCache file_cache_;
+
+  // Serve the precompressed sidecars of the static files or not.
+  bool precompressed_;
+
   // Is the server running?
-  bool running_;
+  // Atomic because the accept handlers check it while Stop() is called from
+  // another thread.
+  std::atomic<bool> running_;
+
+  // Run the loops in the sharded mode or not.
+  bool sharded_;
 
   // The mutex for guarding the state of the server.
   std::mutex state_mutex_;
@@ -117,6 +289,16 @@ private:
   // The connection pool which owns all live connections.
   ConnectionPool pool_;
 
+  // The timer wheel driving the timeouts of the connections.
+  TimerWheelPtr timer_wheel_;
+
+  // The settings of the connections.
+  ConnectionSettings settings_;
+
+  // The shards, one for each loop thread, in the sharded mode.
+  // In this mode, |io_context_| only serves the signals.
+  std::vector<std::unique_ptr<Shard>> shards_;
+
   // The signals for processing termination notifications.
   boost::asio::signal_set signals_;
 
@@ -124,7 +306,7 @@ private:
   std::vector<std::thread> worker_threads_;
 
   // The queue with connection waiting for the workers to process.
-  Queue<ConnectionPtr> queue_;
+  ConnectionQueue queue_;
 };
 
 }  // namespace webcc
@@ -0,0 +1,143 @@
+#include "webcc/timer_wheel.h"
+
+#include <cassert>
+
+namespace webcc {
+
+TimerWheel::TimerWheel(boost::asio::io_context& io_context,
+                       std::chrono::milliseconds tick, std::size_t slots)
+    : io_context_(io_context), tick_(tick), slots_(slots, nullptr),
+      current_(0), size_(0) {
+  assert(tick.count() > 0);
+  assert(slots > 0);
+}
+
+void TimerWheel::Start() {
+  timer_.reset(new boost::asio::steady_timer{ io_context_ });
+  timer_->expires_after(tick_);
+  AsyncWait();
+}
+
+void TimerWheel::Stop() {
+  timer_.reset();
+}
+
+void TimerWheel::Schedule(Timer* timer, std::chrono::milliseconds timeout) {
+  // Round up to ticks, at least one tick.
+  std::size_t ticks = static_cast<std::size_t>(
+      (timeout.count() + tick_.count() - 1) / tick_.count());
+  if (ticks == 0) {
+    ticks = 1;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (timer->scheduled_) {
+    Unlink(timer);
+  }
+
+  ++timer->generation_;
+
+  timer->slot_ = (current_ + ticks) % slots_.size();
+  timer->rounds_ = (ticks - 1) / slots_.size();
+
+  Link(timer);
+}
+
+void TimerWheel::Cancel(Timer* timer) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (timer->scheduled_) {
+    Unlink(timer);
+  }
+
+  ++timer->generation_;
+}
+
+bool TimerWheel::Expired(const Timer* timer, std::size_t generation) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return !timer->scheduled_ && timer->generation_ == generation;
+}
+
+std::size_t TimerWheel::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return size_;
+}
+
+void TimerWheel::Tick() {
+  // The callbacks are called after the lock is released because they might
+  // schedule or cancel timers. They are copied, with the generations of the
+  // timers, because the timers might be destroyed meanwhile.
+  std::vector<std::pair<Callback, std::size_t>> callbacks;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    current_ = (current_ + 1) % slots_.size();
+
+    Timer* timer = slots_[current_];
+    while (timer != nullptr) {
+      Timer* next = timer->next_;
+
+      if (timer->rounds_ > 0) {
+        --timer->rounds_;
+      } else {
+        Unlink(timer);
+        callbacks.emplace_back(timer->callback_, timer->generation_);
+      }
+
+      timer = next;
+    }
+  }
+
+  for (auto& callback : callbacks) {
+    callback.first(callback.second);
+  }
+}
+
+void TimerWheel::AsyncWait() {
+  timer_->async_wait([this](boost::system::error_code ec) {
+    if (ec || !timer_) {
+      return;
+    }
+
+    Tick();
+
+    // Based on the last expiry to avoid drifting.
+    timer_->expires_at(timer_->expiry() + tick_);
+    AsyncWait();
+  });
+}
+
+void TimerWheel::Link(Timer* timer) {
+  Timer*& head = slots_[timer->slot_];
+
+  timer->prev_ = nullptr;
+  timer->next_ = head;
+  if (head != nullptr) {
+    head->prev_ = timer;
+  }
+  head = timer;
+
+  timer->scheduled_ = true;
+  ++size_;
+}
+
+void TimerWheel::Unlink(Timer* timer) {
+  if (timer->prev_ != nullptr) {
+    timer->prev_->next_ = timer->next_;
+  } else {
+    slots_[timer->slot_] = timer->next_;
+  }
+
+  if (timer->next_ != nullptr) {
+    timer->next_->prev_ = timer->prev_;
+  }
+
+  timer->prev_ = nullptr;
+  timer->next_ = nullptr;
+  timer->scheduled_ = false;
+  --size_;
+}
+
+}  // namespace webcc
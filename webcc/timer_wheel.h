@@ -0,0 +1,133 @@
+#ifndef WEBCC_TIMER_WHEEL_H_
+#define WEBCC_TIMER_WHEEL_H_
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "boost/asio/io_context.hpp"
+#include "boost/asio/steady_timer.hpp"
+
+namespace webcc {
+
+// A hashed timing wheel for a large number of coarse-grained timeouts, e.g.,
+// the idle timeouts of the connections.
+// The timers are hashed into the slots of the wheel by their expiration tick
+// and the whole wheel is driven by a single steady_timer ticking in the
+// io_context. Scheduling, rescheduling and canceling a timer are O(1) and
+// never allocate, so a timer per connection costs almost nothing even with
+// 100k idle connections.
+// Firing the timers does allocate: the callbacks of the expired timers are
+// copied out under the lock and called after it, since the owners might
+// cancel, reschedule or destroy the timers meanwhile (e.g., from the other
+// threads). A callback could then be called for a timer which has just been
+// canceled or rescheduled, so it's given the generation of the timer to check
+// with Expired().
+// The timers expire at the granularity of the tick.
+class TimerWheel {
+public:
+  // The argument is the generation of the timer when it expired.
+  using Callback = std::function<void(std::size_t)>;
+
+  // A timer on the wheel.
+  // It's owned by the user and linked into the wheel (i.e., intrusive). It
+  // must be canceled before it's destroyed.
+  class Timer {
+  public:
+    // The |callback| is called in the io_context when the timer expires.
+    explicit Timer(Callback callback) : callback_(std::move(callback)) {
+    }
+
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+  private:
+    friend class TimerWheel;
+
+    Callback callback_;
+
+    // The links of the list in the slot.
+    Timer* prev_ = nullptr;
+    Timer* next_ = nullptr;
+
+    // The slot in which the timer is scheduled.
+    std::size_t slot_ = 0;
+
+    // The rounds of the wheel to wait before the timer expires.
+    std::size_t rounds_ = 0;
+
+    // Increased each time the timer is scheduled or canceled.
+    std::size_t generation_ = 0;
+
+    bool scheduled_ = false;
+  };
+
+  explicit TimerWheel(boost::asio::io_context& io_context,
+                      std::chrono::milliseconds tick = std::chrono::seconds(1),
+                      std::size_t slots = 512);
+
+  ~TimerWheel() = default;
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  // Start to tick in the io_context.
+  void Start();
+
+  // Stop ticking.
+  // It should be called when the io_context is not running.
+  void Stop();
+
+  // Schedule the timer to expire after |timeout| (rounded up to ticks).
+  // If the timer has already been scheduled, it will be rescheduled.
+  void Schedule(Timer* timer, std::chrono::milliseconds timeout);
+
+  // Cancel the timer if it's scheduled.
+  void Cancel(Timer* timer);
+
+  // Check if the timer is still the one which expired with the |generation|,
+  // i.e., it has not been scheduled or canceled since then.
+  bool Expired(const Timer* timer, std::size_t generation) const;
+
+  // Get the number of scheduled timers.
+  std::size_t Size() const;
+
+  // Advance the wheel by one tick and fire the expired timers.
+  // Normally, it's called by the steady_timer. Public for testing.
+  void Tick();
+
+private:
+  void AsyncWait();
+
+  void Link(Timer* timer);
+  void Unlink(Timer* timer);
+
+  boost::asio::io_context& io_context_;
+
+  std::chrono::milliseconds tick_;
+
+  // The steady_timer ticking the wheel, only available between Start() and
+  // Stop().
+  std::unique_ptr<boost::asio::steady_timer> timer_;
+
+  // The heads of the timer lists, one for each slot.
+  std::vector<Timer*> slots_;
+
+  // The slot of current tick.
+  std::size_t current_;
+
+  std::size_t size_;
+
+  // The mutex is necessary if the loop is running in multiple threads.
+  mutable std::mutex mutex_;
+};
+
+using TimerWheelPtr = std::shared_ptr<TimerWheel>;
+
+}  // namespace webcc
+
+#endif  // WEBCC_TIMER_WHEEL_H_
@@ -4,8 +4,6 @@
 #include <cctype>
 #include <functional>
 
-#include "boost/algorithm/string/trim.hpp"
-
 #include "webcc/utility.h"
 
 namespace webcc {
@@ -14,6 +12,11 @@ namespace webcc {
 
 namespace {
 
+// Assign a view to a component of the URL, reusing its memory.
+void Assign(boost::string_view str, std::string* component) {
+  component->assign(str.data(), str.size());
+}
+
 // Convert a hex character digit to a decimal character value.
 bool HexToDecimal(char hex, int* decimal) {
   if (hex >= '0' && hex <= '9') {
@@ -237,49 +240,52 @@ void Url::AppendQuery(const std::string& key, const std::string& value,
   }
 }
 
-void Url::Parse(const std::string& str) {
-  std::string tmp = boost::trim_left_copy(str);
+void Url::Parse(boost::string_view str) {
+  // The components are assigned from the views of |str|, so that the memory
+  // of the last URL is reused if any.
+  Clear();
 
-  std::size_t p = std::string::npos;
+  while (!str.empty() && std::isspace(static_cast<unsigned char>(str[0]))) {
+    str.remove_prefix(1);
+  }
 
-  p = tmp.find("://");
-  if (p != std::string::npos) {
-    scheme_ = tmp.substr(0, p);
-    tmp = tmp.substr(p + 3);
+  std::size_t p = str.find("://");
+  if (p != boost::string_view::npos) {
+    Assign(str.substr(0, p), &scheme_);
+    str.remove_prefix(p + 3);
   }
 
-  p = tmp.find('/');
-  if (p != std::string::npos) {
-    host_ = tmp.substr(0, p);
+  boost::string_view host;
 
-    tmp = tmp.substr(p);
+  p = str.find('/');
+  if (p != boost::string_view::npos) {
+    host = str.substr(0, p);
 
-    p = tmp.find('?');
-    if (p != std::string::npos) {
-      path_ = tmp.substr(0, p);
-      query_ = tmp.substr(p + 1);
+    str.remove_prefix(p);
+
+    p = str.find('?');
+    if (p != boost::string_view::npos) {
+      Assign(str.substr(0, p), &path_);
+      Assign(str.substr(p + 1), &query_);
     } else {
-      path_ = tmp;
+      Assign(str, &path_);
     }
   } else {
-    path_ = "";
-
-    p = tmp.find('?');
-    if (p != std::string::npos) {
-      host_ = tmp.substr(0, p);
-      query_ = tmp.substr(p + 1);
+    p = str.find('?');
+    if (p != boost::string_view::npos) {
+      host = str.substr(0, p);
+      Assign(str.substr(p + 1), &query_);
     } else {
-      host_ = tmp;
+      host = str;
     }
   }
 
-  if (!host_.empty()) {
-    p = host_.find(':');
-    if (p != std::string::npos) {
-      port_ = host_.substr(p + 1);
-      host_ = host_.substr(0, p);
-    }
+  p = host.find(':');
+  if (p != boost::string_view::npos) {
+    Assign(host.substr(p + 1), &port_);
+    host = host.substr(0, p);
   }
+  Assign(host, &host_);
 }
 
 void Url::Clear() {
@@ -6,6 +6,8 @@
 #include <utility>
 #include <vector>
 
+#include "boost/utility/string_view.hpp"
+
 #include "webcc/globals.h"
 
 namespace webcc {
@@ -86,9 +88,12 @@ public:
   void AppendQuery(const std::string& key, const std::string& value,
                    bool encode = false);
 
-private:
-  void Parse(const std::string& str);
+  // Parse the URL (not encoded), replacing all the components.
+  // The memory of the components is reused, e.g., by a request recycled for
+  // the next one on the same connection.
+  void Parse(boost::string_view str);
 
+  // Clear all the components, keeping their memory.
   void Clear();
 
 private:
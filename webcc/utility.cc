@@ -1,7 +1,8 @@
 #include "webcc/utility.h"
 
 #include <ctime>
-#include <iomanip>  // for put_time
+#include <iomanip>  // for put_time, get_time
+#include <locale>
 #include <sstream>
 
 #include "boost/algorithm/string.hpp"
@@ -29,12 +30,41 @@ const std::string& UserAgent() {
 }
 
 std::string GetTimestamp() {
-  std::time_t t = std::time(nullptr);
+  return FormatHttpDate(std::time(nullptr));
+}
+
+std::string FormatHttpDate(std::time_t t) {
+  std::tm tm{};
+#if defined(_WIN32)
+  gmtime_s(&tm, &t);
+#else
+  gmtime_r(&t, &tm);
+#endif
+
   std::stringstream ss;
-  ss << std::put_time(std::gmtime(&t), "%a, %d %b %Y %H:%M:%S") << " GMT";
+  ss.imbue(std::locale::classic());
+  ss << std::put_time(&tm, "%a, %d %b %Y %H:%M:%S") << " GMT";
   return ss.str();
 }
 
+bool ParseHttpDate(const std::string& str, std::time_t* t) {
+  std::tm tm{};
+
+  std::istringstream iss(str);
+  iss.imbue(std::locale::classic());
+  iss >> std::get_time(&tm, "%a, %d %b %Y %H:%M:%S GMT");
+  if (iss.fail()) {
+    return false;
+  }
+
+#if defined(_WIN32)
+  *t = _mkgmtime(&tm);
+#else
+  *t = timegm(&tm);
+#endif
+  return *t != -1;
+}
+
 bool SplitKV(const std::string& str, char delimiter, std::string* key,
              std::string* value, bool trim) {
   std::size_t pos = str.find(delimiter);
@@ -62,6 +92,66 @@ bool ToSize(const std::string& str, int base, std::size_t* size) {
   return true;
 }
 
+bool ToSize(boost::string_view str, std::size_t* size) {
+  if (str.empty()) {
+    return false;
+  }
+
+  std::size_t value = 0;
+  for (char c : str) {
+    if (c < '0' || c > '9') {
+      return false;
+    }
+
+    std::size_t digit = static_cast<std::size_t>(c - '0');
+    if (value > (kInvalidLength - 1 - digit) / 10) {
+      return false;  // Overflow (kInvalidLength itself is not valid either)
+    }
+    value = value * 10 + digit;
+  }
+
+  *size = value;
+  return true;
+}
+
+bool IEquals(boost::string_view str1, boost::string_view str2) {
+  if (str1.size() != str2.size()) {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < str1.size(); ++i) {
+    char c1 = str1[i];
+    char c2 = str2[i];
+    if (c1 != c2) {
+      if (c1 >= 'A' && c1 <= 'Z') {
+        c1 += 'a' - 'A';
+      }
+      if (c2 >= 'A' && c2 <= 'Z') {
+        c2 += 'a' - 'A';
+      }
+      if (c1 != c2) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+boost::string_view Trim(boost::string_view str) {
+  std::size_t begin = 0;
+  std::size_t end = str.size();
+
+  while (begin < end && (str[begin] == ' ' || str[begin] == '\t')) {
+    ++begin;
+  }
+  while (end > begin && (str[end - 1] == ' ' || str[end - 1] == '\t')) {
+    --end;
+  }
+
+  return str.substr(begin, end - begin);
+}
+
 std::size_t TellSize(const Path& path) {
   // Flag "ate": seek to the end of stream immediately after open.
   bfs::ifstream stream{ path, std::ios::binary | std::ios::ate };
@@ -1,8 +1,11 @@
 #ifndef WEBCC_UTILITY_H_
 #define WEBCC_UTILITY_H_
 
+#include <ctime>
 #include <string>
 
+#include "boost/utility/string_view.hpp"
+
 #include "webcc/globals.h"
 
 namespace webcc {
@@ -19,6 +22,12 @@ const std::string& UserAgent();
 // See: https://tools.ietf.org/html/rfc7231#section-7.1.1.2
 std::string GetTimestamp();
 
+// Format the time as an HTTP date, e.g., Wed, 21 Oct 2015 07:28:00 GMT.
+std::string FormatHttpDate(std::time_t t);
+
+// Parse an HTTP date (the preferred format, see FormatHttpDate()).
+bool ParseHttpDate(const std::string& str, std::time_t* t);
+
 // Split a key-value string.
 // E.g., split "Connection: Keep-Alive".
 bool SplitKV(const std::string& str, char delimiter, std::string* key,
@@ -27,6 +36,17 @@ bool SplitKV(const std::string& str, char delimiter, std::string* key,
 // Convert string to size_t.
 bool ToSize(const std::string& str, int base, std::size_t* size);
 
+// Convert a decimal string (digits only) to size_t, without any allocation.
+// Return false on empty string, non-digit characters or overflow.
+bool ToSize(boost::string_view str, std::size_t* size);
+
+// Case-insensitive comparison of ASCII strings, e.g., header names.
+// Much cheaper than boost::iequals() which is locale aware.
+bool IEquals(boost::string_view str1, boost::string_view str2);
+
+// Trim the spaces and horizontal tabs from both ends of a string.
+boost::string_view Trim(boost::string_view str);
+
 // Tell the size in bytes of the given file.
 // Return kInvalidLength (-1) on failure.
 std::size_t TellSize(const Path& path);
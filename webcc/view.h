@@ -4,6 +4,7 @@
 #include <memory>
 
 #include "webcc/request.h"
+#include "webcc/responder.h"
 #include "webcc/response.h"
 
 namespace webcc {
@@ -24,6 +25,25 @@ public:
 
 using ViewPtr = std::shared_ptr<View>;
 
+// A view which doesn't have to prepare the response right away.
+// E.g., a view waiting for a downstream service can park the request with the
+// responder and return immediately, so that the worker thread is free to
+// process other requests. The response can then be sent with the responder
+// later from any thread.
+// If the responder is released without any response sent, the client will get
+// a 500 (Internal Server Error).
+class AsyncView : public View {
+public:
+  // Async views are handled by AsyncHandle() instead.
+  ResponsePtr Handle(RequestPtr /*request*/) final {
+    return {};
+  }
+
+  virtual void AsyncHandle(RequestPtr request, ResponderPtr responder) = 0;
+};
+
+using AsyncViewPtr = std::shared_ptr<AsyncView>;
+
 }  // namespace webcc
 
 #endif  // WEBCC_VIEW_H_